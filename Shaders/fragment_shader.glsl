@@ -1,5 +1,4 @@
 #version 330 core
-in vec3 ourColor;
 in vec2 ourTexCoords;
 out vec4 FragColor;
 
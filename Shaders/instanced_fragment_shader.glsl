@@ -0,0 +1,12 @@
+#version 330 core
+in vec2 ourTexCoords;
+in vec4 ourTint;
+flat in float ourLayer;
+out vec4 FragColor;
+
+uniform sampler2DArray textures;
+
+void main()
+{
+  FragColor = texture(textures, vec3(ourTexCoords, ourLayer)) * ourTint;
+}
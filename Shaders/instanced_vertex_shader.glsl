@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; // position
+layout (location = 2) in vec2 aTexCoords; // Texture
+// per instance attributes (divisor 1)
+layout (location = 3) in mat4 aTransform; // takes locations 3-6
+layout (location = 7) in vec4 aTint;
+layout (location = 8) in float aLayer;
+
+out vec2 ourTexCoords;
+out vec4 ourTint;
+flat out float ourLayer;
+
+void main()
+{
+    gl_Position = aTransform * vec4(aPos, 1.0);
+    ourTexCoords = aTexCoords;
+    ourTint = aTint;
+    ourLayer = aLayer;
+}
@@ -0,0 +1,11 @@
+#version 330 core
+in vec3 normal;
+in vec4 tint;
+out vec4 FragColor;
+
+void main()
+{
+  // fixed directional light plus some ambient
+  float diffuse = max(dot(normalize(normal), normalize(vec3(0.4, 0.8, 0.6))), 0.0);
+  FragColor = vec4(tint.rgb * (0.2 + 0.8 * diffuse), tint.a);
+}
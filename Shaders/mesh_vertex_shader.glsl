@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aNormal; // snorm8, w unused
+layout (location = 2) in vec2 aTexCoords;
+// per instance attributes (divisor 1)
+layout (location = 3) in mat4 aTransform; // takes locations 3-6
+layout (location = 7) in vec4 aTint;
+
+uniform mat4 viewProjection;
+
+out vec3 normal;
+out vec4 tint;
+
+void main()
+{
+    gl_Position = viewProjection * aTransform * vec4(aPos, 1.0);
+    normal = mat3(aTransform) * aNormal.xyz;
+    tint = aTint;
+}
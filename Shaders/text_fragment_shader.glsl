@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 ourTexCoords;
+out vec4 FragColor;
+
+uniform sampler2D font;
+
+void main()
+{
+  // the atlas is one bit per texel, no blending needed
+  if (texture(font, ourTexCoords).r < 0.5)
+    discard;
+  FragColor = vec4(1.0, 1.0, 0.6, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec2 aPos; // already in clip space
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 ourTexCoords;
+
+void main()
+{
+    gl_Position = vec4(aPos, -1.0, 1.0); // on the near plane, in front of everything
+    ourTexCoords = aTexCoords;
+}
@@ -0,0 +1,140 @@
+// Bounding volume hierarchy costs: incremental insertion vs a SAH rebuild,
+// updates of moving objects plus refit, and frustum, ray and range queries,
+// with the linear SIMD frustum cull of the same boxes for comparison.
+//
+//   bvh_benchmark [objectCount]
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "culling.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static void printTree(const char *name, const Bvh &bvh) {
+  Bvh::Stats stats = bvh.stats();
+  std::cout << "  " << name << ": depth " << stats.depth << ", SAH cost "
+            << stats.sahCost << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+  // same scene as the culling benchmark: a 2km cube of mixed sizes
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+  std::uniform_real_distribution<float> size(0.5f, 20.0f);
+  std::vector<Bounds> boxes(count);
+  CullingSet linear;
+  linear.reserve(count);
+  for (Bounds &box : boxes) {
+    Vec3 center{position(rng), position(rng), position(rng)};
+    Vec3 extent{size(rng), size(rng), size(rng)};
+    box = {center - extent, center + extent};
+    linear.addBox(box.min, box.max);
+  }
+  std::cout << count << " objects" << std::endl;
+
+  // Building -------------
+  Bvh bvh(1.0f);
+  std::vector<std::uint32_t> proxies(count);
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; i++)
+    proxies[i] = bvh.insert(boxes[i], static_cast<std::uint32_t>(i));
+  std::cout << "insert: " << elapsedNs(start) / count << " ns/object"
+            << std::endl;
+  printTree("incremental", bvh);
+  start = std::chrono::steady_clock::now();
+  bvh.rebuild();
+  std::cout << "rebuild: " << elapsedNs(start) / 1e6 << " ms" << std::endl;
+  printTree("SAH", bvh);
+
+  // Updating -------------
+  // everything jitters a little (stays inside the margin), a tenth moves far
+  std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+  std::uniform_real_distribution<float> jump(-30.0f, 30.0f);
+  for (int pass = 0; pass < 2; pass++) {
+    bool far = pass == 1;
+    std::size_t changed = 0, moved = 0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i += far ? 10 : 1) {
+      float d = far ? jump(rng) : jitter(rng);
+      boxes[i] = {boxes[i].min + Vec3{d, d, d}, boxes[i].max + Vec3{d, d, d}};
+      changed += bvh.update(proxies[i], boxes[i]);
+      moved++;
+    }
+    std::cout << (far ? "update (far): " : "update (jitter): ")
+              << elapsedNs(start) / moved << " ns/object, " << changed
+              << " of " << moved << " left their box" << std::endl;
+  }
+  printTree("after updates", bvh);
+  start = std::chrono::steady_clock::now();
+  bvh.refit();
+  std::cout << "refit: " << elapsedNs(start) / 1e6 << " ms" << std::endl;
+  printTree("refit", bvh);
+  for (std::size_t i = 0; i < count; i++)
+    linear.setBox(static_cast<std::uint32_t>(i), boxes[i].min, boxes[i].max);
+
+  // Frustum queries -------------
+  const int cameras = 50;
+  double bvhNs = 0.0, linearNs = 0.0;
+  std::size_t visible = 0, mismatches = 0;
+  std::vector<std::uint32_t> bvhResult, linearResult;
+  for (int c = 0; c < cameras; c++) {
+    Camera camera({position(rng), position(rng), position(rng)},
+                  position(rng), position(rng) * 0.001f);
+    camera.setPerspective(1.0472f, 16.0f / 9.0f, 0.1f, 500.0f);
+    Frustum frustum = camera.frustum();
+    start = std::chrono::steady_clock::now();
+    bvh.queryFrustum(frustum, bvhResult);
+    bvhNs += elapsedNs(start);
+    start = std::chrono::steady_clock::now();
+    linear.cullBoxes(frustum, linearResult);
+    linearNs += elapsedNs(start);
+    visible += linearResult.size();
+    mismatches += bvhResult.size() != linearResult.size();
+  }
+  std::cout << "frustum query: bvh " << bvhNs / cameras / 1e3
+            << " us, linear simd " << linearNs / cameras / 1e3 << " us, "
+            << visible / cameras << " visible on average" << std::endl;
+
+  // Ray queries -------------
+  const int rays = 100000;
+  std::size_t hits = 0;
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rays; r++) {
+    Vec3 origin{position(rng), position(rng), position(rng)};
+    Vec3 direction{position(rng), position(rng), position(rng)};
+    hits += bvh.raycast(origin, direction, 1.0f).object != Bvh::INVALID;
+  }
+  std::cout << "raycast: " << elapsedNs(start) / rays << " ns/ray, " << hits
+            << " of " << rays << " hit" << std::endl;
+
+  // Range queries -------------
+  const int ranges = 100000;
+  std::size_t found = 0;
+  start = std::chrono::steady_clock::now();
+  for (int q = 0; q < ranges; q++) {
+    Vec3 center{position(rng), position(rng), position(rng)};
+    bvh.querySphere(center, 25.0f, bvhResult);
+    found += bvhResult.size();
+  }
+  std::cout << "sphere query (r = 25): " << elapsedNs(start) / ranges
+            << " ns/query, " << static_cast<double>(found) / ranges
+            << " objects on average" << std::endl;
+
+  if (mismatches) {
+    std::cout << "ERROR::BVH::RESULTS_DIFFER" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,123 @@
+// Draw packet recording: building packets, their keys and the sort on one
+// thread through RenderQueue, against per-thread command buffers recorded
+// and sorted on 1, 2, 4 ... threads and merged for replay. No GL involved,
+// this is the CPU side only.
+//
+//   command_benchmark [packetCount] [maxThreads]
+
+#include "command_buffer.hpp"
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// a made-up scene: packet i always gets the same state, like an object
+// always using the same material
+static DrawPacket makePacket(std::size_t i) {
+  std::uint32_t h = static_cast<std::uint32_t>(i) * 0x9E3779B1u;
+  h ^= h >> 15;
+  DrawPacket packet;
+  packet.pass = (h & 7) == 0 ? RenderPass::Transparent : RenderPass::Opaque;
+  packet.program = 1 + (h >> 4) % 24;
+  packet.vao = 1 + (h >> 9) % 200;
+  packet.textures[0] = 1 + (h >> 12) % 300;
+  packet.textures[1] = 1 + (h >> 20) % 4;
+  packet.count = 36;
+  packet.indexOffset = ((h >> 3) % 1000) * 36 * sizeof(std::uint32_t);
+  packet.depth = static_cast<float>(h % 1000) / 1000.0f;
+  return packet;
+}
+
+int main(int argc, char **argv) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  unsigned maxThreads =
+      argc > 2 ? static_cast<unsigned>(std::atoi(argv[2]))
+               : std::max(std::thread::hardware_concurrency(), 1u);
+  const int iterations = 10;
+
+  // Single thread -------------
+  RenderQueue queue;
+  std::vector<RenderQueue::SortItem> items, scratch;
+  std::vector<DrawPacket> packets;
+  double serial = 1e30;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    items.clear();
+    packets.clear();
+    for (std::size_t p = 0; p < count; p++) {
+      packets.push_back(makePacket(p));
+      items.push_back({queue.makeKey(packets.back()),
+                       static_cast<std::uint32_t>(p)});
+    }
+    RenderQueue::radixSort(items, scratch);
+    serial = std::min(serial, elapsedMs(start));
+  }
+  std::cout << count << " packets, RenderQueue on one thread: " << serial
+            << " ms" << std::endl;
+
+  // Command buffers -------------
+  bool failed = false;
+  std::vector<const DrawPacket *> merged;
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    JobSystem jobs(threads);
+    std::vector<CommandBuffer> buffers(jobs.size());
+    std::vector<const CommandBuffer *> recorded;
+    for (const CommandBuffer &buffer : buffers)
+      recorded.push_back(&buffer);
+    double best = 1e30, bestMerge = 1e30;
+    for (int i = 0; i < iterations; i++) {
+      for (CommandBuffer &buffer : buffers)
+        buffer.reset();
+      auto start = std::chrono::steady_clock::now();
+      JobCounter counter;
+      jobs.parallelFor(
+          count, 4096,
+          [&](std::size_t first, std::size_t last) {
+            CommandBuffer &buffer = buffers[jobs.threadIndex()];
+            for (std::size_t p = first; p < last; p++)
+              buffer.draw(makePacket(p));
+          },
+          counter);
+      jobs.wait(counter);
+      jobs.parallelFor(
+          buffers.size(), 1,
+          [&](std::size_t first, std::size_t last) {
+            for (std::size_t b = first; b < last; b++)
+              buffers[b].sort();
+          },
+          counter);
+      jobs.wait(counter);
+      best = std::min(best, elapsedMs(start));
+      start = std::chrono::steady_clock::now();
+      mergeCommandBuffers(recorded.data(), recorded.size(), merged);
+      bestMerge = std::min(bestMerge, elapsedMs(start));
+    }
+    std::cout << "  " << threads << " thread(s): record + sort " << best
+              << " ms, merge on the GL thread " << bestMerge
+              << " ms, speedup " << serial / (best + bestMerge) << std::endl;
+
+    // every packet once, in key order
+    bool sorted = merged.size() == count;
+    for (std::size_t p = 1; sorted && p < merged.size(); p++)
+      sorted = RenderQueue::makeNameKey(*merged[p - 1]) <=
+               RenderQueue::makeNameKey(*merged[p]);
+    if (!sorted) {
+      std::cout << "ERROR::COMMAND_BUFFER::MERGE_OUT_OF_ORDER" << std::endl;
+      failed = true;
+    }
+    if (threads < maxThreads && threads * 2 > maxThreads)
+      threads = maxThreads / 2; // finish on exactly maxThreads
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+// Frustum culling throughput: a million objects scattered around a camera,
+// culled as spheres and as boxes, one object at a time and then
+// CULLING_SIMD_WIDTH at a time. Reports nanoseconds per object.
+//
+//   culling_benchmark [objectCount] [iterations]
+
+#include "camera.hpp"
+#include "culling.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using CullFunction = void (CullingSet::*)(const Frustum &,
+                                          std::vector<std::uint32_t> &) const;
+
+// best and average time of `iterations` runs, the result of the last one in
+// `visible`
+static void run(const char *name, const CullingSet &set,
+                const Frustum &frustum, CullFunction cull, int iterations,
+                std::vector<std::uint32_t> &visible) {
+  double best = 1e30, total = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    (set.*cull)(frustum, visible);
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    best = std::min(best, ns);
+    total += ns;
+  }
+  double objects = static_cast<double>(set.size());
+  std::cout << "  " << name << ": best " << best / objects << " ns/object, avg "
+            << total / iterations / objects << " ns/object, " << visible.size()
+            << " visible" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  // objects in a 2km cube around the camera, from pebbles to houses
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+  std::uniform_real_distribution<float> size(0.5f, 20.0f);
+  CullingSet spheres, boxes;
+  spheres.reserve(count);
+  boxes.reserve(count);
+  for (std::size_t i = 0; i < count; i++) {
+    Vec3 center{position(rng), position(rng), position(rng)};
+    Vec3 extent{size(rng), size(rng), size(rng)};
+    spheres.addSphere(center, extent.x);
+    boxes.addBox(center - extent, center + extent);
+  }
+  Camera camera({0.0f, 0.0f, 0.0f}, 0.3f, 0.1f);
+  camera.setPerspective(1.0472f, 16.0f / 9.0f, 0.1f, 1000.0f);
+  Frustum frustum = camera.frustum();
+
+  std::cout << count << " objects, " << CULLING_SIMD_WIDTH
+            << " per instruction" << std::endl;
+  std::vector<std::uint32_t> scalar, simd;
+  run("spheres, scalar", spheres, frustum, &CullingSet::cullSpheresScalar,
+      iterations, scalar);
+  run("spheres, simd  ", spheres, frustum, &CullingSet::cullSpheres,
+      iterations, simd);
+  bool match = scalar == simd;
+  run("boxes, scalar  ", boxes, frustum, &CullingSet::cullBoxesScalar,
+      iterations, scalar);
+  run("boxes, simd    ", boxes, frustum, &CullingSet::cullBoxes, iterations,
+      simd);
+  match = match && scalar == simd;
+  if (!match) {
+    std::cout << "ERROR::CULLING::RESULTS_DIFFER" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+// Job system throughput and scaling: empty jobs submitted in batches from the
+// main thread, a recursive spawn tree, a compute-bound parallelFor, a
+// runAfter() dependency chain and jobs handing work back to the main thread,
+// on 1, 2, 4 ... threads. Every test checks its own result.
+//
+//   job_benchmark [jobCount] [maxThreads]
+
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// two children per job down to depth 0, counting every job that ran
+static void spawnTree(JobSystem &jobs, int depth, std::atomic<std::size_t> &ran,
+                      JobCounter &counter) {
+  ran.fetch_add(1, std::memory_order_relaxed);
+  if (depth == 0)
+    return;
+  for (int child = 0; child < 2; child++)
+    jobs.run([&jobs, depth, &ran, &counter] {
+      spawnTree(jobs, depth - 1, ran, counter);
+    }, &counter);
+}
+
+// some integer work that can't be optimized away or vectorized much
+static std::uint32_t hashRange(std::size_t begin, std::size_t end) {
+  std::uint32_t hash = 0;
+  for (std::size_t i = begin; i < end; i++) {
+    std::uint32_t x = static_cast<std::uint32_t>(i) * 0x9E3779B1u;
+    for (int round = 0; round < 16; round++)
+      x = (x ^ (x >> 15)) * 0x2C1B3C6Du;
+    hash += x;
+  }
+  return hash;
+}
+
+int main(int argc, char **argv) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  unsigned maxThreads =
+      argc > 2 ? static_cast<unsigned>(std::atoi(argv[2]))
+               : std::max(std::thread::hardware_concurrency(), 1u);
+  bool failed = false;
+
+  // the spawn tree closest to `count` jobs
+  int treeDepth = 1;
+  while ((std::size_t(2) << (treeDepth + 1)) - 1 <= count)
+    treeDepth++;
+  std::size_t treeJobs = (std::size_t(2) << treeDepth) - 1;
+  const std::size_t computeItems = 1 << 22, computeGrain = 1 << 14;
+  const std::uint32_t computeReference = hashRange(0, computeItems);
+  const std::size_t chainLength = 10000;
+
+  double singleEmpty = 0.0, singleTree = 0.0, singleCompute = 0.0;
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    JobSystem jobs(threads);
+    std::cout << threads << " thread(s)" << std::endl;
+
+    // Empty jobs -------------
+    // batches small enough to fit the main thread's deque, the workers
+    // steal from it
+    const std::size_t batch = 1024;
+    std::atomic<std::size_t> ran{0};
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t submitted = 0; submitted < count; submitted += batch) {
+      JobCounter counter;
+      for (std::size_t i = submitted; i < std::min(count, submitted + batch);
+           i++)
+        jobs.run([&ran] { ran.fetch_add(1, std::memory_order_relaxed); },
+                 &counter);
+      jobs.wait(counter);
+    }
+    double ms = elapsedMs(start);
+    if (threads == 1)
+      singleEmpty = ms;
+    std::cout << "  empty jobs: " << ms * 1e6 / count << " ns/job, "
+              << count / ms / 1e3 << " M jobs/s, speedup " << singleEmpty / ms
+              << std::endl;
+    if (ran.load() != count) {
+      std::cout << "ERROR::JOB_SYSTEM::EMPTY_JOBS_LOST " << ran.load()
+                << std::endl;
+      failed = true;
+    }
+
+    // Spawn tree -------------
+    ran = 0;
+    start = std::chrono::steady_clock::now();
+    {
+      JobCounter counter;
+      jobs.run([&] { spawnTree(jobs, treeDepth, ran, counter); }, &counter);
+      jobs.wait(counter);
+    }
+    ms = elapsedMs(start);
+    if (threads == 1)
+      singleTree = ms;
+    std::cout << "  spawn tree (" << treeJobs
+              << " jobs): " << ms * 1e6 / treeJobs << " ns/job, speedup "
+              << singleTree / ms << std::endl;
+    if (ran.load() != treeJobs) {
+      std::cout << "ERROR::JOB_SYSTEM::SPAWN_TREE_LOST " << ran.load()
+                << std::endl;
+      failed = true;
+    }
+
+    // parallelFor -------------
+    std::atomic<std::uint32_t> hash{0};
+    start = std::chrono::steady_clock::now();
+    {
+      JobCounter counter;
+      jobs.parallelFor(
+          computeItems, computeGrain,
+          [&hash](std::size_t begin, std::size_t end) {
+            hash.fetch_add(hashRange(begin, end), std::memory_order_relaxed);
+          },
+          counter);
+      jobs.wait(counter);
+    }
+    ms = elapsedMs(start);
+    if (threads == 1)
+      singleCompute = ms;
+    std::cout << "  parallelFor (" << computeItems / computeGrain
+              << " chunks): " << ms << " ms, speedup " << singleCompute / ms
+              << std::endl;
+    if (hash.load() != computeReference) {
+      std::cout << "ERROR::JOB_SYSTEM::PARALLEL_FOR_DIFFERS" << std::endl;
+      failed = true;
+    }
+
+    // Dependency chain -------------
+    // every link waits for the one before, so this measures the latency of
+    // releasing a parked job rather than throughput
+    std::vector<std::unique_ptr<JobCounter>> links(chainLength);
+    for (auto &link : links)
+      link = std::make_unique<JobCounter>();
+    std::vector<std::size_t> order;
+    order.reserve(chainLength);
+    start = std::chrono::steady_clock::now();
+    jobs.run([&order] { order.push_back(0); }, links[0].get());
+    for (std::size_t i = 1; i < chainLength; i++)
+      jobs.runAfter(*links[i - 1], [&order, i] { order.push_back(i); },
+                    links[i].get());
+    jobs.wait(*links.back());
+    ms = elapsedMs(start);
+    std::cout << "  dependency chain: " << ms * 1e6 / chainLength
+              << " ns/link" << std::endl;
+    for (auto &link : links)
+      jobs.wait(*link);
+    bool inOrder = order.size() == chainLength;
+    for (std::size_t i = 0; inOrder && i < chainLength; i++)
+      inOrder = order[i] == i;
+    if (!inOrder) {
+      std::cout << "ERROR::JOB_SYSTEM::CHAIN_OUT_OF_ORDER" << std::endl;
+      failed = true;
+    }
+
+    // Main thread affinity -------------
+    // worker jobs queue work for the main thread, as texture uploads do
+    const std::thread::id mainThread = std::this_thread::get_id();
+    const std::size_t handBacks = 1000;
+    std::atomic<std::size_t> onMain{0}, elsewhere{0};
+    start = std::chrono::steady_clock::now();
+    {
+      JobCounter counter;
+      for (std::size_t i = 0; i < handBacks; i++)
+        jobs.run(
+            [&] {
+              jobs.runOnMainThread(
+                  [&] {
+                    if (std::this_thread::get_id() == mainThread)
+                      onMain++;
+                    else
+                      elsewhere++;
+                  },
+                  &counter);
+            },
+            &counter);
+      jobs.wait(counter);
+    }
+    ms = elapsedMs(start);
+    std::cout << "  main thread hand-back: " << ms * 1e6 / handBacks
+              << " ns/job" << std::endl;
+    if (onMain.load() != handBacks || elsewhere.load() != 0) {
+      std::cout << "ERROR::JOB_SYSTEM::WRONG_THREAD " << elsewhere.load()
+                << std::endl;
+      failed = true;
+    }
+
+    if (threads < maxThreads && threads * 2 > maxThreads)
+      threads = maxThreads / 2; // finish on exactly maxThreads
+  }
+  return failed ? 1 : 0;
+}
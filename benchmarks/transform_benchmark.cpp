@@ -0,0 +1,120 @@
+// Transform hierarchy update: a random forest of nodes recomputed in full on
+// 1, 2, 4 ... threads, then again with only a few subtrees changed, checked
+// against a plain sequential walk.
+//
+//   transform_benchmark [nodeCount] [maxThreads]
+
+#include "job_system.hpp"
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  unsigned maxThreads =
+      argc > 2 ? static_cast<unsigned>(std::atoi(argv[2]))
+               : std::max(std::thread::hardware_concurrency(), 1u);
+
+  // every node hangs off a random earlier one, which makes a few hundred
+  // roots and a depth in the twenties, like a big scene graph
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  auto randomTransform = [&]() {
+    Transform t;
+    t.position = {unit(rng) * 2.0f, unit(rng) * 2.0f, unit(rng) * 2.0f};
+    t.rotation = quaternion(unit(rng) * 3.14159f,
+                            {unit(rng), unit(rng), unit(rng) + 1.5f});
+    t.scale = 1.0f + unit(rng) * 0.05f;
+    return t;
+  };
+  TransformHierarchy hierarchy;
+  std::vector<TransformHierarchy::Node> parents(count);
+  std::vector<Mat4> locals(count);
+  for (std::size_t i = 0; i < count; i++) {
+    parents[i] = i < 256 ? TransformHierarchy::INVALID
+                         : static_cast<TransformHierarchy::Node>(rng() % i);
+    locals[i] = transformMatrix(randomTransform());
+    hierarchy.create(parents[i], locals[i]);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  hierarchy.update();
+  std::cout << count << " nodes, depth " << hierarchy.depth()
+            << ", first update (layout + all nodes) " << elapsedMs(start)
+            << " ms" << std::endl;
+
+  // Full updates -------------
+  const int iterations = 10;
+  double single = 0.0;
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    JobSystem jobs(threads);
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+      for (TransformHierarchy::Node root = 0; root < 256; root++)
+        hierarchy.setLocal(root, locals[root]);
+      start = std::chrono::steady_clock::now();
+      hierarchy.update(&jobs);
+      best = std::min(best, elapsedMs(start));
+    }
+    if (threads == 1)
+      single = best;
+    std::cout << "  all dirty, " << threads << " thread(s): " << best
+              << " ms, " << best * 1e6 / count << " ns/node, speedup "
+              << single / best << std::endl;
+    if (threads < maxThreads && threads * 2 > maxThreads)
+      threads = maxThreads / 2; // finish on exactly maxThreads
+  }
+
+  // Partial updates -------------
+  JobSystem jobs(maxThreads);
+  for (std::size_t changed : {1, 100, 10000}) {
+    for (std::size_t i = 0; i < changed; i++) {
+      TransformHierarchy::Node node =
+          static_cast<TransformHierarchy::Node>(rng() % count);
+      locals[node] = transformMatrix(randomTransform());
+      hierarchy.setLocal(node, locals[node]);
+    }
+    start = std::chrono::steady_clock::now();
+    std::size_t updated = hierarchy.update(&jobs);
+    std::cout << "  " << changed << " changed: " << updated
+              << " nodes recomputed in " << elapsedMs(start) << " ms"
+              << std::endl;
+  }
+  start = std::chrono::steady_clock::now();
+  hierarchy.update(&jobs);
+  std::cout << "  nothing changed: " << elapsedMs(start) << " ms"
+            << std::endl;
+
+  // parents come before their children, so one pass in creation order is
+  // the reference
+  std::vector<Mat4> reference(count);
+  for (std::size_t i = 0; i < count; i++)
+    reference[i] = parents[i] == TransformHierarchy::INVALID
+                       ? locals[i]
+                       : reference[parents[i]] * locals[i];
+  float worst = 0.0f;
+  for (std::size_t i = 0; i < count; i++) {
+    const Mat4 &world = hierarchy.world(static_cast<TransformHierarchy::Node>(i));
+    for (int k = 0; k < 16; k++)
+      worst = std::max(worst, std::abs(world.m[k] - reference[i].m[k]));
+  }
+  if (worst > 0.0f) {
+    std::cout << "ERROR::TRANSFORM_HIERARCHY::RESULTS_DIFFER " << worst
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
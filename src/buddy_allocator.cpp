@@ -0,0 +1,89 @@
+#include "buddy_allocator.hpp"
+
+#include <iostream>
+
+BuddyAllocator::BuddyAllocator(std::uint32_t capacity, std::uint32_t minBlock)
+    : m_minBlock(minBlock ? minBlock : 1) {
+  // largest order whose block size still fits in 32 bits
+  unsigned int orderLimit = 31;
+  for (std::uint32_t block = m_minBlock; block > 1; block >>= 1)
+    orderLimit--;
+  m_maxOrder = 0;
+  while (m_maxOrder < orderLimit && blockSize(m_maxOrder) < capacity)
+    m_maxOrder++;
+  if (blockSize(m_maxOrder) < capacity)
+    std::cout << "ERROR::BUDDY_ALLOCATOR::CAPACITY_CLAMPED " << capacity
+              << " -> " << blockSize(m_maxOrder) << std::endl;
+  m_capacity = blockSize(m_maxOrder);
+  m_free.resize(m_maxOrder + 1);
+  m_free[m_maxOrder].insert(0);
+}
+
+unsigned int BuddyAllocator::orderFor(std::uint32_t count) const {
+  unsigned int order = 0;
+  while (blockSize(order) < count)
+    order++;
+  return order;
+}
+
+std::uint32_t BuddyAllocator::allocate(std::uint32_t count) {
+  if (count == 0 || count > m_capacity)
+    return INVALID;
+  unsigned int order = orderFor(count);
+  // smallest free block that fits
+  unsigned int found = order;
+  while (found <= m_maxOrder && m_free[found].empty())
+    found++;
+  if (found > m_maxOrder)
+    return INVALID;
+
+  std::uint32_t offset = *m_free[found].begin();
+  m_free[found].erase(m_free[found].begin());
+  // split down to the size we need, the upper halves go back on the lists
+  while (found > order) {
+    found--;
+    m_free[found].insert(offset + blockSize(found));
+  }
+  m_used[offset] = {order, count};
+  m_requested += count;
+  m_allocated += blockSize(order);
+  return offset;
+}
+
+void BuddyAllocator::free(std::uint32_t offset) {
+  auto it = m_used.find(offset);
+  if (it == m_used.end())
+    return;
+  unsigned int order = it->second.order;
+  m_requested -= it->second.requested;
+  m_allocated -= blockSize(order);
+  m_used.erase(it);
+
+  // merge with the buddy for as long as it is free too
+  while (order < m_maxOrder) {
+    std::uint32_t buddy = offset ^ blockSize(order);
+    auto free = m_free[order].find(buddy);
+    if (free == m_free[order].end())
+      break;
+    m_free[order].erase(free);
+    offset = offset < buddy ? offset : buddy;
+    order++;
+  }
+  m_free[order].insert(offset);
+}
+
+BuddyAllocator::Stats BuddyAllocator::stats() const {
+  Stats stats;
+  stats.capacity = m_capacity;
+  stats.requested = m_requested;
+  stats.allocated = m_allocated;
+  stats.allocations = static_cast<std::uint32_t>(m_used.size());
+  for (unsigned int order = 0; order <= m_maxOrder; order++)
+    if (!m_free[order].empty())
+      stats.largestFree = blockSize(order);
+  std::uint32_t totalFree = m_capacity - m_allocated;
+  if (totalFree > 0)
+    stats.fragmentation =
+        1.0f - static_cast<float>(stats.largestFree) / totalFree;
+  return stats;
+}
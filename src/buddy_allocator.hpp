@@ -0,0 +1,58 @@
+#ifndef BUDDY_ALLOCATOR_H
+#define BUDDY_ALLOCATOR_H
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Binary buddy allocator over an abstract range of units (bytes, vertices,
+// indices...). It only hands out offsets, the memory itself lives elsewhere
+// (a GL buffer for MeshBatch). Blocks are powers of two times minBlock and
+// are merged with their buddy when freed.
+class BuddyAllocator {
+public:
+  static constexpr std::uint32_t INVALID = 0xFFFFFFFFu;
+
+  struct Stats {
+    std::uint32_t capacity = 0;
+    std::uint32_t requested = 0; // units the callers asked for
+    std::uint32_t allocated = 0; // units handed out after rounding up
+    std::uint32_t largestFree = 0;
+    std::uint32_t allocations = 0;
+    // 0 when all free space is one block, approaching 1 when it's scattered
+    float fragmentation = 0.0f;
+  };
+
+  // capacity is rounded up to minBlock * 2^n, and clamped to the largest
+  // such size that fits in 32 bits
+  BuddyAllocator(std::uint32_t capacity, std::uint32_t minBlock);
+
+  // returns the offset of a block of at least `count` units, or INVALID
+  std::uint32_t allocate(std::uint32_t count);
+  void free(std::uint32_t offset);
+
+  std::uint32_t capacity() const { return m_capacity; }
+  Stats stats() const;
+
+private:
+  unsigned int orderFor(std::uint32_t count) const;
+  std::uint32_t blockSize(unsigned int order) const {
+    return m_minBlock << order;
+  }
+
+  std::uint32_t m_capacity;
+  std::uint32_t m_minBlock;
+  unsigned int m_maxOrder;
+  // free block offsets per order, ordered so we hand out low addresses first
+  std::vector<std::set<std::uint32_t>> m_free;
+  // live allocations: offset -> (order, requested units)
+  struct Block {
+    unsigned int order;
+    std::uint32_t requested;
+  };
+  std::unordered_map<std::uint32_t, Block> m_used;
+  std::uint32_t m_requested = 0;
+  std::uint32_t m_allocated = 0;
+};
+#endif
@@ -0,0 +1,486 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+Bounds unite(const Bounds &a, const Bounds &b) {
+  return {{std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y),
+           std::min(a.min.z, b.min.z)},
+          {std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y),
+           std::max(a.max.z, b.max.z)}};
+}
+
+// half the surface area, all the heuristic needs
+float area(const Bounds &b) {
+  Vec3 d = b.max - b.min;
+  return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+bool contains(const Bounds &outer, const Bounds &inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+         outer.min.z <= inner.min.z && outer.max.x >= inner.max.x &&
+         outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+bool overlaps(const Bounds &a, const Bounds &b) {
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+         a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+Bounds enlarge(const Bounds &b, float margin) {
+  Vec3 m{margin, margin, margin};
+  return {b.min - m, b.max + m};
+}
+
+float axis(Vec3 v, int a) { return a == 0 ? v.x : a == 1 ? v.y : v.z; }
+
+// slab test, entry distance or infinity for a miss
+float rayBox(Vec3 origin, Vec3 inverseDirection, const Bounds &b,
+             float maxDistance) {
+  float t1 = (b.min.x - origin.x) * inverseDirection.x;
+  float t2 = (b.max.x - origin.x) * inverseDirection.x;
+  float tmin = std::min(t1, t2), tmax = std::max(t1, t2);
+  t1 = (b.min.y - origin.y) * inverseDirection.y;
+  t2 = (b.max.y - origin.y) * inverseDirection.y;
+  tmin = std::max(tmin, std::min(t1, t2));
+  tmax = std::min(tmax, std::max(t1, t2));
+  t1 = (b.min.z - origin.z) * inverseDirection.z;
+  t2 = (b.max.z - origin.z) * inverseDirection.z;
+  tmin = std::max(tmin, std::min(t1, t2));
+  tmax = std::min(tmax, std::max(t1, t2));
+  if (tmax < std::max(tmin, 0.0f) || tmin > maxDistance)
+    return std::numeric_limits<float>::infinity();
+  return std::max(tmin, 0.0f);
+}
+
+const int SAH_BINS = 16;
+
+} // namespace
+
+Bvh::Bvh(float margin) : m_margin(margin) {}
+
+std::uint32_t Bvh::allocateNode() {
+  std::uint32_t node;
+  if (m_freeList != INVALID) {
+    node = m_freeList;
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+  } else {
+    node = static_cast<std::uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+  }
+  return node;
+}
+
+void Bvh::freeNode(std::uint32_t node) {
+  m_nodes[node] = Node{};
+  m_nodes[node].parent = m_freeList;
+  m_freeList = node;
+}
+
+std::uint32_t Bvh::insert(const Bounds &bounds, std::uint32_t object) {
+  std::uint32_t leaf = allocateNode();
+  m_nodes[leaf].bounds = enlarge(bounds, m_margin);
+  m_nodes[leaf].tight = bounds;
+  m_nodes[leaf].object = object;
+  insertLeaf(leaf);
+  m_leafCount++;
+
+  std::uint32_t proxy;
+  if (!m_freeProxies.empty()) {
+    proxy = m_freeProxies.back();
+    m_freeProxies.pop_back();
+    m_proxyNode[proxy] = leaf;
+  } else {
+    proxy = static_cast<std::uint32_t>(m_proxyNode.size());
+    m_proxyNode.push_back(leaf);
+  }
+  return proxy;
+}
+
+void Bvh::remove(std::uint32_t proxy) {
+  std::uint32_t leaf = m_proxyNode[proxy];
+  removeLeaf(leaf);
+  freeNode(leaf);
+  m_proxyNode[proxy] = INVALID;
+  m_freeProxies.push_back(proxy);
+  m_leafCount--;
+}
+
+bool Bvh::update(std::uint32_t proxy, const Bounds &bounds) {
+  std::uint32_t leaf = m_proxyNode[proxy];
+  m_nodes[leaf].tight = bounds;
+  if (contains(m_nodes[leaf].bounds, bounds))
+    return false;
+  m_nodes[leaf].bounds = enlarge(bounds, m_margin);
+  // grow the ancestors until one already covers the new box
+  for (std::uint32_t node = m_nodes[leaf].parent; node != INVALID;
+       node = m_nodes[node].parent) {
+    if (contains(m_nodes[node].bounds, m_nodes[leaf].bounds))
+      break;
+    m_nodes[node].bounds = unite(m_nodes[node].bounds, m_nodes[leaf].bounds);
+  }
+  return true;
+}
+
+void Bvh::insertLeaf(std::uint32_t leaf) {
+  if (m_root == INVALID) {
+    m_root = leaf;
+    m_nodes[leaf].parent = INVALID;
+    return;
+  }
+
+  // Branch and bound for the sibling with the lowest total cost: the area of
+  // the new parent plus how much every ancestor grows. A subtree can be
+  // skipped once even its lower bound can't beat the best so far.
+  const Bounds box = m_nodes[leaf].bounds;
+  const float leafArea = area(box);
+  std::uint32_t best = m_root;
+  float bestCost = area(unite(box, m_nodes[m_root].bounds));
+  auto greater = [](const std::pair<float, std::uint32_t> &a,
+                    const std::pair<float, std::uint32_t> &b) {
+    return a.first > b.first;
+  };
+  m_insertQueue.clear();
+  m_insertQueue.push_back({0.0f, m_root});
+  while (!m_insertQueue.empty()) {
+    std::pop_heap(m_insertQueue.begin(), m_insertQueue.end(), greater);
+    auto [inherited, index] = m_insertQueue.back();
+    m_insertQueue.pop_back();
+    const Node &node = m_nodes[index];
+    float direct = area(unite(box, node.bounds));
+    float cost = direct + inherited;
+    if (cost < bestCost) {
+      bestCost = cost;
+      best = index;
+    }
+    if (node.leaf())
+      continue;
+    float childInherited = inherited + direct - area(node.bounds);
+    if (leafArea + childInherited >= bestCost)
+      continue;
+    for (std::uint32_t child : node.children) {
+      m_insertQueue.push_back({childInherited, child});
+      std::push_heap(m_insertQueue.begin(), m_insertQueue.end(), greater);
+    }
+  }
+
+  std::uint32_t oldParent = m_nodes[best].parent;
+  std::uint32_t parent = allocateNode();
+  m_nodes[parent].parent = oldParent;
+  m_nodes[parent].bounds = unite(box, m_nodes[best].bounds);
+  m_nodes[parent].children[0] = best;
+  m_nodes[parent].children[1] = leaf;
+  m_nodes[best].parent = parent;
+  m_nodes[leaf].parent = parent;
+  if (oldParent == INVALID) {
+    m_root = parent;
+  } else {
+    Node &grandParent = m_nodes[oldParent];
+    grandParent.children[grandParent.children[0] == best ? 0 : 1] = parent;
+    refitAncestors(oldParent);
+  }
+}
+
+void Bvh::removeLeaf(std::uint32_t leaf) {
+  if (leaf == m_root) {
+    m_root = INVALID;
+    return;
+  }
+  std::uint32_t parent = m_nodes[leaf].parent;
+  std::uint32_t grandParent = m_nodes[parent].parent;
+  std::uint32_t sibling = m_nodes[parent].children[0] == leaf
+                              ? m_nodes[parent].children[1]
+                              : m_nodes[parent].children[0];
+  m_nodes[sibling].parent = grandParent;
+  if (grandParent == INVALID) {
+    m_root = sibling;
+  } else {
+    Node &node = m_nodes[grandParent];
+    node.children[node.children[0] == parent ? 0 : 1] = sibling;
+    refitAncestors(grandParent);
+  }
+  freeNode(parent);
+}
+
+void Bvh::refitAncestors(std::uint32_t node) {
+  for (; node != INVALID; node = m_nodes[node].parent)
+    m_nodes[node].bounds = unite(m_nodes[m_nodes[node].children[0]].bounds,
+                                 m_nodes[m_nodes[node].children[1]].bounds);
+}
+
+void Bvh::refit() {
+  if (m_root == INVALID)
+    return;
+  // children always come after their parent in a breadth-first order, so
+  // walking it backwards refits bottom-up
+  std::vector<std::uint32_t> order;
+  order.reserve(m_nodes.size());
+  order.push_back(m_root);
+  for (std::size_t i = 0; i < order.size(); i++)
+    if (!m_nodes[order[i]].leaf())
+      order.insert(order.end(), m_nodes[order[i]].children,
+                   m_nodes[order[i]].children + 2);
+  for (std::size_t i = order.size(); i-- > 0;) {
+    Node &node = m_nodes[order[i]];
+    node.bounds = node.leaf()
+                      ? enlarge(node.tight, m_margin)
+                      : unite(m_nodes[node.children[0]].bounds,
+                              m_nodes[node.children[1]].bounds);
+  }
+}
+
+void Bvh::rebuild() {
+  if (m_root == INVALID)
+    return;
+  std::vector<BuildItem> items;
+  items.reserve(m_leafCount);
+  for (std::uint32_t proxy = 0; proxy < m_proxyNode.size(); proxy++) {
+    if (m_proxyNode[proxy] == INVALID)
+      continue;
+    Bounds bounds = enlarge(m_nodes[m_proxyNode[proxy]].tight, m_margin);
+    items.push_back({bounds, (bounds.min + bounds.max) * 0.5f, proxy});
+  }
+  std::vector<Node> previous;
+  previous.swap(m_nodes);
+  m_nodes.reserve(2 * items.size() - 1);
+  m_freeList = INVALID;
+  m_root = buildRange(items.data(), items.size(), INVALID, previous);
+}
+
+std::uint32_t Bvh::buildRange(BuildItem *items, std::size_t count,
+                              std::uint32_t parent,
+                              const std::vector<Node> &previous) {
+  std::uint32_t node = static_cast<std::uint32_t>(m_nodes.size());
+  if (count == 1) {
+    m_nodes.push_back(previous[m_proxyNode[items[0].proxy]]);
+    m_nodes[node].bounds = items[0].bounds;
+    m_nodes[node].parent = parent;
+    m_proxyNode[items[0].proxy] = node;
+    return node;
+  }
+  m_nodes.emplace_back();
+
+  Bounds centroids{items[0].centroid, items[0].centroid};
+  for (std::size_t i = 1; i < count; i++)
+    centroids = unite(centroids, {items[i].centroid, items[i].centroid});
+
+  // binned SAH: try SAH_BINS - 1 split planes along every axis
+  int bestAxis = -1, bestSplit = 0;
+  float bestCost = std::numeric_limits<float>::max();
+  for (int a = 0; a < 3; a++) {
+    float lo = axis(centroids.min, a), extent = axis(centroids.max, a) - lo;
+    if (extent <= 0.0f)
+      continue;
+    float toBin = SAH_BINS / extent;
+    std::size_t binCount[SAH_BINS] = {};
+    Bounds binBounds[SAH_BINS];
+    for (std::size_t i = 0; i < count; i++) {
+      int bin = std::min(
+          SAH_BINS - 1,
+          static_cast<int>((axis(items[i].centroid, a) - lo) * toBin));
+      binBounds[bin] = binCount[bin] ? unite(binBounds[bin], items[i].bounds)
+                                     : items[i].bounds;
+      binCount[bin]++;
+    }
+    // areas/counts left of every split, then sweep from the right
+    float leftArea[SAH_BINS];
+    std::size_t leftCount[SAH_BINS];
+    Bounds sweep;
+    std::size_t n = 0;
+    for (int b = 0; b < SAH_BINS - 1; b++) {
+      if (binCount[b])
+        sweep = n ? unite(sweep, binBounds[b]) : binBounds[b];
+      n += binCount[b];
+      leftCount[b + 1] = n;
+      leftArea[b + 1] = n ? area(sweep) : 0.0f;
+    }
+    n = 0;
+    for (int b = SAH_BINS - 1; b > 0; b--) {
+      if (binCount[b])
+        sweep = n ? unite(sweep, binBounds[b]) : binBounds[b];
+      n += binCount[b];
+      if (!n || !leftCount[b])
+        continue;
+      float cost = leftArea[b] * static_cast<float>(leftCount[b]) +
+                   area(sweep) * static_cast<float>(n);
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = a;
+        bestSplit = b;
+      }
+    }
+  }
+
+  std::size_t middle = count / 2; // all centroids equal, any split will do
+  if (bestAxis >= 0) {
+    float lo = axis(centroids.min, bestAxis);
+    float toBin = SAH_BINS / (axis(centroids.max, bestAxis) - lo);
+    middle = std::partition(items, items + count,
+                            [&](const BuildItem &item) {
+                              int bin = std::min(
+                                  SAH_BINS - 1,
+                                  static_cast<int>(
+                                      (axis(item.centroid, bestAxis) - lo) *
+                                      toBin));
+                              return bin < bestSplit;
+                            }) -
+             items;
+  }
+
+  std::uint32_t left = buildRange(items, middle, node, previous);
+  std::uint32_t right =
+      buildRange(items + middle, count - middle, node, previous);
+  m_nodes[node].parent = parent;
+  m_nodes[node].children[0] = left;
+  m_nodes[node].children[1] = right;
+  m_nodes[node].bounds = unite(m_nodes[left].bounds, m_nodes[right].bounds);
+  return node;
+}
+
+void Bvh::clear() {
+  m_nodes.clear();
+  m_proxyNode.clear();
+  m_freeProxies.clear();
+  m_root = INVALID;
+  m_freeList = INVALID;
+  m_leafCount = 0;
+}
+
+void Bvh::queryFrustum(const Frustum &frustum,
+                       std::vector<std::uint32_t> &objects) const {
+  objects.clear();
+  if (m_root == INVALID)
+    return;
+  // node and the planes it still has to be tested against
+  std::vector<std::pair<std::uint32_t, unsigned>> stack{
+      {m_root, ALL_FRUSTUM_PLANES}};
+  while (!stack.empty()) {
+    auto [index, planes] = stack.back();
+    stack.pop_back();
+    const Node &node = m_nodes[index];
+    if (node.leaf()) {
+      if (!planes ||
+          classify(frustum, node.tight, planes) != Containment::Outside)
+        objects.push_back(node.object);
+      continue;
+    }
+    if (planes &&
+        classify(frustum, node.bounds, planes) == Containment::Outside)
+      continue;
+    stack.push_back({node.children[1], planes});
+    stack.push_back({node.children[0], planes});
+  }
+}
+
+void Bvh::queryBox(const Bounds &box,
+                   std::vector<std::uint32_t> &objects) const {
+  objects.clear();
+  if (m_root == INVALID)
+    return;
+  std::vector<std::uint32_t> stack{m_root};
+  while (!stack.empty()) {
+    std::uint32_t index = stack.back();
+    stack.pop_back();
+    const Node &node = m_nodes[index];
+    if (node.leaf()) {
+      if (overlaps(box, node.tight))
+        objects.push_back(node.object);
+    } else if (overlaps(box, node.bounds)) {
+      stack.push_back(node.children[1]);
+      stack.push_back(node.children[0]);
+    }
+  }
+}
+
+void Bvh::querySphere(Vec3 center, float radius,
+                      std::vector<std::uint32_t> &objects) const {
+  objects.clear();
+  if (m_root == INVALID)
+    return;
+  auto touches = [&](const Bounds &b) {
+    // distance from the center to the closest point of the box
+    Vec3 closest{std::clamp(center.x, b.min.x, b.max.x),
+                 std::clamp(center.y, b.min.y, b.max.y),
+                 std::clamp(center.z, b.min.z, b.max.z)};
+    Vec3 d = closest - center;
+    return dot(d, d) <= radius * radius;
+  };
+  std::vector<std::uint32_t> stack{m_root};
+  while (!stack.empty()) {
+    std::uint32_t index = stack.back();
+    stack.pop_back();
+    const Node &node = m_nodes[index];
+    if (node.leaf()) {
+      if (touches(node.tight))
+        objects.push_back(node.object);
+    } else if (touches(node.bounds)) {
+      stack.push_back(node.children[1]);
+      stack.push_back(node.children[0]);
+    }
+  }
+}
+
+Bvh::RayHit Bvh::raycast(
+    Vec3 origin, Vec3 direction, float maxDistance,
+    const std::function<bool(std::uint32_t object, float &distance)>
+        &intersect) const {
+  RayHit hit;
+  if (m_root == INVALID)
+    return hit;
+  // 1/0 = inf keeps the slab test working for axis aligned rays
+  Vec3 inverse{1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+  float best = maxDistance;
+  std::vector<std::uint32_t> stack{m_root};
+  while (!stack.empty()) {
+    std::uint32_t index = stack.back();
+    stack.pop_back();
+    const Node &node = m_nodes[index];
+    if (node.leaf()) {
+      float t = rayBox(origin, inverse, node.tight, best);
+      if (t > best)
+        continue;
+      if (intersect && (!intersect(node.object, t) || t > best))
+        continue;
+      best = t;
+      hit = {node.object, t};
+      continue;
+    }
+    // visit the nearer child first so `best` shrinks early
+    float near[2];
+    for (int c = 0; c < 2; c++)
+      near[c] = rayBox(origin, inverse, m_nodes[node.children[c]].bounds,
+                       best);
+    int first = near[1] < near[0] ? 1 : 0;
+    if (near[1 - first] <= best)
+      stack.push_back(node.children[1 - first]);
+    if (near[first] <= best)
+      stack.push_back(node.children[first]);
+  }
+  return hit;
+}
+
+Bvh::Stats Bvh::stats() const {
+  Stats stats;
+  stats.leaves = m_leafCount;
+  if (m_root == INVALID)
+    return stats;
+  float rootArea = std::max(area(m_nodes[m_root].bounds), 1e-12f);
+  std::vector<std::pair<std::uint32_t, std::size_t>> stack{{m_root, 1}};
+  while (!stack.empty()) {
+    auto [index, depth] = stack.back();
+    stack.pop_back();
+    const Node &node = m_nodes[index];
+    stats.nodes++;
+    stats.depth = std::max(stats.depth, depth);
+    if (node.leaf())
+      continue;
+    stats.sahCost += area(node.bounds) / rootArea;
+    stack.push_back({node.children[0], depth + 1});
+    stack.push_back({node.children[1], depth + 1});
+  }
+  return stats;
+}
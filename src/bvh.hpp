@@ -0,0 +1,118 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "culling.hpp"
+#include "linear_math.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Dynamic bounding volume hierarchy over scene objects, one object per leaf.
+//
+// Objects are inserted incrementally (branch and bound search for the
+// sibling that grows the tree's surface area the least) or all at once with
+// rebuild(), a binned surface area heuristic build. Leaves keep a box
+// enlarged by `margin` so small moves don't touch the tree at all; bigger
+// ones grow the ancestors on the way up. refit() tightens every box again,
+// rebuild() also restores the tree quality after lots of movement.
+//
+// Queries test the exact object boxes at the leaves, so the results don't
+// depend on the margin. Callers hold proxies rather than node indices, which
+// lets rebuild() lay the nodes out depth first, one cache line each, so a
+// traversal mostly walks forward through memory.
+class Bvh {
+public:
+  static constexpr std::uint32_t INVALID = 0xFFFFFFFF;
+
+  struct RayHit {
+    std::uint32_t object = INVALID;
+    float distance = 0.0f;
+  };
+
+  struct Stats {
+    std::size_t leaves = 0;
+    std::size_t nodes = 0;
+    std::size_t depth = 0;
+    // sum of internal node areas relative to the root, lower is better
+    float sahCost = 0.0f;
+  };
+
+  explicit Bvh(float margin = 0.1f);
+
+  // returns a proxy id, stable until the object is removed
+  std::uint32_t insert(const Bounds &bounds, std::uint32_t object);
+  void remove(std::uint32_t proxy);
+  // returns true when the object left its enlarged box and the tree changed
+  bool update(std::uint32_t proxy, const Bounds &bounds);
+  void refit();
+  void rebuild();
+  void clear();
+
+  std::uint32_t object(std::uint32_t proxy) const {
+    return m_nodes[m_proxyNode[proxy]].object;
+  }
+  const Bounds &bounds(std::uint32_t proxy) const {
+    return m_nodes[m_proxyNode[proxy]].tight;
+  }
+  std::size_t size() const { return m_leafCount; }
+
+  // objects intersecting the frustum; subtrees completely inside are taken
+  // without testing their leaves
+  void queryFrustum(const Frustum &frustum,
+                    std::vector<std::uint32_t> &objects) const;
+  void queryBox(const Bounds &box, std::vector<std::uint32_t> &objects) const;
+  void querySphere(Vec3 center, float radius,
+                   std::vector<std::uint32_t> &objects) const;
+  // nearest object along the ray (direction needn't be normalized, distances
+  // are in units of it). `intersect` can refine an object whose box was hit:
+  // it returns false for a miss or sets the exact distance. Without it the
+  // box entry distance is used.
+  RayHit raycast(Vec3 origin, Vec3 direction, float maxDistance,
+                 const std::function<bool(std::uint32_t object, float &distance)>
+                     &intersect = nullptr) const;
+
+  Stats stats() const;
+
+private:
+  struct alignas(64) Node {
+    Bounds bounds; // enlarged by the margin for leaves
+    Bounds tight;  // leaves only, the exact object box
+    std::uint32_t parent = INVALID;
+    std::uint32_t children[2] = {INVALID, INVALID};
+    std::uint32_t object = INVALID;
+
+    bool leaf() const { return children[0] == INVALID; }
+  };
+
+  struct BuildItem {
+    Bounds bounds;
+    Vec3 centroid;
+    std::uint32_t proxy;
+  };
+
+  std::uint32_t allocateNode();
+  void freeNode(std::uint32_t node);
+  void insertLeaf(std::uint32_t leaf);
+  void removeLeaf(std::uint32_t leaf);
+  // recomputes the boxes from `node` up to the root
+  void refitAncestors(std::uint32_t node);
+  // appends the subtree over `items` in depth first order, taking the leaves
+  // from `previous` (the nodes before the rebuild)
+  std::uint32_t buildRange(BuildItem *items, std::size_t count,
+                           std::uint32_t parent,
+                           const std::vector<Node> &previous);
+
+  std::vector<Node> m_nodes;
+  std::vector<std::uint32_t> m_proxyNode; // leaf of every proxy or INVALID
+  std::vector<std::uint32_t> m_freeProxies;
+  // branch and bound queue of insertLeaf, kept to avoid reallocating
+  std::vector<std::pair<float, std::uint32_t>> m_insertQueue;
+  std::uint32_t m_root = INVALID;
+  std::uint32_t m_freeList = INVALID;
+  std::size_t m_leafCount = 0;
+  float m_margin;
+};
+#endif
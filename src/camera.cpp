@@ -0,0 +1,50 @@
+#include "camera.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+Camera::Camera(Vec3 position, float yaw, float pitch)
+    : m_position(position), m_yaw(yaw), m_pitch(pitch) {}
+
+void Camera::move(Vec3 local) {
+  m_position = m_position + right() * local.x +
+               Vec3{0.0f, 1.0f, 0.0f} * local.y + forward() * local.z;
+}
+
+void Camera::turn(float yaw, float pitch) {
+  const float limit = 1.55f; // ~89 degrees, lookAt breaks down at 90
+  m_yaw += yaw;
+  m_pitch = std::clamp(m_pitch + pitch, -limit, limit);
+}
+
+void Camera::setPerspective(float fovY, float aspect, float zNear,
+                            float zFar) {
+  m_fovY = fovY;
+  m_aspect = aspect;
+  m_zNear = zNear;
+  m_zFar = zFar;
+}
+
+Vec3 Camera::forward() const {
+  return {std::sin(m_yaw) * std::cos(m_pitch), std::sin(m_pitch),
+          -std::cos(m_yaw) * std::cos(m_pitch)};
+}
+
+Vec3 Camera::right() const { return {std::cos(m_yaw), 0.0f, std::sin(m_yaw)}; }
+
+Mat4 Camera::view() const {
+  return lookAt(m_position, m_position + forward(), {0.0f, 1.0f, 0.0f});
+}
+
+Mat4 Camera::projection() const {
+  return perspective(m_fovY, m_aspect, m_zNear, m_zFar);
+}
+
+Camera interpolate(const Camera &from, const Camera &to, float t) {
+  Camera camera = to;
+  camera.setPosition(from.position() + (to.position() - from.position()) * t);
+  // yaw is never wrapped, so the straight difference is the short way round
+  camera.turn((from.yaw() - to.yaw()) * (1.0f - t),
+              (from.pitch() - to.pitch()) * (1.0f - t));
+  return camera;
+}
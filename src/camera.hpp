@@ -0,0 +1,49 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "culling.hpp"
+#include "linear_math.hpp"
+
+// A fly camera: a position plus yaw/pitch in radians, right handed with y up.
+// Yaw 0 looks down -z, positive yaw turns right.
+class Camera {
+public:
+  explicit Camera(Vec3 position = {0.0f, 0.0f, 3.0f}, float yaw = 0.0f,
+                  float pitch = 0.0f);
+
+  // `local` is in camera space: x right, y world up, z forward
+  void move(Vec3 local);
+  // pitch is clamped short of straight up/down
+  void turn(float yaw, float pitch);
+  void setPosition(Vec3 position) { m_position = position; }
+  void setPerspective(float fovY, float aspect, float zNear, float zFar);
+
+  Vec3 position() const { return m_position; }
+  Vec3 forward() const;
+  Vec3 right() const;
+  float yaw() const { return m_yaw; }
+  float pitch() const { return m_pitch; }
+  float fovY() const { return m_fovY; }
+  float zNear() const { return m_zNear; }
+  float zFar() const { return m_zFar; }
+
+  Mat4 view() const;
+  Mat4 projection() const;
+  Mat4 viewProjection() const { return projection() * view(); }
+  // world space culling planes
+  Frustum frustum() const { return extractFrustum(viewProjection()); }
+
+private:
+  Vec3 m_position;
+  float m_yaw;
+  float m_pitch;
+  float m_fovY = 0.785398f; // 45 degrees
+  float m_aspect = 800.0f / 600.0f;
+  float m_zNear = 0.1f;
+  float m_zFar = 1000.0f;
+};
+
+// the camera a fraction `t` of the way from `from` to `to`, for drawing in
+// between two simulation steps; the lens is taken from `to`
+Camera interpolate(const Camera &from, const Camera &to, float t);
+#endif
@@ -0,0 +1,67 @@
+#include "command_buffer.hpp"
+
+#include <algorithm>
+#include <new>
+
+CommandBuffer::CommandBuffer(std::size_t chunkSize) : m_memory(chunkSize) {}
+
+void CommandBuffer::draw(const DrawPacket &packet) {
+  DrawPacket *copy = new (m_memory.allocate(sizeof(DrawPacket),
+                                            alignof(DrawPacket)))
+      DrawPacket(packet);
+  m_items.push_back({RenderQueue::makeNameKey(packet),
+                     static_cast<std::uint32_t>(m_packets.size())});
+  m_packets.push_back(copy);
+}
+
+void CommandBuffer::sort() { RenderQueue::radixSort(m_items, m_scratch); }
+
+void CommandBuffer::reset() {
+  // DrawPacket is trivially destructible, dropping the memory is enough
+  m_memory.reset();
+  m_packets.clear();
+  m_items.clear();
+}
+
+void mergeCommandBuffers(const CommandBuffer *const *buffers,
+                         std::size_t count,
+                         std::vector<const DrawPacket *> &packets) {
+  packets.clear();
+  // min-heap of (next key, buffer); the buffer index breaks ties so equal
+  // keys come out in buffer order
+  struct Head {
+    std::uint64_t key;
+    std::size_t buffer;
+    std::size_t next;
+  };
+  auto later = [](const Head &a, const Head &b) {
+    return a.key != b.key ? a.key > b.key : a.buffer > b.buffer;
+  };
+  std::vector<Head> heads;
+  std::size_t total = 0;
+  for (std::size_t b = 0; b < count; b++) {
+    total += buffers[b]->size();
+    if (!buffers[b]->empty())
+      heads.push_back({buffers[b]->key(0), b, 0});
+  }
+  packets.reserve(total);
+  std::make_heap(heads.begin(), heads.end(), later);
+  while (!heads.empty()) {
+    std::pop_heap(heads.begin(), heads.end(), later);
+    Head &head = heads.back();
+    const CommandBuffer &buffer = *buffers[head.buffer];
+    // take the whole run that stays ahead of the next buffer's head
+    bool last = heads.size() == 1;
+    const Head &rival = heads.front();
+    do
+      packets.push_back(&buffer.packet(head.next++));
+    while (head.next < buffer.size() &&
+           (last || later(rival, {buffer.key(head.next), head.buffer, 0})));
+    if (head.next < buffer.size()) {
+      head.key = buffer.key(head.next);
+      std::push_heap(heads.begin(), heads.end(), later);
+    } else {
+      heads.pop_back();
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include "linear_allocator.hpp"
+#include "render_queue.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Draw packets recorded off the GL thread. Recording touches neither GL nor
+// anything shared, so every worker fills its own buffer at the same time and
+// sorts it; the GL thread then merges the sorted buffers and replays them
+// (RenderQueue::replay). Packets are plain numbers, nothing here depends on
+// which API finally consumes them.
+//
+// The sort keys use RenderQueue's layout, but with the GL names cut down to
+// the key fields instead of RenderQueue's interned ids, which would need a
+// shared table. That only costs grouping once names outgrow the fields.
+class CommandBuffer {
+public:
+  explicit CommandBuffer(std::size_t chunkSize = 64 * 1024);
+
+  void draw(const DrawPacket &packet);
+  // memory that stays valid until reset(), e.g. instance data for the GL
+  // thread to upload
+  void *allocate(std::size_t size,
+                 std::size_t alignment = alignof(std::max_align_t)) {
+    return m_memory.allocate(size, alignment);
+  }
+  // orders the recorded packets by key, on the recording thread
+  void sort();
+  // forgets every packet and allocation, keeps the memory
+  void reset();
+
+  std::size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+  std::uint64_t key(std::size_t i) const { return m_items[i].key; }
+  const DrawPacket &packet(std::size_t i) const {
+    return *m_packets[m_items[i].index];
+  }
+
+  static std::uint64_t makeKey(const DrawPacket &packet);
+
+private:
+  LinearAllocator m_memory;
+  std::vector<const DrawPacket *> m_packets; // in recording order
+  std::vector<RenderQueue::SortItem> m_items;
+  std::vector<RenderQueue::SortItem> m_scratch;
+};
+
+// the packets of `count` sorted buffers in key order, ties in buffer order
+void mergeCommandBuffers(const CommandBuffer *const *buffers,
+                         std::size_t count,
+                         std::vector<const DrawPacket *> &packets);
+#endif
@@ -0,0 +1,177 @@
+#include "cpu_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// fields are atomics so the exporter may read a slot while its thread
+// rewrites it. `sequence` is a per-slot seqlock: odd while the slot is being
+// written, 2 * (event number + 1) once event number's fields are complete.
+// The exporter keeps a slot only if it reads that value both before and
+// after the fields.
+struct Event {
+  std::atomic<std::uint64_t> sequence{0};
+  std::atomic<const char *> name{nullptr};
+  std::atomic<std::uint64_t> begin{0};
+  std::atomic<std::uint64_t> end{0};
+};
+
+struct ThreadEvents {
+  std::unique_ptr<Event[]> events{new Event[CpuProfiler::EVENTS_PER_THREAD]};
+  std::atomic<std::uint64_t> written{0}; // ever, the ring keeps the newest
+  std::atomic<const char *> name{nullptr};
+  std::uint32_t id = 0;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // never shrinks, a thread's zones outlive it so they can be exported
+  // after it was joined
+  std::vector<std::unique_ptr<ThreadEvents>> threads;
+};
+
+Registry &registry() {
+  static Registry s_registry;
+  return s_registry;
+}
+
+std::atomic<bool> enabledFlag{false};
+thread_local ThreadEvents *t_events = nullptr;
+thread_local const char *t_name = nullptr;
+
+ThreadEvents &threadEvents() {
+  if (!t_events) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.push_back(std::make_unique<ThreadEvents>());
+    t_events = r.threads.back().get();
+    t_events->id = static_cast<std::uint32_t>(r.threads.size());
+    t_events->name.store(t_name, std::memory_order_release);
+  }
+  return *t_events;
+}
+
+void writeJsonString(std::ostream &out, const char *text) {
+  out << '"';
+  for (; *text; text++) {
+    if (*text == '"' || *text == '\\')
+      out << '\\';
+    if (static_cast<unsigned char>(*text) >= 0x20)
+      out << *text;
+  }
+  out << '"';
+}
+
+struct ExportedEvent {
+  const char *name;
+  std::uint64_t begin, end;
+  std::uint32_t thread;
+};
+
+} // namespace
+
+void CpuProfiler::setEnabled(bool enabled) {
+  enabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::enabled() {
+  return enabledFlag.load(std::memory_order_relaxed);
+}
+
+void CpuProfiler::setThreadName(const char *name) {
+  // the ring is only allocated once the thread records something
+  t_name = name;
+  if (t_events)
+    t_events->name.store(name, std::memory_order_release);
+}
+
+std::uint64_t CpuProfiler::now() {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+void CpuProfiler::record(const char *name, std::uint64_t begin,
+                         std::uint64_t end) {
+  ThreadEvents &thread = threadEvents();
+  std::uint64_t index = thread.written.load(std::memory_order_relaxed);
+  Event &event = thread.events[index % EVENTS_PER_THREAD];
+  event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  // the odd sequence is visible before any field is overwritten
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name.store(name, std::memory_order_relaxed);
+  event.begin.store(begin, std::memory_order_relaxed);
+  event.end.store(end, std::memory_order_relaxed);
+  event.sequence.store(2 * (index + 1), std::memory_order_release);
+  thread.written.store(index + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::writeChromeTrace(const char *path) {
+  std::vector<ExportedEvent> events;
+  std::vector<std::pair<std::uint32_t, const char *>> threadNames;
+  {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const std::unique_ptr<ThreadEvents> &thread : r.threads) {
+      std::uint64_t last = thread->written.load(std::memory_order_acquire);
+      std::uint64_t first =
+          last > EVENTS_PER_THREAD ? last - EVENTS_PER_THREAD : 0;
+      for (std::uint64_t i = first; i < last; i++) {
+        const Event &event = thread->events[i % EVENTS_PER_THREAD];
+        const std::uint64_t complete = 2 * (i + 1);
+        if (event.sequence.load(std::memory_order_acquire) != complete)
+          continue; // being rewritten, or already a newer event
+        ExportedEvent exported{event.name.load(std::memory_order_relaxed),
+                               event.begin.load(std::memory_order_relaxed),
+                               event.end.load(std::memory_order_relaxed),
+                               thread->id};
+        // the fields were read before the sequence is checked again
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence.load(std::memory_order_relaxed) == complete)
+          events.push_back(exported);
+      }
+      if (const char *name = thread->name.load(std::memory_order_acquire))
+        threadNames.push_back({thread->id, name});
+    }
+  }
+
+  std::ofstream out(path);
+  if (!out) {
+    std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+    return false;
+  }
+  std::uint64_t base = UINT64_MAX;
+  for (const ExportedEvent &event : events)
+    base = std::min(base, event.begin);
+  // microseconds with nanosecond fractions
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+  bool comma = false;
+  for (const auto &thread : threadNames) {
+    out << (comma ? ",\n" : "")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << thread.first << ",\"args\":{\"name\":";
+    writeJsonString(out, thread.second);
+    out << "}}";
+    comma = true;
+  }
+  for (const ExportedEvent &event : events) {
+    out << (comma ? ",\n" : "") << "{\"name\":";
+    writeJsonString(out, event.name ? event.name : "?");
+    out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+        << ",\"ts\":" << static_cast<double>(event.begin - base) / 1000.0
+        << ",\"dur\":"
+        << static_cast<double>(event.end - event.begin) / 1000.0 << "}";
+    comma = true;
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return static_cast<bool>(out);
+}
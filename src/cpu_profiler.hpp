@@ -0,0 +1,51 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <cstdint>
+
+// Scoped CPU zones for looking at frame timelines. Every thread writes the
+// zones it closes into its own ring buffer, so recording takes no lock and
+// never touches another thread's cache lines; the newest EVENTS_PER_THREAD
+// zones of each thread are kept. Zone names must be string literals (or
+// otherwise outlive the profiler), only the pointer is stored.
+//
+// Off until setEnabled(true), a disabled zone costs one relaxed load.
+// writeChromeTrace() dumps everything recorded as Chrome trace JSON, which
+// chrome://tracing and ui.perfetto.dev both open.
+class CpuProfiler {
+public:
+  static constexpr std::uint32_t EVENTS_PER_THREAD = 1u << 16;
+
+  static void setEnabled(bool enabled);
+  static bool enabled();
+  // shows up as the thread's track name in the trace
+  static void setThreadName(const char *name);
+
+  // nanoseconds on the steady clock
+  static std::uint64_t now();
+  static void record(const char *name, std::uint64_t begin,
+                     std::uint64_t end);
+
+  // safe while other threads record, zones overwritten during the write
+  // are left out
+  static bool writeChromeTrace(const char *path);
+};
+
+// records its lifetime as a zone
+class CpuZone {
+public:
+  explicit CpuZone(const char *name)
+      : m_name(CpuProfiler::enabled() ? name : nullptr),
+        m_begin(m_name ? CpuProfiler::now() : 0) {}
+  ~CpuZone() {
+    if (m_name)
+      CpuProfiler::record(m_name, m_begin, CpuProfiler::now());
+  }
+  CpuZone(const CpuZone &) = delete;
+  CpuZone &operator=(const CpuZone &) = delete;
+
+private:
+  const char *m_name;
+  std::uint64_t m_begin;
+};
+#endif
@@ -0,0 +1,296 @@
+#include "culling.hpp"
+
+#include <cmath>
+
+#if defined(CULLING_AVX)
+#include <immintrin.h>
+#elif defined(CULLING_SSE)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// the handful of operations the culling loops need, at the widest width
+// the build targets
+#if defined(CULLING_AVX)
+using SimdFloat = __m256;
+inline SimdFloat load(const float *p) { return _mm256_loadu_ps(p); }
+inline SimdFloat broadcast(float v) { return _mm256_set1_ps(v); }
+inline SimdFloat multiplyAdd(SimdFloat a, SimdFloat b, SimdFloat c) {
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+}
+inline SimdFloat add(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a, b); }
+inline SimdFloat notNegative(SimdFloat a) {
+  return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GE_OQ);
+}
+inline SimdFloat bitAnd(SimdFloat a, SimdFloat b) {
+  return _mm256_and_ps(a, b);
+}
+inline SimdFloat allSet() {
+  return _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+}
+inline int moveMask(SimdFloat a) { return _mm256_movemask_ps(a); }
+#elif defined(CULLING_SSE)
+using SimdFloat = __m128;
+inline SimdFloat load(const float *p) { return _mm_loadu_ps(p); }
+inline SimdFloat broadcast(float v) { return _mm_set1_ps(v); }
+inline SimdFloat multiplyAdd(SimdFloat a, SimdFloat b, SimdFloat c) {
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+inline SimdFloat add(SimdFloat a, SimdFloat b) { return _mm_add_ps(a, b); }
+inline SimdFloat notNegative(SimdFloat a) {
+  return _mm_cmpge_ps(a, _mm_setzero_ps());
+}
+inline SimdFloat bitAnd(SimdFloat a, SimdFloat b) { return _mm_and_ps(a, b); }
+inline SimdFloat allSet() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+inline int moveMask(SimdFloat a) { return _mm_movemask_ps(a); }
+#endif
+
+// appends first + k for every set bit k of `mask` without branching: every
+// slot is written, only the visible ones advance the cursor
+inline std::size_t appendVisible(int mask, std::uint32_t first,
+                                 std::uint32_t *visible, std::size_t count) {
+  for (std::uint32_t k = 0; k < CULLING_SIMD_WIDTH; k++) {
+    visible[count] = first + k;
+    count += (mask >> k) & 1;
+  }
+  return count;
+}
+
+} // namespace
+
+Frustum extractFrustum(const Mat4 &m) {
+  Frustum frustum;
+  for (int i = 0; i < 3; i++) {
+    // row 3 +- row i
+    Vec4 &lower = frustum.planes[i * 2];
+    Vec4 &upper = frustum.planes[i * 2 + 1];
+    lower = {m(3, 0) + m(i, 0), m(3, 1) + m(i, 1), m(3, 2) + m(i, 2),
+             m(3, 3) + m(i, 3)};
+    upper = {m(3, 0) - m(i, 0), m(3, 1) - m(i, 1), m(3, 2) - m(i, 2),
+             m(3, 3) - m(i, 3)};
+  }
+  for (Vec4 &plane : frustum.planes) {
+    float len = std::sqrt(plane.x * plane.x + plane.y * plane.y +
+                          plane.z * plane.z);
+    if (len > 0.0f)
+      plane = {plane.x / len, plane.y / len, plane.z / len, plane.w / len};
+  }
+  return frustum;
+}
+
+Containment classify(const Frustum &frustum, const Bounds &bounds,
+                     unsigned &planeMask) {
+  for (int p = 0; p < Frustum::PlaneCount; p++) {
+    if (!(planeMask & (1u << p)))
+      continue;
+    const Vec4 &plane = frustum.planes[p];
+    // the corners furthest along and against the plane normal
+    Vec3 positive{plane.x >= 0.0f ? bounds.max.x : bounds.min.x,
+                  plane.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                  plane.z >= 0.0f ? bounds.max.z : bounds.min.z};
+    Vec3 negative{plane.x >= 0.0f ? bounds.min.x : bounds.max.x,
+                  plane.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                  plane.z >= 0.0f ? bounds.min.z : bounds.max.z};
+    if (positive.x * plane.x + positive.y * plane.y + positive.z * plane.z +
+            plane.w <
+        0.0f)
+      return Containment::Outside;
+    if (negative.x * plane.x + negative.y * plane.y + negative.z * plane.z +
+            plane.w >=
+        0.0f)
+      planeMask &= ~(1u << p);
+  }
+  return planeMask ? Containment::Intersecting : Containment::Inside;
+}
+
+std::uint32_t CullingSet::addSphere(Vec3 center, float radius) {
+  std::uint32_t object = static_cast<std::uint32_t>(size());
+  for (std::vector<float> *component :
+       {&m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_minX, &m_minY,
+        &m_minZ, &m_maxX, &m_maxY, &m_maxZ})
+    component->push_back(0.0f);
+  setSphere(object, center, radius);
+  return object;
+}
+
+std::uint32_t CullingSet::addBox(Vec3 boundsMin, Vec3 boundsMax) {
+  std::uint32_t object = addSphere({}, 0.0f);
+  setBox(object, boundsMin, boundsMax);
+  return object;
+}
+
+void CullingSet::setSphere(std::uint32_t object, Vec3 center, float radius) {
+  m_centerX[object] = center.x;
+  m_centerY[object] = center.y;
+  m_centerZ[object] = center.z;
+  m_radius[object] = radius;
+  m_minX[object] = center.x - radius;
+  m_minY[object] = center.y - radius;
+  m_minZ[object] = center.z - radius;
+  m_maxX[object] = center.x + radius;
+  m_maxY[object] = center.y + radius;
+  m_maxZ[object] = center.z + radius;
+}
+
+void CullingSet::setBox(std::uint32_t object, Vec3 boundsMin, Vec3 boundsMax) {
+  m_minX[object] = boundsMin.x;
+  m_minY[object] = boundsMin.y;
+  m_minZ[object] = boundsMin.z;
+  m_maxX[object] = boundsMax.x;
+  m_maxY[object] = boundsMax.y;
+  m_maxZ[object] = boundsMax.z;
+  Vec3 center = (boundsMin + boundsMax) * 0.5f;
+  m_centerX[object] = center.x;
+  m_centerY[object] = center.y;
+  m_centerZ[object] = center.z;
+  m_radius[object] = length(boundsMax - center);
+}
+
+void CullingSet::remove(std::uint32_t object) {
+  for (std::vector<float> *component :
+       {&m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_minX, &m_minY,
+        &m_minZ, &m_maxX, &m_maxY, &m_maxZ}) {
+    (*component)[object] = component->back();
+    component->pop_back();
+  }
+}
+
+void CullingSet::clear() {
+  for (std::vector<float> *component :
+       {&m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_minX, &m_minY,
+        &m_minZ, &m_maxX, &m_maxY, &m_maxZ})
+    component->clear();
+}
+
+void CullingSet::reserve(std::size_t count) {
+  for (std::vector<float> *component :
+       {&m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_minX, &m_minY,
+        &m_minZ, &m_maxX, &m_maxY, &m_maxZ})
+    component->reserve(count);
+}
+
+std::size_t CullingSet::cullSpheresTail(const Frustum &frustum,
+                                        std::size_t first, std::size_t last,
+                                        std::uint32_t *visible,
+                                        std::size_t count) const {
+  for (std::size_t i = first; i < last; i++) {
+    bool inside = true;
+    // same operation order as the vector loop, so both agree to the bit
+    for (const Vec4 &p : frustum.planes) {
+      float d = m_centerX[i] * p.x + (p.w + m_radius[i]);
+      d = m_centerY[i] * p.y + d;
+      d = m_centerZ[i] * p.z + d;
+      inside &= d >= 0.0f;
+    }
+    visible[count] = static_cast<std::uint32_t>(i);
+    count += inside;
+  }
+  return count;
+}
+
+std::size_t CullingSet::cullBoxesTail(const Frustum &frustum,
+                                      std::size_t first,
+                                      std::uint32_t *visible,
+                                      std::size_t count) const {
+  for (std::size_t i = first; i < size(); i++) {
+    bool inside = true;
+    // the corner furthest along the plane normal decides
+    for (const Vec4 &p : frustum.planes) {
+      float d = (p.x >= 0.0f ? m_maxX[i] : m_minX[i]) * p.x + p.w;
+      d = (p.y >= 0.0f ? m_maxY[i] : m_minY[i]) * p.y + d;
+      d = (p.z >= 0.0f ? m_maxZ[i] : m_minZ[i]) * p.z + d;
+      inside &= d >= 0.0f;
+    }
+    visible[count] = static_cast<std::uint32_t>(i);
+    count += inside;
+  }
+  return count;
+}
+
+void CullingSet::cullSpheresScalar(const Frustum &frustum,
+                                   std::vector<std::uint32_t> &visible) const {
+  visible.resize(size());
+  visible.resize(cullSpheresTail(frustum, 0, size(), visible.data(), 0));
+}
+
+void CullingSet::cullBoxesScalar(const Frustum &frustum,
+                                 std::vector<std::uint32_t> &visible) const {
+  visible.resize(size());
+  visible.resize(cullBoxesTail(frustum, 0, visible.data(), 0));
+}
+
+void CullingSet::cullSpheres(const Frustum &frustum,
+                             std::vector<std::uint32_t> &visible) const {
+  visible.resize(size());
+  visible.resize(cullSpheres(frustum, 0, size(), visible.data()));
+}
+
+std::size_t CullingSet::cullSpheres(const Frustum &frustum, std::size_t first,
+                                    std::size_t last,
+                                    std::uint32_t *visible) const {
+  std::size_t count = 0;
+  std::size_t i = first;
+#if defined(CULLING_AVX) || defined(CULLING_SSE)
+  SimdFloat planes[Frustum::PlaneCount][4];
+  for (int p = 0; p < Frustum::PlaneCount; p++) {
+    planes[p][0] = broadcast(frustum.planes[p].x);
+    planes[p][1] = broadcast(frustum.planes[p].y);
+    planes[p][2] = broadcast(frustum.planes[p].z);
+    planes[p][3] = broadcast(frustum.planes[p].w);
+  }
+  // slots before `count` are final and the cursor never passes `i - first`,
+  // so the whole block can be written without bounds checks
+  for (; i + CULLING_SIMD_WIDTH <= last; i += CULLING_SIMD_WIDTH) {
+    SimdFloat x = load(&m_centerX[i]);
+    SimdFloat y = load(&m_centerY[i]);
+    SimdFloat z = load(&m_centerZ[i]);
+    SimdFloat r = load(&m_radius[i]);
+    SimdFloat inside = allSet();
+    for (int p = 0; p < Frustum::PlaneCount; p++) {
+      SimdFloat d = multiplyAdd(x, planes[p][0], add(planes[p][3], r));
+      d = multiplyAdd(y, planes[p][1], d);
+      d = multiplyAdd(z, planes[p][2], d);
+      inside = bitAnd(inside, notNegative(d));
+    }
+    count = appendVisible(moveMask(inside), static_cast<std::uint32_t>(i),
+                          visible, count);
+  }
+#endif
+  return cullSpheresTail(frustum, i, last, visible, count);
+}
+
+void CullingSet::cullBoxes(const Frustum &frustum,
+                           std::vector<std::uint32_t> &visible) const {
+  visible.resize(size());
+  std::size_t count = 0;
+  std::size_t i = 0;
+#if defined(CULLING_AVX) || defined(CULLING_SSE)
+  // per plane: its coefficients and which side of each box they look at
+  SimdFloat planes[Frustum::PlaneCount][4];
+  const float *corner[Frustum::PlaneCount][3];
+  for (int p = 0; p < Frustum::PlaneCount; p++) {
+    const Vec4 &plane = frustum.planes[p];
+    planes[p][0] = broadcast(plane.x);
+    planes[p][1] = broadcast(plane.y);
+    planes[p][2] = broadcast(plane.z);
+    planes[p][3] = broadcast(plane.w);
+    corner[p][0] = plane.x >= 0.0f ? m_maxX.data() : m_minX.data();
+    corner[p][1] = plane.y >= 0.0f ? m_maxY.data() : m_minY.data();
+    corner[p][2] = plane.z >= 0.0f ? m_maxZ.data() : m_minZ.data();
+  }
+  for (; i + CULLING_SIMD_WIDTH <= size(); i += CULLING_SIMD_WIDTH) {
+    SimdFloat inside = allSet();
+    for (int p = 0; p < Frustum::PlaneCount; p++) {
+      SimdFloat d = multiplyAdd(load(corner[p][0] + i), planes[p][0],
+                                planes[p][3]);
+      d = multiplyAdd(load(corner[p][1] + i), planes[p][1], d);
+      d = multiplyAdd(load(corner[p][2] + i), planes[p][2], d);
+      inside = bitAnd(inside, notNegative(d));
+    }
+    count = appendVisible(moveMask(inside), static_cast<std::uint32_t>(i),
+                          visible.data(), count);
+  }
+#endif
+  visible.resize(cullBoxesTail(frustum, i, visible.data(), count));
+}
@@ -0,0 +1,105 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "linear_math.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// objects tested per instruction by the vectorized culling loops
+#if defined(__AVX__)
+#define CULLING_AVX
+static constexpr std::size_t CULLING_SIMD_WIDTH = 8;
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE
+static constexpr std::size_t CULLING_SIMD_WIDTH = 4;
+#else
+static constexpr std::size_t CULLING_SIMD_WIDTH = 1;
+#endif
+
+// Six normalized planes (xyz = inward normal, w = distance) so that
+// dot(normal, p) + w is the signed distance of p, positive inside
+struct Frustum {
+  enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+  Vec4 planes[PlaneCount];
+};
+
+// Gribb/Hartmann plane extraction from a (column-major, GL clip space)
+// view-projection matrix. With a model matrix folded in the planes come out
+// in object space.
+Frustum extractFrustum(const Mat4 &viewProjection);
+
+// Axis aligned box
+struct Bounds {
+  Vec3 min;
+  Vec3 max;
+};
+
+enum class Containment { Outside, Intersecting, Inside };
+
+static constexpr unsigned ALL_FRUSTUM_PLANES = (1u << Frustum::PlaneCount) - 1;
+
+// tests `bounds` against the planes whose bit is set in `planeMask` and
+// clears the bits of the planes it is completely inside of, so whatever the
+// box contains can skip them (hierarchical culling)
+Containment classify(const Frustum &frustum, const Bounds &bounds,
+                     unsigned &planeMask);
+
+// Bounding volumes of many objects in structure-of-arrays layout, one array
+// per component, so the culling loops test CULLING_SIMD_WIDTH objects per
+// instruction. Every object has both a sphere and a box; whichever one
+// wasn't given is derived from the other.
+class CullingSet {
+public:
+  std::uint32_t addSphere(Vec3 center, float radius);
+  std::uint32_t addBox(Vec3 boundsMin, Vec3 boundsMax);
+  void setSphere(std::uint32_t object, Vec3 center, float radius);
+  void setBox(std::uint32_t object, Vec3 boundsMin, Vec3 boundsMax);
+  // moves the last object into the slot, like the dense arrays using this
+  void remove(std::uint32_t object);
+  void clear();
+  void reserve(std::size_t count);
+  std::size_t size() const { return m_radius.size(); }
+
+  Vec3 center(std::uint32_t object) const {
+    return {m_centerX[object], m_centerY[object], m_centerZ[object]};
+  }
+  float radius(std::uint32_t object) const { return m_radius[object]; }
+  Bounds box(std::uint32_t object) const {
+    return {{m_minX[object], m_minY[object], m_minZ[object]},
+            {m_maxX[object], m_maxY[object], m_maxZ[object]}};
+  }
+
+  // fills `visible` with the indices of the objects intersecting the
+  // frustum, in increasing order. Boxes are tighter, spheres are cheaper.
+  void cullSpheres(const Frustum &frustum,
+                   std::vector<std::uint32_t> &visible) const;
+  void cullBoxes(const Frustum &frustum,
+                 std::vector<std::uint32_t> &visible) const;
+  // spheres [first, last) only, for splitting across threads: writes the
+  // visible indices to visible[0...] (room for last - first) and returns
+  // how many
+  std::size_t cullSpheres(const Frustum &frustum, std::size_t first,
+                          std::size_t last, std::uint32_t *visible) const;
+
+  // one object at a time, the reference the vector paths must match
+  void cullSpheresScalar(const Frustum &frustum,
+                         std::vector<std::uint32_t> &visible) const;
+  void cullBoxesScalar(const Frustum &frustum,
+                       std::vector<std::uint32_t> &visible) const;
+
+private:
+  // scalar tests of [first, last), appended at visible[count]
+  std::size_t cullSpheresTail(const Frustum &frustum, std::size_t first,
+                              std::size_t last, std::uint32_t *visible,
+                              std::size_t count) const;
+  std::size_t cullBoxesTail(const Frustum &frustum, std::size_t first,
+                            std::uint32_t *visible, std::size_t count) const;
+
+  std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+  std::vector<float> m_minX, m_minY, m_minZ;
+  std::vector<float> m_maxX, m_maxY, m_maxZ;
+};
+#endif
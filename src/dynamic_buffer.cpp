@@ -0,0 +1,122 @@
+#include "dynamic_buffer.hpp"
+
+#include "frame_stats.hpp"
+#include "gl_debug.hpp"
+#include "gl_extensions.hpp"
+
+#include <chrono>
+#include <iostream>
+
+DynamicBuffer::DynamicBuffer(GLenum target, GLsizeiptr bytesPerFrame)
+    : m_target(target), m_frameSize(bytesPerFrame) {
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(m_target, m_buffer);
+  labelGLObject(GL_BUFFER, m_buffer, "dynamic buffer");
+  if (glExt.persistentMapping) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glExt.bufferStorage(m_target, m_frameSize * FRAME_COUNT, nullptr, flags);
+    m_mapping = static_cast<unsigned char *>(
+        glMapBufferRange(m_target, 0, m_frameSize * FRAME_COUNT, flags));
+    if (!m_mapping) {
+      // the storage is immutable now, glBufferData would fail on it; start
+      // over with a fresh buffer for the orphaning path
+      std::cout << "ERROR::DYNAMIC_BUFFER::PERSISTENT_MAP_FAILED" << std::endl;
+      glDeleteBuffers(1, &m_buffer);
+      glGenBuffers(1, &m_buffer);
+      glBindBuffer(m_target, m_buffer);
+      labelGLObject(GL_BUFFER, m_buffer, "dynamic buffer");
+    }
+  }
+  if (!m_mapping) {
+    glBufferData(m_target, m_frameSize, nullptr, GL_STREAM_DRAW);
+    m_staging.resize(m_frameSize);
+  }
+}
+
+DynamicBuffer::~DynamicBuffer() {
+  for (GLsync fence : m_fences)
+    if (fence)
+      glDeleteSync(fence);
+  if (m_mapping) {
+    glBindBuffer(m_target, m_buffer);
+    glUnmapBuffer(m_target);
+  }
+  glDeleteBuffers(1, &m_buffer);
+}
+
+void DynamicBuffer::beginFrame() {
+  m_frame = (m_frame + 1) % FRAME_COUNT;
+  m_head = 0;
+  m_committed = 0;
+  m_stats.bytesAllocated = 0;
+  m_stats.failedAllocations = 0;
+
+  if (!m_mapping) {
+    // orphan: the driver hands us fresh storage if the old is still in use
+    glBindBuffer(m_target, m_buffer);
+    glBufferData(m_target, m_frameSize, nullptr, GL_STREAM_DRAW);
+    return;
+  }
+
+  GLsync fence = m_fences[m_frame];
+  if (!fence)
+    return;
+  // the region we're about to reuse was last written FRAME_COUNT frames ago
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    auto start = std::chrono::steady_clock::now();
+    m_stats.fenceWaits++;
+    do {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000); // 1 ms per try
+    } while (status == GL_TIMEOUT_EXPIRED);
+    m_stats.fenceWaitMs += std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+  }
+  glDeleteSync(fence);
+  m_fences[m_frame] = nullptr;
+}
+
+DynamicBuffer::Allocation DynamicBuffer::allocate(GLsizeiptr size,
+                                                  GLsizeiptr alignment) {
+  GLsizeiptr start = (m_head + alignment - 1) / alignment * alignment;
+  if (start + size > m_frameSize) {
+    m_stats.failedAllocations++;
+    return {};
+  }
+  m_head = start + size;
+  m_stats.bytesAllocated = m_head;
+
+  Allocation allocation;
+  allocation.size = size;
+  if (m_mapping) {
+    allocation.offset = m_frame * m_frameSize + start;
+    allocation.data = m_mapping + allocation.offset;
+  } else {
+    allocation.offset = start;
+    allocation.data = m_staging.data() + start;
+  }
+  return allocation;
+}
+
+void DynamicBuffer::commit() {
+  // coherent mapping makes writes visible without any calls
+  if (m_mapping || m_committed == m_head)
+    return;
+  glBindBuffer(m_target, m_buffer);
+  glBufferSubData(m_target, m_committed, m_head - m_committed,
+                  m_staging.data() + m_committed);
+  countBufferUpload(static_cast<std::size_t>(m_head - m_committed));
+  m_committed = m_head;
+}
+
+void DynamicBuffer::endFrame() {
+  commit();
+  if (m_mapping) {
+    // written straight into the mapping, no call to count it at
+    countBufferUpload(static_cast<std::size_t>(m_head));
+    m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Bump allocator for transient per-frame GPU data (UI, particles, debug
+// lines, animated instances). Everything allocated is only valid until the
+// end of the frame it was allocated in.
+//
+// With ARB_buffer_storage the buffer is split into FRAME_COUNT regions and
+// mapped once, persistently and coherently. A fence is placed at the end of
+// each frame and beginFrame() waits on the fence of the region it is about
+// to reuse, so the CPU never overwrites data the GPU still reads.
+//
+// On plain GL 3.3 allocations are written to CPU memory and commit() copies
+// them into a buffer that beginFrame() orphans, letting the driver do the
+// multi-buffering for us.
+//
+// The buffer is bound to `target` behind the state cache's back, don't use
+// GL_ELEMENT_ARRAY_BUFFER here while a VAO is bound.
+//
+// Owns GL objects (buffer, fences), destroy it while its context is current.
+class DynamicBuffer {
+public:
+  static constexpr unsigned int FRAME_COUNT = 3;
+
+  struct Allocation {
+    void *data = nullptr; // write here, nullptr if the frame is out of space
+    GLintptr offset = 0;  // byte offset into buffer() to source it from
+    GLsizeiptr size = 0;
+  };
+
+  struct Stats {
+    GLsizeiptr bytesAllocated = 0; // this frame
+    unsigned int failedAllocations = 0;
+    // totals since creation: frames where the GPU was still using the region
+    // we wanted to write, and how long we blocked on them
+    unsigned int fenceWaits = 0;
+    double fenceWaitMs = 0.0;
+  };
+
+  DynamicBuffer(GLenum target, GLsizeiptr bytesPerFrame);
+  ~DynamicBuffer();
+  DynamicBuffer(const DynamicBuffer &) = delete;
+  DynamicBuffer &operator=(const DynamicBuffer &) = delete;
+
+  void beginFrame();
+  Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+  // makes everything allocated so far visible to the GPU, call before
+  // drawing from it (free with persistent mapping)
+  void commit();
+  void endFrame();
+
+  GLuint buffer() const { return m_buffer; }
+  bool persistent() const { return m_mapping != nullptr; }
+  const Stats &stats() const { return m_stats; }
+
+private:
+  GLenum m_target;
+  GLsizeiptr m_frameSize;
+  GLuint m_buffer = 0;
+  unsigned char *m_mapping = nullptr; // persistent path only
+  std::vector<unsigned char> m_staging; // orphaning path only
+  GLsync m_fences[FRAME_COUNT] = {};
+  unsigned int m_frame = 0;
+  GLsizeiptr m_head = 0;      // bytes allocated in the current frame
+  GLsizeiptr m_committed = 0; // bytes already copied to the GPU (3.3 path)
+  Stats m_stats;
+};
+#endif
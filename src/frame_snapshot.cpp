@@ -0,0 +1,20 @@
+#include "frame_snapshot.hpp"
+
+void FrameExchange::publish() {
+  // the filled slot goes in the middle, whatever was there becomes the new
+  // back slot (a stale snapshot the consumer skipped, or the one it released)
+  unsigned previous =
+      m_ready.exchange(m_back | FRESH, std::memory_order_acq_rel);
+  m_back = previous & ~FRESH;
+}
+
+const FrameSnapshot *FrameExchange::acquire(bool *fresh) {
+  bool swapped = m_ready.load(std::memory_order_relaxed) & FRESH;
+  if (swapped) {
+    m_front = m_ready.exchange(m_front, std::memory_order_acq_rel) & ~FRESH;
+    m_published = true;
+  }
+  if (fresh)
+    *fresh = swapped;
+  return m_published ? &m_slots[m_front] : nullptr;
+}
@@ -0,0 +1,66 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+#include "camera.hpp"
+#include "instancing.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Everything the render thread needs to draw one simulated frame. The
+// simulation thread fills it in, after publishing it is read-only until it
+// comes back around. Slots are reused, so the vectors keep their capacity.
+struct FrameSnapshot {
+  std::uint64_t frame = 0; // simulation step that produced it
+  double time = 0.0;       // simulation clock at that step
+  double step = 0.0;       // fixed step length, seconds
+
+  // the camera after this step and the one before it, the render thread
+  // draws in between by how far its clock is past `time`
+  Camera camera;
+  Camera previousCamera;
+
+  // what to draw
+  bool wireframe = false;
+  bool showInstances = false;
+  bool showBatch = false;
+  bool showMesh = false;
+  bool treeCulling = false;
+
+  // sphere field: the visible instances grouped by LOD, finest first
+  std::vector<InstanceData> fieldInstances;
+  std::vector<std::size_t> lodCounts;
+  std::size_t fieldSize = 0;
+  std::size_t occludedCount = 0;
+
+  // the animated instance grid
+  std::vector<InstanceData> gridInstances;
+};
+
+// Triple buffer between one producer and one consumer. The producer fills
+// back() and publishes it, the consumer acquires the newest published
+// snapshot. Neither ever waits for the slot the other one is using; a
+// consumer with nothing new just keeps the snapshot it has, a producer
+// ahead of the consumer overwrites the snapshot nobody took.
+class FrameExchange {
+public:
+  // producer side
+  FrameSnapshot &back() { return m_slots[m_back]; }
+  void publish();
+
+  // consumer side: the newest snapshot, swapped in when one was published
+  // since the last call; nullptr before the first publish
+  const FrameSnapshot *acquire(bool *fresh = nullptr);
+
+private:
+  static constexpr unsigned FRESH = 4; // m_ready holds a slot index | FRESH
+
+  FrameSnapshot m_slots[3];
+  unsigned m_back = 0;  // producer only
+  unsigned m_front = 1; // consumer only
+  std::atomic<unsigned> m_ready{2};
+  bool m_published = false; // consumer only, something was acquired
+};
+#endif
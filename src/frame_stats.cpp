@@ -0,0 +1,163 @@
+#include "frame_stats.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+std::atomic<std::uint64_t> bufferUploads{0};
+std::atomic<std::uint64_t> textureUploads{0};
+
+} // namespace
+
+std::string formatFrameStats(const FrameStats &s) {
+  char text[512];
+  std::snprintf(
+      text, sizeof(text),
+      "FPS %.0f (%.2f MS)  CPU %.2f MS  GPU %.2f MS  LATENCY %.2f MS\n"
+      "DRAWS %u  PACKETS %u  TRIANGLES %llu\n"
+      "STATE CHANGES %u  CALLS %u  ELIDED %u\n"
+      "UPLOADS: BUFFERS %.1f KB  TEXTURES %.1f KB",
+      s.frameMs > 0.0 ? 1000.0 / s.frameMs : 0.0, s.frameMs, s.cpuMs, s.gpuMs,
+      s.latencyMs, s.drawCalls, s.packets,
+      static_cast<unsigned long long>(s.triangles), s.stateChanges,
+      s.stateCalls, s.stateCallsElided,
+      static_cast<double>(s.bufferUploadBytes) / 1024.0,
+      static_cast<double>(s.textureUploadBytes) / 1024.0);
+  std::string result = text;
+  // no calls counted means no intercept installed
+  if (s.glCalls > 0) {
+    std::snprintf(text, sizeof(text), "\nGL CALLS %u  IN DRIVER %.2f MS",
+                  s.glCalls, s.glMs);
+    result += text;
+  }
+  return result;
+}
+
+void countBufferUpload(std::size_t bytes) {
+  bufferUploads.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void countTextureUpload(std::size_t bytes) {
+  textureUploads.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void takeUploadCounts(std::uint64_t &bufferBytes,
+                      std::uint64_t &textureBytes) {
+  bufferBytes = bufferUploads.exchange(0, std::memory_order_relaxed);
+  textureBytes = textureUploads.exchange(0, std::memory_order_relaxed);
+}
+
+FrameStatsLog::~FrameStatsLog() { closeDump(); }
+
+bool FrameStatsLog::openDump(const char *path) {
+  closeDump();
+  m_dump.open(path);
+  if (!m_dump) {
+    std::cout << "ERROR::FRAME_STATS::DUMP_NOT_OPENED " << path << std::endl;
+    return false;
+  }
+  std::size_t length = std::strlen(path);
+  m_json = length >= 5 && std::strcmp(path + length - 5, ".json") == 0;
+  m_firstRow = true;
+  if (m_json)
+    m_dump << "[\n";
+  else
+    m_dump << "frame,frame_ms,cpu_ms,gpu_ms,latency_ms,draw_calls,packets,"
+              "triangles,state_changes,state_calls,state_calls_elided,"
+              "buffer_upload_bytes,texture_upload_bytes,gl_calls,gl_ms,"
+              "perf_warnings\n";
+  return true;
+}
+
+void FrameStatsLog::closeDump() {
+  if (!m_dump.is_open())
+    return;
+  if (m_json)
+    m_dump << "\n]\n";
+  m_dump.close();
+}
+
+void FrameStatsLog::add(const FrameStats &stats) {
+  m_history[m_next] = stats;
+  m_next = (m_next + 1) % HISTORY;
+  if (m_count < HISTORY)
+    m_count++;
+
+  if (!m_dump.is_open())
+    return;
+  const FrameStats &s = stats;
+  if (m_json) {
+    m_dump << (m_firstRow ? "" : ",\n") << "{\"frame\":" << s.frame
+           << ",\"frame_ms\":" << s.frameMs << ",\"cpu_ms\":" << s.cpuMs
+           << ",\"gpu_ms\":" << s.gpuMs << ",\"latency_ms\":" << s.latencyMs
+           << ",\"draw_calls\":" << s.drawCalls << ",\"packets\":" << s.packets
+           << ",\"triangles\":" << s.triangles
+           << ",\"state_changes\":" << s.stateChanges
+           << ",\"state_calls\":" << s.stateCalls
+           << ",\"state_calls_elided\":" << s.stateCallsElided
+           << ",\"buffer_upload_bytes\":" << s.bufferUploadBytes
+           << ",\"texture_upload_bytes\":" << s.textureUploadBytes
+           << ",\"gl_calls\":" << s.glCalls << ",\"gl_ms\":" << s.glMs
+           << ",\"perf_warnings\":" << s.perfWarnings << "}";
+  } else {
+    m_dump << s.frame << ',' << s.frameMs << ',' << s.cpuMs << ',' << s.gpuMs
+           << ',' << s.latencyMs << ',' << s.drawCalls << ',' << s.packets
+           << ',' << s.triangles << ',' << s.stateChanges << ','
+           << s.stateCalls << ',' << s.stateCallsElided << ','
+           << s.bufferUploadBytes << ',' << s.textureUploadBytes << ','
+           << s.glCalls << ',' << s.glMs << ',' << s.perfWarnings << '\n';
+  }
+  m_firstRow = false;
+}
+
+const FrameStats &FrameStatsLog::latest() const {
+  return m_history[(m_next + HISTORY - 1) % HISTORY];
+}
+
+FrameStats FrameStatsLog::average() const {
+  FrameStats sum;
+  if (m_count == 0)
+    return sum;
+  // integer fields are summed wide and divided at the end
+  std::uint64_t drawCalls = 0, packets = 0, stateChanges = 0, stateCalls = 0,
+                elided = 0, glCalls = 0, perfWarnings = 0;
+  for (std::size_t i = 0; i < m_count; i++) {
+    const FrameStats &s = m_history[i];
+    sum.frameMs += s.frameMs;
+    sum.cpuMs += s.cpuMs;
+    sum.gpuMs += s.gpuMs;
+    sum.latencyMs += s.latencyMs;
+    drawCalls += s.drawCalls;
+    packets += s.packets;
+    sum.triangles += s.triangles;
+    stateChanges += s.stateChanges;
+    stateCalls += s.stateCalls;
+    elided += s.stateCallsElided;
+    sum.bufferUploadBytes += s.bufferUploadBytes;
+    sum.textureUploadBytes += s.textureUploadBytes;
+    glCalls += s.glCalls;
+    sum.glMs += s.glMs;
+    perfWarnings += s.perfWarnings;
+  }
+  double n = static_cast<double>(m_count);
+  sum.frame = latest().frame;
+  sum.frameMs /= n;
+  sum.cpuMs /= n;
+  sum.gpuMs /= n;
+  sum.latencyMs /= n;
+  sum.drawCalls = static_cast<unsigned int>(drawCalls / m_count);
+  sum.packets = static_cast<unsigned int>(packets / m_count);
+  sum.triangles /= m_count;
+  sum.stateChanges = static_cast<unsigned int>(stateChanges / m_count);
+  sum.stateCalls = static_cast<unsigned int>(stateCalls / m_count);
+  sum.stateCallsElided = static_cast<unsigned int>(elided / m_count);
+  sum.bufferUploadBytes /= m_count;
+  sum.textureUploadBytes /= m_count;
+  sum.glCalls = static_cast<unsigned int>(glCalls / m_count);
+  sum.glMs /= n;
+  sum.perfWarnings = static_cast<unsigned int>(perfWarnings / m_count);
+  return sum;
+}
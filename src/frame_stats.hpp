@@ -0,0 +1,74 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// What one rendered frame cost
+struct FrameStats {
+  std::uint64_t frame = 0;
+  double frameMs = 0.0;   // start of the previous frame to start of this one
+  double cpuMs = 0.0;     // building and submitting, waits left out
+  double gpuMs = 0.0;     // newest GPU frame time read back, a few frames old
+  double latencyMs = 0.0; // CPU submit to GPU complete, same delay
+  unsigned int drawCalls = 0;
+  unsigned int packets = 0;
+  std::uint64_t triangles = 0;
+  unsigned int stateChanges = 0; // program, texture set and VAO switches
+  unsigned int stateCalls = 0;   // that reached the driver
+  unsigned int stateCallsElided = 0;
+  std::uint64_t bufferUploadBytes = 0;
+  std::uint64_t textureUploadBytes = 0;
+  // only with the GL intercept installed
+  unsigned int glCalls = 0;
+  double glMs = 0.0; // spent inside GL calls
+  // KHR_debug performance messages, only with debug output enabled
+  unsigned int perfWarnings = 0;
+};
+
+// a few lines of text for an on-screen overlay
+std::string formatFrameStats(const FrameStats &stats);
+
+// Bytes handed to the GL, counted where the uploads happen and collected
+// once per frame by takeUploadCounts(). Any thread may count.
+void countBufferUpload(std::size_t bytes);
+void countTextureUpload(std::size_t bytes);
+// the counts since the last call
+void takeUploadCounts(std::uint64_t &bufferBytes, std::uint64_t &textureBytes);
+
+// Keeps the last HISTORY frames for display and, when a dump is open,
+// writes every frame out as it is added. A path ending in .json gets one
+// JSON array of frame objects, anything else CSV with a header row.
+class FrameStatsLog {
+public:
+  static constexpr std::size_t HISTORY = 120;
+
+  FrameStatsLog() = default;
+  ~FrameStatsLog();
+  FrameStatsLog(const FrameStatsLog &) = delete;
+  FrameStatsLog &operator=(const FrameStatsLog &) = delete;
+
+  bool openDump(const char *path);
+  // finishes the file, also done by the destructor
+  void closeDump();
+
+  void add(const FrameStats &stats);
+
+  std::size_t size() const { return m_count; }
+  // the newest frame, an empty one before the first add()
+  const FrameStats &latest() const;
+  // every field averaged over the history
+  FrameStats average() const;
+
+private:
+  FrameStats m_history[HISTORY];
+  std::size_t m_next = 0;
+  std::size_t m_count = 0;
+
+  std::ofstream m_dump;
+  bool m_json = false;
+  bool m_firstRow = true;
+};
+#endif
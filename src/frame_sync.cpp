@@ -0,0 +1,80 @@
+#include "frame_sync.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+FrameSync::FrameSync(unsigned int maxFramesInFlight) {
+  setMaxFramesInFlight(maxFramesInFlight);
+  for (Frame &frame : m_frames)
+    glGenQueries(1, &frame.query);
+}
+
+FrameSync::~FrameSync() {
+  for (Frame &frame : m_frames) {
+    if (frame.fence)
+      glDeleteSync(frame.fence);
+    glDeleteQueries(1, &frame.query);
+  }
+}
+
+void FrameSync::setMaxFramesInFlight(unsigned int frames) {
+  m_maxFrames = std::clamp(frames, 1u, MAX_FRAMES_IN_FLIGHT);
+}
+
+void FrameSync::retire() {
+  Frame &frame = m_frames[m_oldest];
+  glDeleteSync(frame.fence);
+  frame.fence = nullptr;
+  // the fence came after the timestamp, so the result is there already
+  GLuint64 completed = 0;
+  glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &completed);
+  m_stats.latencyMs =
+      static_cast<double>(static_cast<GLint64>(completed) - frame.submitted) /
+      1.0e6;
+  m_stats.averageLatencyMs =
+      m_stats.averageLatencyMs == 0.0
+          ? m_stats.latencyMs
+          : m_stats.averageLatencyMs +
+                (m_stats.latencyMs - m_stats.averageLatencyMs) / 32.0;
+  m_oldest = (m_oldest + 1) % MAX_FRAMES_IN_FLIGHT;
+  m_count--;
+}
+
+void FrameSync::beginFrame() {
+  // whatever already finished, without blocking
+  while (m_count > 0 &&
+         glClientWaitSync(m_frames[m_oldest].fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+    retire();
+
+  if (m_count >= m_maxFrames) {
+    auto start = std::chrono::steady_clock::now();
+    m_stats.waits++;
+    while (m_count >= m_maxFrames) {
+      GLenum status;
+      do {
+        status = glClientWaitSync(m_frames[m_oldest].fence,
+                                  GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  1000000); // 1 ms per try
+      } while (status == GL_TIMEOUT_EXPIRED);
+      retire();
+    }
+    m_stats.waitMs += std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  }
+  m_stats.framesInFlight = m_count;
+}
+
+void FrameSync::endFrame() {
+  // only without a beginFrame(): the ring is full, make room
+  if (m_count == MAX_FRAMES_IN_FLIGHT) {
+    glClientWaitSync(m_frames[m_oldest].fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                     GL_TIMEOUT_IGNORED);
+    retire();
+  }
+  Frame &frame = m_frames[(m_oldest + m_count) % MAX_FRAMES_IN_FLIGHT];
+  glGetInteger64v(GL_TIMESTAMP, &frame.submitted);
+  glQueryCounter(frame.query, GL_TIMESTAMP);
+  frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_count++;
+}
@@ -0,0 +1,72 @@
+#ifndef FRAME_SYNC_H
+#define FRAME_SYNC_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// Bounds how far the CPU may run ahead of the GPU. Every frame ends with a
+// fence, and beginFrame() blocks on the oldest one while maxFramesInFlight
+// frames are still unfinished, so input sampled for a frame is at most that
+// many frames old when it reaches the screen. Drivers queue 3 or more frames
+// on their own otherwise.
+//
+// Each frame also writes a GPU timestamp next to its fence. Once the fence
+// signals, the time from the CPU submitting the frame to the GPU completing
+// it is read from the GPU clock, not from when we happened to poll.
+//
+// Keep maxFramesInFlight at or below DynamicBuffer::FRAME_COUNT when the
+// frame writes into one, main clamps it to that.
+//
+// The fences and queries are GL objects, destroy it while the context is
+// current.
+class FrameSync {
+public:
+  static constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 8;
+
+  struct Stats {
+    // submit to GPU complete of the newest finished frame, and a running
+    // average over the last few dozen
+    double latencyMs = 0.0;
+    double averageLatencyMs = 0.0;
+    unsigned int framesInFlight = 0;
+    // totals since creation: frames that had to wait for the GPU, and how
+    // long they blocked
+    unsigned int waits = 0;
+    double waitMs = 0.0;
+  };
+
+  explicit FrameSync(unsigned int maxFramesInFlight = 2);
+  ~FrameSync();
+  FrameSync(const FrameSync &) = delete;
+  FrameSync &operator=(const FrameSync &) = delete;
+
+  // clamped to [1, MAX_FRAMES_IN_FLIGHT]
+  void setMaxFramesInFlight(unsigned int frames);
+  unsigned int maxFramesInFlight() const { return m_maxFrames; }
+
+  // call before recording a frame: collects finished frames and waits for
+  // the GPU if too many are queued
+  void beginFrame();
+  // call after the frame's last command (the swap)
+  void endFrame();
+
+  const Stats &stats() const { return m_stats; }
+
+private:
+  struct Frame {
+    GLsync fence = nullptr;
+    GLuint query = 0;      // GL_TIMESTAMP at the end of the frame
+    GLint64 submitted = 0; // GPU clock when the CPU submitted it
+  };
+
+  // oldest frame in flight is done: read its latency and free the slot
+  void retire();
+
+  Frame m_frames[MAX_FRAMES_IN_FLIGHT];
+  unsigned int m_maxFrames;
+  unsigned int m_oldest = 0; // ring position of the oldest frame in flight
+  unsigned int m_count = 0;  // frames in flight
+  Stats m_stats;
+};
+#endif
@@ -0,0 +1,65 @@
+#include "frame_timing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+const double MIN_MARGIN = 0.0002;
+const double MAX_MARGIN = 0.004;
+
+} // namespace
+
+double frameClock() {
+  static const std::chrono::steady_clock::time_point s_start =
+      std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       s_start)
+      .count();
+}
+
+FixedTimestep::FixedTimestep(double step, int maxSteps)
+    : m_step(step), m_maxSteps(maxSteps) {}
+
+int FixedTimestep::advance(double now) {
+  if (!m_started) {
+    m_started = true;
+    m_time = now - m_step; // one step right away
+  }
+  int steps = static_cast<int>((now - m_time) / m_step);
+  if (steps > m_maxSteps) {
+    m_time = now - m_maxSteps * m_step;
+    steps = m_maxSteps;
+  }
+  m_time += steps * m_step;
+  return std::max(steps, 0);
+}
+
+void FramePacer::sleepUntil(double deadline) {
+  double now = frameClock();
+  if (deadline - now > m_margin) {
+    double wake = deadline - m_margin;
+    std::this_thread::sleep_for(std::chrono::duration<double>(wake - now));
+    // grow to the worst lateness seen, shrink slowly when sleeps are punctual
+    double late = frameClock() - wake;
+    m_margin = std::clamp(std::max(late * 1.25, m_margin * 0.98), MIN_MARGIN,
+                          MAX_MARGIN);
+  }
+  while (frameClock() < deadline)
+    std::this_thread::yield();
+}
+
+void FramePacer::waitForNextFrame(double period) {
+  double now = frameClock();
+  if (period <= 0.0) {
+    m_next = now;
+    return;
+  }
+  m_next += period;
+  if (m_next < now) {
+    m_next = now; // missed it, start over from here
+    return;
+  }
+  sleepUntil(m_next);
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+// seconds on a monotonic clock, the same for every thread
+double frameClock();
+
+// Turns elapsed real time into whole simulation steps of a fixed length, so
+// the simulation behaves the same at any frame rate. The renderer draws
+// in between the last two steps.
+class FixedTimestep {
+public:
+  // `maxSteps` bounds the catch-up after a stall: past that the backlog is
+  // dropped and the simulation runs slow instead of spiralling
+  explicit FixedTimestep(double step, int maxSteps = 8);
+
+  // steps due by `now` (frameClock seconds); the first call starts the clock
+  int advance(double now);
+
+  double step() const { return m_step; }
+  // simulation time once the steps returned by advance() are taken
+  double time() const { return m_time; }
+  double nextStepTime() const { return m_time + m_step; }
+
+private:
+  double m_step;
+  int m_maxSteps;
+  double m_time = 0.0;
+  bool m_started = false;
+};
+
+// Precise sleeping. The OS sleep is only trusted to end within a margin of
+// the deadline, the rest is yielded away; the margin follows how late the
+// OS sleeps actually wake, so most of the wait costs no CPU.
+class FramePacer {
+public:
+  void sleepUntil(double deadline);
+  // frame cap: returns one `period` after the previous call, or at once for
+  // a period of 0. A late frame moves the schedule rather than rushing the
+  // next ones.
+  void waitForNextFrame(double period);
+
+  double margin() const { return m_margin; }
+
+private:
+  double m_next = 0.0;
+  double m_margin = 0.002;
+};
+#endif
@@ -0,0 +1,172 @@
+#include "gl_debug.hpp"
+
+#include "cpu_profiler.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace {
+
+// distinct messages kept as zone names, past this they are recorded under
+// their type only
+const std::size_t MAX_MESSAGES = 1024;
+
+std::mutex mutex;
+bool enabled = false;
+GLDebugCounts counts;
+// never shrinks, the profiler holds on to the pointers
+std::unordered_set<std::string> messages;
+
+const char *sourceName(GLenum source) {
+  switch (source) {
+  case GL_DEBUG_SOURCE_API:
+    return "API";
+  case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+    return "WINDOW_SYSTEM";
+  case GL_DEBUG_SOURCE_SHADER_COMPILER:
+    return "SHADER_COMPILER";
+  case GL_DEBUG_SOURCE_THIRD_PARTY:
+    return "THIRD_PARTY";
+  case GL_DEBUG_SOURCE_APPLICATION:
+    return "APPLICATION";
+  default:
+    return "OTHER";
+  }
+}
+
+const char *typeName(GLenum type) {
+  switch (type) {
+  case GL_DEBUG_TYPE_ERROR:
+    return "ERROR";
+  case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+    return "DEPRECATED";
+  case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+    return "UNDEFINED";
+  case GL_DEBUG_TYPE_PORTABILITY:
+    return "PORTABILITY";
+  case GL_DEBUG_TYPE_PERFORMANCE:
+    return "PERFORMANCE";
+  case GL_DEBUG_TYPE_MARKER:
+    return "MARKER";
+  default:
+    return "OTHER";
+  }
+}
+
+const char *severityName(GLenum severity) {
+  switch (severity) {
+  case GL_DEBUG_SEVERITY_HIGH:
+    return "HIGH";
+  case GL_DEBUG_SEVERITY_MEDIUM:
+    return "MEDIUM";
+  case GL_DEBUG_SEVERITY_LOW:
+    return "LOW";
+  default:
+    return "NOTIFICATION";
+  }
+}
+
+// zone names for the messages that no longer fit
+const char *typeZoneName(GLenum type) {
+  switch (type) {
+  case GL_DEBUG_TYPE_ERROR:
+    return "GL error";
+  case GL_DEBUG_TYPE_PERFORMANCE:
+    return "GL performance warning";
+  default:
+    return "GL debug message";
+  }
+}
+
+void APIENTRY onDebugMessage(GLenum source, GLenum type, GLuint id,
+                             GLenum severity, GLsizei length,
+                             const GLchar *message, const void *) {
+  std::uint64_t now = CpuProfiler::now();
+  std::string text = std::string("GL ") + typeName(type) + ": " +
+                     (length < 0 ? std::string(message)
+                                 : std::string(message, length));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  counts.messages++;
+  if (type == GL_DEBUG_TYPE_PERFORMANCE)
+    counts.performance++;
+  else if (type == GL_DEBUG_TYPE_ERROR)
+    counts.errors++;
+
+  const char *zoneName = typeZoneName(type);
+  auto found = messages.find(text);
+  if (found != messages.end()) {
+    zoneName = found->c_str();
+  } else if (messages.size() < MAX_MESSAGES) {
+    // the first time this message comes up
+    std::cout << (type == GL_DEBUG_TYPE_ERROR ? "ERROR::" : "")
+              << "GL::DEBUG::" << typeName(type) << " (" << sourceName(source)
+              << ", " << severityName(severity) << ", id " << id << ")\n"
+              << text << std::endl;
+    zoneName = messages.insert(std::move(text)).first->c_str();
+  }
+  if (CpuProfiler::enabled())
+    CpuProfiler::record(zoneName, now, CpuProfiler::now());
+}
+
+} // namespace
+
+bool enableGLDebugOutput() {
+  if (!glExt.debugOutput) {
+    std::cout << "ERROR::GL::DEBUG::KHR_DEBUG_NOT_SUPPORTED" << std::endl;
+    return false;
+  }
+  GLint flags = 0;
+  glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+  if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+    std::cout << "GL context is not a debug context, the driver may report "
+                 "less"
+              << std::endl;
+
+  glEnable(GL_DEBUG_OUTPUT);
+  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  glExt.debugMessageCallback(onDebugMessage, nullptr);
+  // everything but notifications, then performance messages back in at any
+  // severity, the later control call wins
+  glExt.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0,
+                            nullptr, GL_TRUE);
+  glExt.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
+                            GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr,
+                            GL_FALSE);
+  glExt.debugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE,
+                            GL_DONT_CARE, 0, nullptr, GL_TRUE);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  enabled = true;
+  return true;
+}
+
+bool glDebugOutputEnabled() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return enabled;
+}
+
+GLDebugCounts glDebugCounts() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return counts;
+}
+
+void labelGLObject(GLenum identifier, GLuint name, const char *label) {
+  if (!glExt.objectLabel || !label)
+    return;
+  // longer labels are an error, cut them off instead
+  static GLint s_maxLength = 0;
+  if (s_maxLength == 0)
+    glGetIntegerv(GL_MAX_LABEL_LENGTH, &s_maxLength);
+  std::size_t length = std::strlen(label);
+  if (s_maxLength > 0 && length >= static_cast<std::size_t>(s_maxLength))
+    length = static_cast<std::size_t>(s_maxLength) - 1;
+  glExt.objectLabel(identifier, name, static_cast<GLsizei>(length), label);
+}
+
+void labelGLObject(GLenum identifier, GLuint name, const std::string &label) {
+  labelGLObject(identifier, name, label.c_str());
+}
@@ -0,0 +1,38 @@
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include "gl_extensions.hpp" // the KHR_debug tokens
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+// KHR_debug output, for a context created with GLFW_OPENGL_DEBUG_CONTEXT.
+// Output is made synchronous, so the driver calls back from inside the GL
+// call that raised the message. Each distinct message is printed once, and
+// every one is recorded in the CPU profiler as a zone named by its text, so
+// it shows up in the trace next to the zone that caused it. Notifications
+// are left off, the drivers send a lot of them.
+//
+// Objects labelled with labelGLObject() are named in the messages, and in
+// GL debuggers.
+
+// call after loadGLExtensions; false if the driver has no KHR_debug
+bool enableGLDebugOutput();
+bool glDebugOutputEnabled();
+
+// messages received since enableGLDebugOutput
+struct GLDebugCounts {
+  std::uint64_t messages = 0;
+  std::uint64_t performance = 0; // GL_DEBUG_TYPE_PERFORMANCE
+  std::uint64_t errors = 0;      // GL_DEBUG_TYPE_ERROR
+};
+GLDebugCounts glDebugCounts();
+
+// `identifier` is GL_TEXTURE, GL_BUFFER, GL_PROGRAM, GL_SHADER,
+// GL_VERTEX_ARRAY, ...; the object has to have been bound (or created)
+// once. Does nothing without KHR_debug, so it may be called regardless.
+void labelGLObject(GLenum identifier, GLuint name, const char *label);
+void labelGLObject(GLenum identifier, GLuint name, const std::string &label);
+#endif
@@ -0,0 +1,55 @@
+#include "gl_extensions.hpp"
+
+#include <cstring>
+
+GLExtensions glExt;
+
+bool hasGLVersion(int major, int minor) {
+  return GLVersion.major > major ||
+         (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool hasGLExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (ext && std::strcmp(ext, name) == 0)
+      return true;
+  }
+  return false;
+}
+
+void loadGLExtensions(GLADloadproc load) {
+  glExt = GLExtensions{};
+
+  if (hasGLVersion(4, 3) || hasGLExtension("GL_ARB_multi_draw_indirect")) {
+    glExt.multiDrawElementsIndirect =
+        (PFNGLMULTIDRAWELEMENTSINDIRECTPROC_)load("glMultiDrawElementsIndirect");
+    glExt.multiDrawIndirect = glExt.multiDrawElementsIndirect != nullptr;
+  }
+
+  if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance")) {
+    glExt.drawElementsInstancedBaseVertexBaseInstance =
+        (PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC_)load(
+            "glDrawElementsInstancedBaseVertexBaseInstance");
+    glExt.baseInstance =
+        glExt.drawElementsInstancedBaseVertexBaseInstance != nullptr;
+  }
+
+  if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) {
+    glExt.bufferStorage = (PFNGLBUFFERSTORAGEPROC_)load("glBufferStorage");
+    glExt.persistentMapping = glExt.bufferStorage != nullptr;
+  }
+
+  // core KHR_debug has no suffix on desktop GL either
+  if (hasGLVersion(4, 3) || hasGLExtension("GL_KHR_debug")) {
+    glExt.debugMessageCallback =
+        (PFNGLDEBUGMESSAGECALLBACKPROC_)load("glDebugMessageCallback");
+    glExt.debugMessageControl =
+        (PFNGLDEBUGMESSAGECONTROLPROC_)load("glDebugMessageControl");
+    glExt.objectLabel = (PFNGLOBJECTLABELPROC_)load("glObjectLabel");
+    glExt.debugOutput = glExt.debugMessageCallback &&
+                        glExt.debugMessageControl && glExt.objectLabel;
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// glad was generated for plain GL 3.3 core, so anything newer is resolved
+// here by hand at runtime. Each feature has an availability flag, callers
+// check it and fall back to the 3.3 path when it is false.
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM 0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER 0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY 0x8249
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#define GL_DEBUG_SOURCE_OTHER 0x824B
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#define GL_DEBUG_TYPE_OTHER 0x8251
+#define GL_DEBUG_TYPE_MARKER 0x8268
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#define GL_BUFFER 0x82E0
+#define GL_SHADER 0x82E1
+#define GL_PROGRAM 0x82E2
+#define GL_VERTEX_ARRAY 0x8074
+#define GL_MAX_LABEL_LENGTH 0x82E8
+#endif
+
+typedef void(APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC_)(
+    GLenum mode, GLenum type, const void *indirect, GLsizei drawcount,
+    GLsizei stride);
+typedef void(APIENTRYP PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC_)(
+    GLenum mode, GLsizei count, GLenum type, const void *indices,
+    GLsizei instancecount, GLint basevertex, GLuint baseinstance);
+
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC_)(GLenum target, GLsizeiptr size,
+                                                const void *data,
+                                                GLbitfield flags);
+
+typedef void(APIENTRYP PFNGLDEBUGMESSAGECALLBACKPROC_)(GLDEBUGPROC callback,
+                                                       const void *userParam);
+typedef void(APIENTRYP PFNGLDEBUGMESSAGECONTROLPROC_)(GLenum source,
+                                                      GLenum type,
+                                                      GLenum severity,
+                                                      GLsizei count,
+                                                      const GLuint *ids,
+                                                      GLboolean enabled);
+typedef void(APIENTRYP PFNGLOBJECTLABELPROC_)(GLenum identifier, GLuint name,
+                                              GLsizei length,
+                                              const GLchar *label);
+
+struct GLExtensions {
+  // GL 4.3 / ARB_multi_draw_indirect
+  bool multiDrawIndirect = false;
+  PFNGLMULTIDRAWELEMENTSINDIRECTPROC_ multiDrawElementsIndirect = nullptr;
+  // GL 4.2 / ARB_base_instance
+  bool baseInstance = false;
+  PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC_
+      drawElementsInstancedBaseVertexBaseInstance = nullptr;
+  // GL 4.4 / ARB_buffer_storage (persistent mapping)
+  bool persistentMapping = false;
+  PFNGLBUFFERSTORAGEPROC_ bufferStorage = nullptr;
+  // GL 4.3 / KHR_debug (debug messages and object labels)
+  bool debugOutput = false;
+  PFNGLDEBUGMESSAGECALLBACKPROC_ debugMessageCallback = nullptr;
+  PFNGLDEBUGMESSAGECONTROLPROC_ debugMessageControl = nullptr;
+  PFNGLOBJECTLABELPROC_ objectLabel = nullptr;
+};
+
+extern GLExtensions glExt;
+
+// call once after gladLoadGLLoader with the same loader
+void loadGLExtensions(GLADloadproc load);
+// true if the current context is at least major.minor
+bool hasGLVersion(int major, int minor);
+// true if the current context advertises the extension
+bool hasGLExtension(const char *name);
+#endif
@@ -0,0 +1,531 @@
+#include "gl_intercept.hpp"
+
+#include "gl_extensions.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+std::vector<GLCallStats> callStats;
+bool checkGLErrors = false;
+bool installed = false;
+// the driver's glGetError, the checks must not count as calls
+PFNGLGETERRORPROC realGetError = nullptr;
+std::uint32_t getErrorId = ~0u;
+
+std::uint32_t registerCall(const char *name) {
+  callStats.push_back(GLCallStats{});
+  callStats.back().name = name;
+  return static_cast<std::uint32_t>(callStats.size() - 1);
+}
+
+// accounts for one call when it goes out of scope, after the wrapped
+// function returned
+class CallScope {
+public:
+  explicit CallScope(std::uint32_t id)
+      : m_id(id), m_start(std::chrono::steady_clock::now()) {}
+  ~CallScope() {
+    GLCallStats &stats = callStats[m_id];
+    stats.calls++;
+    stats.nanoseconds += static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start)
+            .count());
+    if (!checkGLErrors || m_id == getErrorId)
+      return;
+    GLenum error = realGetError();
+    if (error == GL_NO_ERROR)
+      return;
+    // the first few per entry point, a bad call in the loop would flood
+    if (++stats.errors <= 3)
+      std::cout << "ERROR::GL::CALL_FAILED " << stats.name << " 0x" << std::hex
+                << error << std::dec << std::endl;
+    // glGetError returns one flag per call, drain the rest
+    while (realGetError() != GL_NO_ERROR)
+      ;
+  }
+
+private:
+  std::uint32_t m_id;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// One wrapper per function pointer: `Slot` is the pointer variable, the
+// specialization picks the signature out of its type
+template <auto *Slot, typename Pointer> struct Hook;
+
+template <auto *Slot, typename Result, typename... Args>
+struct Hook<Slot, Result(APIENTRY *)(Args...)> {
+  static inline Result(APIENTRY *real)(Args...) = nullptr;
+  static inline std::uint32_t id = 0;
+
+  static Result APIENTRY call(Args... args) {
+    CallScope scope(id);
+    return real(args...);
+  }
+};
+
+template <auto *Slot> void hook(const char *name) {
+  using H = Hook<Slot, std::remove_reference_t<decltype(*Slot)>>;
+  // not loaded by this driver, or wrapped already
+  if (!*Slot || *Slot == &H::call)
+    return;
+  H::real = *Slot;
+  H::id = registerCall(name);
+  *Slot = &H::call;
+}
+
+#define GL_HOOK(name) hook<&glad_##name>(#name)
+
+void hookAll() {
+  realGetError = glad_glGetError;
+  GL_HOOK(glCullFace);
+  GL_HOOK(glFrontFace);
+  GL_HOOK(glHint);
+  GL_HOOK(glLineWidth);
+  GL_HOOK(glPointSize);
+  GL_HOOK(glPolygonMode);
+  GL_HOOK(glScissor);
+  GL_HOOK(glTexParameterf);
+  GL_HOOK(glTexParameterfv);
+  GL_HOOK(glTexParameteri);
+  GL_HOOK(glTexParameteriv);
+  GL_HOOK(glTexImage1D);
+  GL_HOOK(glTexImage2D);
+  GL_HOOK(glDrawBuffer);
+  GL_HOOK(glClear);
+  GL_HOOK(glClearColor);
+  GL_HOOK(glClearStencil);
+  GL_HOOK(glClearDepth);
+  GL_HOOK(glStencilMask);
+  GL_HOOK(glColorMask);
+  GL_HOOK(glDepthMask);
+  GL_HOOK(glDisable);
+  GL_HOOK(glEnable);
+  GL_HOOK(glFinish);
+  GL_HOOK(glFlush);
+  GL_HOOK(glBlendFunc);
+  GL_HOOK(glLogicOp);
+  GL_HOOK(glStencilFunc);
+  GL_HOOK(glStencilOp);
+  GL_HOOK(glDepthFunc);
+  GL_HOOK(glPixelStoref);
+  GL_HOOK(glPixelStorei);
+  GL_HOOK(glReadBuffer);
+  GL_HOOK(glReadPixels);
+  GL_HOOK(glGetBooleanv);
+  GL_HOOK(glGetDoublev);
+  GL_HOOK(glGetError);
+  GL_HOOK(glGetFloatv);
+  GL_HOOK(glGetIntegerv);
+  GL_HOOK(glGetString);
+  GL_HOOK(glGetTexImage);
+  GL_HOOK(glGetTexParameterfv);
+  GL_HOOK(glGetTexParameteriv);
+  GL_HOOK(glGetTexLevelParameterfv);
+  GL_HOOK(glGetTexLevelParameteriv);
+  GL_HOOK(glIsEnabled);
+  GL_HOOK(glDepthRange);
+  GL_HOOK(glViewport);
+  GL_HOOK(glDrawArrays);
+  GL_HOOK(glDrawElements);
+  GL_HOOK(glPolygonOffset);
+  GL_HOOK(glCopyTexImage1D);
+  GL_HOOK(glCopyTexImage2D);
+  GL_HOOK(glCopyTexSubImage1D);
+  GL_HOOK(glCopyTexSubImage2D);
+  GL_HOOK(glTexSubImage1D);
+  GL_HOOK(glTexSubImage2D);
+  GL_HOOK(glBindTexture);
+  GL_HOOK(glDeleteTextures);
+  GL_HOOK(glGenTextures);
+  GL_HOOK(glIsTexture);
+  GL_HOOK(glDrawRangeElements);
+  GL_HOOK(glTexImage3D);
+  GL_HOOK(glTexSubImage3D);
+  GL_HOOK(glCopyTexSubImage3D);
+  GL_HOOK(glActiveTexture);
+  GL_HOOK(glSampleCoverage);
+  GL_HOOK(glCompressedTexImage3D);
+  GL_HOOK(glCompressedTexImage2D);
+  GL_HOOK(glCompressedTexImage1D);
+  GL_HOOK(glCompressedTexSubImage3D);
+  GL_HOOK(glCompressedTexSubImage2D);
+  GL_HOOK(glCompressedTexSubImage1D);
+  GL_HOOK(glGetCompressedTexImage);
+  GL_HOOK(glBlendFuncSeparate);
+  GL_HOOK(glMultiDrawArrays);
+  GL_HOOK(glMultiDrawElements);
+  GL_HOOK(glPointParameterf);
+  GL_HOOK(glPointParameterfv);
+  GL_HOOK(glPointParameteri);
+  GL_HOOK(glPointParameteriv);
+  GL_HOOK(glBlendColor);
+  GL_HOOK(glBlendEquation);
+  GL_HOOK(glGenQueries);
+  GL_HOOK(glDeleteQueries);
+  GL_HOOK(glIsQuery);
+  GL_HOOK(glBeginQuery);
+  GL_HOOK(glEndQuery);
+  GL_HOOK(glGetQueryiv);
+  GL_HOOK(glGetQueryObjectiv);
+  GL_HOOK(glGetQueryObjectuiv);
+  GL_HOOK(glBindBuffer);
+  GL_HOOK(glDeleteBuffers);
+  GL_HOOK(glGenBuffers);
+  GL_HOOK(glIsBuffer);
+  GL_HOOK(glBufferData);
+  GL_HOOK(glBufferSubData);
+  GL_HOOK(glGetBufferSubData);
+  GL_HOOK(glMapBuffer);
+  GL_HOOK(glUnmapBuffer);
+  GL_HOOK(glGetBufferParameteriv);
+  GL_HOOK(glGetBufferPointerv);
+  GL_HOOK(glBlendEquationSeparate);
+  GL_HOOK(glDrawBuffers);
+  GL_HOOK(glStencilOpSeparate);
+  GL_HOOK(glStencilFuncSeparate);
+  GL_HOOK(glStencilMaskSeparate);
+  GL_HOOK(glAttachShader);
+  GL_HOOK(glBindAttribLocation);
+  GL_HOOK(glCompileShader);
+  GL_HOOK(glCreateProgram);
+  GL_HOOK(glCreateShader);
+  GL_HOOK(glDeleteProgram);
+  GL_HOOK(glDeleteShader);
+  GL_HOOK(glDetachShader);
+  GL_HOOK(glDisableVertexAttribArray);
+  GL_HOOK(glEnableVertexAttribArray);
+  GL_HOOK(glGetActiveAttrib);
+  GL_HOOK(glGetActiveUniform);
+  GL_HOOK(glGetAttachedShaders);
+  GL_HOOK(glGetAttribLocation);
+  GL_HOOK(glGetProgramiv);
+  GL_HOOK(glGetProgramInfoLog);
+  GL_HOOK(glGetShaderiv);
+  GL_HOOK(glGetShaderInfoLog);
+  GL_HOOK(glGetShaderSource);
+  GL_HOOK(glGetUniformLocation);
+  GL_HOOK(glGetUniformfv);
+  GL_HOOK(glGetUniformiv);
+  GL_HOOK(glGetVertexAttribdv);
+  GL_HOOK(glGetVertexAttribfv);
+  GL_HOOK(glGetVertexAttribiv);
+  GL_HOOK(glGetVertexAttribPointerv);
+  GL_HOOK(glIsProgram);
+  GL_HOOK(glIsShader);
+  GL_HOOK(glLinkProgram);
+  GL_HOOK(glShaderSource);
+  GL_HOOK(glUseProgram);
+  GL_HOOK(glUniform1f);
+  GL_HOOK(glUniform2f);
+  GL_HOOK(glUniform3f);
+  GL_HOOK(glUniform4f);
+  GL_HOOK(glUniform1i);
+  GL_HOOK(glUniform2i);
+  GL_HOOK(glUniform3i);
+  GL_HOOK(glUniform4i);
+  GL_HOOK(glUniform1fv);
+  GL_HOOK(glUniform2fv);
+  GL_HOOK(glUniform3fv);
+  GL_HOOK(glUniform4fv);
+  GL_HOOK(glUniform1iv);
+  GL_HOOK(glUniform2iv);
+  GL_HOOK(glUniform3iv);
+  GL_HOOK(glUniform4iv);
+  GL_HOOK(glUniformMatrix2fv);
+  GL_HOOK(glUniformMatrix3fv);
+  GL_HOOK(glUniformMatrix4fv);
+  GL_HOOK(glValidateProgram);
+  GL_HOOK(glVertexAttrib1d);
+  GL_HOOK(glVertexAttrib1dv);
+  GL_HOOK(glVertexAttrib1f);
+  GL_HOOK(glVertexAttrib1fv);
+  GL_HOOK(glVertexAttrib1s);
+  GL_HOOK(glVertexAttrib1sv);
+  GL_HOOK(glVertexAttrib2d);
+  GL_HOOK(glVertexAttrib2dv);
+  GL_HOOK(glVertexAttrib2f);
+  GL_HOOK(glVertexAttrib2fv);
+  GL_HOOK(glVertexAttrib2s);
+  GL_HOOK(glVertexAttrib2sv);
+  GL_HOOK(glVertexAttrib3d);
+  GL_HOOK(glVertexAttrib3dv);
+  GL_HOOK(glVertexAttrib3f);
+  GL_HOOK(glVertexAttrib3fv);
+  GL_HOOK(glVertexAttrib3s);
+  GL_HOOK(glVertexAttrib3sv);
+  GL_HOOK(glVertexAttrib4Nbv);
+  GL_HOOK(glVertexAttrib4Niv);
+  GL_HOOK(glVertexAttrib4Nsv);
+  GL_HOOK(glVertexAttrib4Nub);
+  GL_HOOK(glVertexAttrib4Nubv);
+  GL_HOOK(glVertexAttrib4Nuiv);
+  GL_HOOK(glVertexAttrib4Nusv);
+  GL_HOOK(glVertexAttrib4bv);
+  GL_HOOK(glVertexAttrib4d);
+  GL_HOOK(glVertexAttrib4dv);
+  GL_HOOK(glVertexAttrib4f);
+  GL_HOOK(glVertexAttrib4fv);
+  GL_HOOK(glVertexAttrib4iv);
+  GL_HOOK(glVertexAttrib4s);
+  GL_HOOK(glVertexAttrib4sv);
+  GL_HOOK(glVertexAttrib4ubv);
+  GL_HOOK(glVertexAttrib4uiv);
+  GL_HOOK(glVertexAttrib4usv);
+  GL_HOOK(glVertexAttribPointer);
+  GL_HOOK(glUniformMatrix2x3fv);
+  GL_HOOK(glUniformMatrix3x2fv);
+  GL_HOOK(glUniformMatrix2x4fv);
+  GL_HOOK(glUniformMatrix4x2fv);
+  GL_HOOK(glUniformMatrix3x4fv);
+  GL_HOOK(glUniformMatrix4x3fv);
+  GL_HOOK(glColorMaski);
+  GL_HOOK(glGetBooleani_v);
+  GL_HOOK(glGetIntegeri_v);
+  GL_HOOK(glEnablei);
+  GL_HOOK(glDisablei);
+  GL_HOOK(glIsEnabledi);
+  GL_HOOK(glBeginTransformFeedback);
+  GL_HOOK(glEndTransformFeedback);
+  GL_HOOK(glBindBufferRange);
+  GL_HOOK(glBindBufferBase);
+  GL_HOOK(glTransformFeedbackVaryings);
+  GL_HOOK(glGetTransformFeedbackVarying);
+  GL_HOOK(glClampColor);
+  GL_HOOK(glBeginConditionalRender);
+  GL_HOOK(glEndConditionalRender);
+  GL_HOOK(glVertexAttribIPointer);
+  GL_HOOK(glGetVertexAttribIiv);
+  GL_HOOK(glGetVertexAttribIuiv);
+  GL_HOOK(glVertexAttribI1i);
+  GL_HOOK(glVertexAttribI2i);
+  GL_HOOK(glVertexAttribI3i);
+  GL_HOOK(glVertexAttribI4i);
+  GL_HOOK(glVertexAttribI1ui);
+  GL_HOOK(glVertexAttribI2ui);
+  GL_HOOK(glVertexAttribI3ui);
+  GL_HOOK(glVertexAttribI4ui);
+  GL_HOOK(glVertexAttribI1iv);
+  GL_HOOK(glVertexAttribI2iv);
+  GL_HOOK(glVertexAttribI3iv);
+  GL_HOOK(glVertexAttribI4iv);
+  GL_HOOK(glVertexAttribI1uiv);
+  GL_HOOK(glVertexAttribI2uiv);
+  GL_HOOK(glVertexAttribI3uiv);
+  GL_HOOK(glVertexAttribI4uiv);
+  GL_HOOK(glVertexAttribI4bv);
+  GL_HOOK(glVertexAttribI4sv);
+  GL_HOOK(glVertexAttribI4ubv);
+  GL_HOOK(glVertexAttribI4usv);
+  GL_HOOK(glGetUniformuiv);
+  GL_HOOK(glBindFragDataLocation);
+  GL_HOOK(glGetFragDataLocation);
+  GL_HOOK(glUniform1ui);
+  GL_HOOK(glUniform2ui);
+  GL_HOOK(glUniform3ui);
+  GL_HOOK(glUniform4ui);
+  GL_HOOK(glUniform1uiv);
+  GL_HOOK(glUniform2uiv);
+  GL_HOOK(glUniform3uiv);
+  GL_HOOK(glUniform4uiv);
+  GL_HOOK(glTexParameterIiv);
+  GL_HOOK(glTexParameterIuiv);
+  GL_HOOK(glGetTexParameterIiv);
+  GL_HOOK(glGetTexParameterIuiv);
+  GL_HOOK(glClearBufferiv);
+  GL_HOOK(glClearBufferuiv);
+  GL_HOOK(glClearBufferfv);
+  GL_HOOK(glClearBufferfi);
+  GL_HOOK(glGetStringi);
+  GL_HOOK(glIsRenderbuffer);
+  GL_HOOK(glBindRenderbuffer);
+  GL_HOOK(glDeleteRenderbuffers);
+  GL_HOOK(glGenRenderbuffers);
+  GL_HOOK(glRenderbufferStorage);
+  GL_HOOK(glGetRenderbufferParameteriv);
+  GL_HOOK(glIsFramebuffer);
+  GL_HOOK(glBindFramebuffer);
+  GL_HOOK(glDeleteFramebuffers);
+  GL_HOOK(glGenFramebuffers);
+  GL_HOOK(glCheckFramebufferStatus);
+  GL_HOOK(glFramebufferTexture1D);
+  GL_HOOK(glFramebufferTexture2D);
+  GL_HOOK(glFramebufferTexture3D);
+  GL_HOOK(glFramebufferRenderbuffer);
+  GL_HOOK(glGetFramebufferAttachmentParameteriv);
+  GL_HOOK(glGenerateMipmap);
+  GL_HOOK(glBlitFramebuffer);
+  GL_HOOK(glRenderbufferStorageMultisample);
+  GL_HOOK(glFramebufferTextureLayer);
+  GL_HOOK(glMapBufferRange);
+  GL_HOOK(glFlushMappedBufferRange);
+  GL_HOOK(glBindVertexArray);
+  GL_HOOK(glDeleteVertexArrays);
+  GL_HOOK(glGenVertexArrays);
+  GL_HOOK(glIsVertexArray);
+  GL_HOOK(glDrawArraysInstanced);
+  GL_HOOK(glDrawElementsInstanced);
+  GL_HOOK(glTexBuffer);
+  GL_HOOK(glPrimitiveRestartIndex);
+  GL_HOOK(glCopyBufferSubData);
+  GL_HOOK(glGetUniformIndices);
+  GL_HOOK(glGetActiveUniformsiv);
+  GL_HOOK(glGetActiveUniformName);
+  GL_HOOK(glGetUniformBlockIndex);
+  GL_HOOK(glGetActiveUniformBlockiv);
+  GL_HOOK(glGetActiveUniformBlockName);
+  GL_HOOK(glUniformBlockBinding);
+  GL_HOOK(glDrawElementsBaseVertex);
+  GL_HOOK(glDrawRangeElementsBaseVertex);
+  GL_HOOK(glDrawElementsInstancedBaseVertex);
+  GL_HOOK(glMultiDrawElementsBaseVertex);
+  GL_HOOK(glProvokingVertex);
+  GL_HOOK(glFenceSync);
+  GL_HOOK(glIsSync);
+  GL_HOOK(glDeleteSync);
+  GL_HOOK(glClientWaitSync);
+  GL_HOOK(glWaitSync);
+  GL_HOOK(glGetInteger64v);
+  GL_HOOK(glGetSynciv);
+  GL_HOOK(glGetInteger64i_v);
+  GL_HOOK(glGetBufferParameteri64v);
+  GL_HOOK(glFramebufferTexture);
+  GL_HOOK(glTexImage2DMultisample);
+  GL_HOOK(glTexImage3DMultisample);
+  GL_HOOK(glGetMultisamplefv);
+  GL_HOOK(glSampleMaski);
+  GL_HOOK(glBindFragDataLocationIndexed);
+  GL_HOOK(glGetFragDataIndex);
+  GL_HOOK(glGenSamplers);
+  GL_HOOK(glDeleteSamplers);
+  GL_HOOK(glIsSampler);
+  GL_HOOK(glBindSampler);
+  GL_HOOK(glSamplerParameteri);
+  GL_HOOK(glSamplerParameteriv);
+  GL_HOOK(glSamplerParameterf);
+  GL_HOOK(glSamplerParameterfv);
+  GL_HOOK(glSamplerParameterIiv);
+  GL_HOOK(glSamplerParameterIuiv);
+  GL_HOOK(glGetSamplerParameteriv);
+  GL_HOOK(glGetSamplerParameterIiv);
+  GL_HOOK(glGetSamplerParameterfv);
+  GL_HOOK(glGetSamplerParameterIuiv);
+  GL_HOOK(glQueryCounter);
+  GL_HOOK(glGetQueryObjecti64v);
+  GL_HOOK(glGetQueryObjectui64v);
+  GL_HOOK(glVertexAttribDivisor);
+  GL_HOOK(glVertexAttribP1ui);
+  GL_HOOK(glVertexAttribP1uiv);
+  GL_HOOK(glVertexAttribP2ui);
+  GL_HOOK(glVertexAttribP2uiv);
+  GL_HOOK(glVertexAttribP3ui);
+  GL_HOOK(glVertexAttribP3uiv);
+  GL_HOOK(glVertexAttribP4ui);
+  GL_HOOK(glVertexAttribP4uiv);
+  GL_HOOK(glVertexP2ui);
+  GL_HOOK(glVertexP2uiv);
+  GL_HOOK(glVertexP3ui);
+  GL_HOOK(glVertexP3uiv);
+  GL_HOOK(glVertexP4ui);
+  GL_HOOK(glVertexP4uiv);
+  GL_HOOK(glTexCoordP1ui);
+  GL_HOOK(glTexCoordP1uiv);
+  GL_HOOK(glTexCoordP2ui);
+  GL_HOOK(glTexCoordP2uiv);
+  GL_HOOK(glTexCoordP3ui);
+  GL_HOOK(glTexCoordP3uiv);
+  GL_HOOK(glTexCoordP4ui);
+  GL_HOOK(glTexCoordP4uiv);
+  GL_HOOK(glMultiTexCoordP1ui);
+  GL_HOOK(glMultiTexCoordP1uiv);
+  GL_HOOK(glMultiTexCoordP2ui);
+  GL_HOOK(glMultiTexCoordP2uiv);
+  GL_HOOK(glMultiTexCoordP3ui);
+  GL_HOOK(glMultiTexCoordP3uiv);
+  GL_HOOK(glMultiTexCoordP4ui);
+  GL_HOOK(glMultiTexCoordP4uiv);
+  GL_HOOK(glNormalP3ui);
+  GL_HOOK(glNormalP3uiv);
+  GL_HOOK(glColorP3ui);
+  GL_HOOK(glColorP3uiv);
+  GL_HOOK(glColorP4ui);
+  GL_HOOK(glColorP4uiv);
+  GL_HOOK(glSecondaryColorP3ui);
+  GL_HOOK(glSecondaryColorP3uiv);
+  getErrorId = Hook<&glad_glGetError, PFNGLGETERRORPROC>::id;
+
+  hook<&glExt.multiDrawElementsIndirect>("glMultiDrawElementsIndirect");
+  hook<&glExt.drawElementsInstancedBaseVertexBaseInstance>(
+      "glDrawElementsInstancedBaseVertexBaseInstance");
+  hook<&glExt.bufferStorage>("glBufferStorage");
+  hook<&glExt.debugMessageCallback>("glDebugMessageCallback");
+  hook<&glExt.debugMessageControl>("glDebugMessageControl");
+  hook<&glExt.objectLabel>("glObjectLabel");
+}
+
+#undef GL_HOOK
+
+} // namespace
+
+void installGLIntercept(bool checkErrors) {
+  checkGLErrors = checkErrors;
+  if (installed)
+    return;
+  hookAll();
+  installed = true;
+}
+
+bool glInterceptInstalled() { return installed; }
+
+const std::vector<GLCallStats> &glCallStats() { return callStats; }
+
+GLCallStats glCallTotals() {
+  GLCallStats total;
+  total.name = "total";
+  for (const GLCallStats &stats : callStats) {
+    total.calls += stats.calls;
+    total.nanoseconds += stats.nanoseconds;
+    total.errors += stats.errors;
+  }
+  return total;
+}
+
+void resetGLCallStats() {
+  for (GLCallStats &stats : callStats) {
+    stats.calls = 0;
+    stats.nanoseconds = 0;
+    stats.errors = 0;
+  }
+}
+
+void printGLCallReport(std::size_t count) {
+  std::vector<const GLCallStats *> sorted;
+  for (const GLCallStats &stats : callStats)
+    if (stats.calls > 0)
+      sorted.push_back(&stats);
+  std::sort(sorted.begin(), sorted.end(),
+            [](const GLCallStats *a, const GLCallStats *b) {
+              return a->nanoseconds > b->nanoseconds;
+            });
+  GLCallStats total = glCallTotals();
+  std::cout << "GL calls: " << total.calls << ", "
+            << static_cast<double>(total.nanoseconds) / 1.0e6
+            << " ms in the driver, " << total.errors << " errors\n"
+            << "  entry point, calls, total ms, ns per call, errors"
+            << std::endl;
+  for (std::size_t i = 0; i < sorted.size() && i < count; i++) {
+    const GLCallStats &stats = *sorted[i];
+    std::cout << "  " << stats.name << ", " << stats.calls << ", "
+              << static_cast<double>(stats.nanoseconds) / 1.0e6 << ", "
+              << stats.nanoseconds / stats.calls << ", " << stats.errors
+              << std::endl;
+  }
+}
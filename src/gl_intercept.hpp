@@ -0,0 +1,37 @@
+#ifndef GL_INTERCEPT_H
+#define GL_INTERCEPT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Optional layer between the renderer and the driver. Installing it swaps
+// every GL function pointer glad loaded (and the ones in glExt) for a
+// wrapper that counts the call and times how long the driver took, and can
+// check glGetError after each call, naming the entry point that failed.
+// Nothing changes for callers, the glXxx macros already go through the
+// pointers.
+//
+// The counters are plain integers: GL is only called on the context's
+// thread. Error checking makes every call a round trip to the driver, so
+// the times mean little with it on.
+struct GLCallStats {
+  const char *name = nullptr;
+  std::uint64_t calls = 0;
+  std::uint64_t nanoseconds = 0;
+  std::uint64_t errors = 0;
+};
+
+// call after gladLoadGLLoader and loadGLExtensions; again to change
+// `checkErrors`
+void installGLIntercept(bool checkErrors);
+bool glInterceptInstalled();
+
+// every wrapped entry point since the install or the last reset
+const std::vector<GLCallStats> &glCallStats();
+// all of them summed up, named "total"
+GLCallStats glCallTotals();
+void resetGLCallStats();
+// prints the `count` entry points the driver spent the most time in
+void printGLCallReport(std::size_t count);
+#endif
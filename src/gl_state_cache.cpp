@@ -0,0 +1,114 @@
+#include "gl_state_cache.hpp"
+
+// sentinel for "we don't know what the driver has", no real GL name or enum
+// uses it so the first call after invalidate() always goes through
+static constexpr GLuint UNKNOWN = 0xFFFFFFFFu;
+
+void GLStateCache::invalidate() {
+  for (float &c : m_clearColor)
+    c = -1.0f; // colors are clamped to [0, 1], so this never matches
+  m_program = UNKNOWN;
+  m_vao = UNKNOWN;
+  m_activeUnit = UNKNOWN;
+  for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+    m_textureTarget[i] = UNKNOWN;
+    m_texture[i] = UNKNOWN;
+  }
+  m_blend = -1;
+  m_depthTest = -1;
+  m_blendSrc = m_blendDst = UNKNOWN;
+  m_depthFunc = UNKNOWN;
+  m_polygonMode = UNKNOWN;
+}
+
+void GLStateCache::beginFrame() {
+  m_lastFrame = m_counters;
+  m_counters = Counters{};
+}
+
+void GLStateCache::clearColor(float r, float g, float b, float a) {
+  if (changed(m_clearColor[0] != r || m_clearColor[1] != g ||
+              m_clearColor[2] != b || m_clearColor[3] != a)) {
+    m_clearColor[0] = r;
+    m_clearColor[1] = g;
+    m_clearColor[2] = b;
+    m_clearColor[3] = a;
+    glClearColor(r, g, b, a);
+  }
+}
+
+void GLStateCache::useProgram(GLuint program) {
+  if (changed(m_program != program)) {
+    m_program = program;
+    glUseProgram(program);
+  }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+  if (changed(m_vao != vao)) {
+    m_vao = vao;
+    glBindVertexArray(vao);
+  }
+}
+
+void GLStateCache::bindTexture(unsigned int unit, GLenum target,
+                               GLuint texture) {
+  if (unit >= MAX_TEXTURE_UNITS) {
+    // out of the shadowed range, just pass it through
+    m_activeUnit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+    m_counters.issued += 2;
+    return;
+  }
+  if (!changed(m_texture[unit] != texture || m_textureTarget[unit] != target))
+    return;
+  // only switch the active unit when we actually have to bind something
+  if (changed(m_activeUnit != unit)) {
+    m_activeUnit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+  m_texture[unit] = texture;
+  m_textureTarget[unit] = target;
+  glBindTexture(target, texture);
+}
+
+void GLStateCache::enable(GLenum cap, bool enabled, signed char &cached) {
+  if (changed(cached != (enabled ? 1 : 0))) {
+    cached = enabled ? 1 : 0;
+    if (enabled)
+      glEnable(cap);
+    else
+      glDisable(cap);
+  }
+}
+
+void GLStateCache::setBlend(bool enabled) {
+  enable(GL_BLEND, enabled, m_blend);
+}
+
+void GLStateCache::blendFunc(GLenum src, GLenum dst) {
+  if (changed(m_blendSrc != src || m_blendDst != dst)) {
+    m_blendSrc = src;
+    m_blendDst = dst;
+    glBlendFunc(src, dst);
+  }
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+  enable(GL_DEPTH_TEST, enabled, m_depthTest);
+}
+
+void GLStateCache::depthFunc(GLenum func) {
+  if (changed(m_depthFunc != func)) {
+    m_depthFunc = func;
+    glDepthFunc(func);
+  }
+}
+
+void GLStateCache::polygonMode(GLenum mode) {
+  if (changed(m_polygonMode != mode)) {
+    m_polygonMode = mode;
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// Thin shadow of the GL state the renderer touches every frame.
+// Every setter compares against the last value it sent to the driver and
+// drops the call when nothing would change. Anything that talks to GL behind
+// the cache's back (texture loading, etc.) must call invalidate() afterwards.
+class GLStateCache {
+public:
+  static constexpr unsigned int MAX_TEXTURE_UNITS = 16;
+
+  // how many state calls reached the driver vs. were filtered this frame
+  struct Counters {
+    unsigned int issued = 0;
+    unsigned int elided = 0;
+  };
+
+  GLStateCache() { invalidate(); }
+
+  // forget everything we know, the next call of every kind is issued
+  void invalidate();
+  // reset the per-frame counters (call once at the top of the render loop)
+  void beginFrame();
+
+  void clearColor(float r, float g, float b, float a);
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vao);
+  void bindTexture(unsigned int unit, GLenum target, GLuint texture);
+  void setBlend(bool enabled);
+  void blendFunc(GLenum src, GLenum dst);
+  void setDepthTest(bool enabled);
+  void depthFunc(GLenum func);
+  void polygonMode(GLenum mode); // always GL_FRONT_AND_BACK in core profile
+
+  GLuint boundProgram() const { return m_program; }
+  GLuint boundVertexArray() const { return m_vao; }
+  GLenum currentPolygonMode() const { return m_polygonMode; }
+
+  const Counters &counters() const { return m_counters; }
+  const Counters &lastFrameCounters() const { return m_lastFrame; }
+
+private:
+  // returns true when the call has to be issued and updates the counters
+  bool changed(bool differs) {
+    if (differs)
+      m_counters.issued++;
+    else
+      m_counters.elided++;
+    return differs;
+  }
+  void enable(GLenum cap, bool enabled, signed char &cached);
+
+  Counters m_counters;
+  Counters m_lastFrame;
+
+  float m_clearColor[4];
+  GLuint m_program;
+  GLuint m_vao;
+  unsigned int m_activeUnit;
+  GLenum m_textureTarget[MAX_TEXTURE_UNITS];
+  GLuint m_texture[MAX_TEXTURE_UNITS];
+  // -1 unknown, 0 disabled, 1 enabled
+  signed char m_blend;
+  signed char m_depthTest;
+  GLenum m_blendSrc, m_blendDst;
+  GLenum m_depthFunc;
+  GLenum m_polygonMode;
+};
+#endif
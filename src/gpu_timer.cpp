@@ -0,0 +1,125 @@
+#include "gpu_timer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+GpuTimer::~GpuTimer() {
+  for (Frame &frame : m_frames)
+    if (!frame.queries.empty())
+      glDeleteQueries(static_cast<GLsizei>(frame.queries.size()),
+                      frame.queries.data());
+}
+
+std::uint32_t GpuTimer::passIndex(const char *name) {
+  // a handful of passes, a linear search beats hashing the name
+  for (std::size_t i = 0; i < m_passes.size(); i++)
+    if (std::strcmp(m_passes[i].name.c_str(), name) == 0)
+      return static_cast<std::uint32_t>(i);
+  m_passes.push_back(PassStats{});
+  m_passes.back().name = name;
+  return static_cast<std::uint32_t>(m_passes.size() - 1);
+}
+
+const GpuTimer::PassStats *GpuTimer::findPass(const char *name) const {
+  for (const PassStats &pass : m_passes)
+    if (pass.name == name)
+      return &pass;
+  return nullptr;
+}
+
+std::uint32_t GpuTimer::timestamp(Frame &frame) {
+  if (frame.used == frame.queries.size()) {
+    GLuint query;
+    glGenQueries(1, &query);
+    frame.queries.push_back(query);
+  }
+  glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+  return static_cast<std::uint32_t>(frame.used++);
+}
+
+bool GpuTimer::readBack(Frame &frame) {
+  if (frame.used > 0) {
+    // queries finish in order, the last one being there means all are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.used - 1],
+                       GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+      return false;
+  }
+  m_results.resize(frame.used);
+  for (std::size_t i = 0; i < frame.used; i++)
+    glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &m_results[i]);
+  for (const Scope &scope : frame.scopes) {
+    if (scope.end == NO_SCOPE)
+      continue; // never ended
+    PassStats &pass = m_passes[scope.pass];
+    double ms =
+        static_cast<double>(m_results[scope.end] - m_results[scope.begin]) /
+        1.0e6;
+    pass.lastMs = ms;
+    pass.minMs = pass.samples ? std::min(pass.minMs, ms) : ms;
+    pass.maxMs = pass.samples ? std::max(pass.maxMs, ms) : ms;
+    pass.totalMs += ms;
+    pass.samples++;
+  }
+  frame.pending = false;
+  return true;
+}
+
+void GpuTimer::beginFrame() {
+  if (m_recording)
+    endFrame();
+  // everything that finished, oldest first
+  for (unsigned int i = 1; i <= FRAME_COUNT; i++) {
+    Frame &frame = m_frames[(m_current + i) % FRAME_COUNT];
+    if (frame.pending && !readBack(frame))
+      break;
+  }
+  m_current = (m_current + 1) % FRAME_COUNT;
+  Frame &frame = m_frames[m_current];
+  if (frame.pending) {
+    // FRAME_COUNT frames late, waiting now would stall the pipeline
+    frame.pending = false;
+    m_dropped++;
+  }
+  frame.used = 0;
+  frame.scopes.clear();
+  m_recording = true;
+}
+
+void GpuTimer::endFrame() {
+  if (!m_recording)
+    return;
+  m_frames[m_current].pending = !m_frames[m_current].scopes.empty();
+  m_recording = false;
+}
+
+std::uint32_t GpuTimer::beginPass(const char *name) {
+  if (!m_recording)
+    return NO_SCOPE;
+  Frame &frame = m_frames[m_current];
+  Scope scope;
+  scope.pass = passIndex(name);
+  scope.begin = timestamp(frame);
+  scope.end = NO_SCOPE;
+  frame.scopes.push_back(scope);
+  return static_cast<std::uint32_t>(frame.scopes.size() - 1);
+}
+
+void GpuTimer::endPass(std::uint32_t scope) {
+  if (!m_recording || scope == NO_SCOPE)
+    return;
+  Frame &frame = m_frames[m_current];
+  frame.scopes[scope].end = timestamp(frame);
+}
+
+void GpuTimer::resetStats() {
+  for (PassStats &pass : m_passes) {
+    std::string name = std::move(pass.name);
+    double lastMs = pass.lastMs;
+    pass = PassStats{};
+    pass.name = std::move(name);
+    pass.lastMs = lastMs;
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Times passes on the GPU. Every pass is bracketed by two GL_TIMESTAMP
+// queries (not GL_TIME_ELAPSED, which can't nest). The queries of a frame are
+// read back FRAME_COUNT frames later, when the GPU is long done with them,
+// so reading never stalls; a frame whose results still aren't there by then
+// is dropped rather than waited for.
+//
+// Passes are identified by name and aggregated into min/avg/max until
+// resetStats().
+//
+// Destroy it while its GL context is current, it deletes its queries.
+class GpuTimer {
+public:
+  static constexpr unsigned int FRAME_COUNT = 4;
+
+  struct PassStats {
+    std::string name;
+    double lastMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double totalMs = 0.0;
+    std::uint64_t samples = 0;
+    double averageMs() const {
+      return samples ? totalMs / static_cast<double>(samples) : 0.0;
+    }
+  };
+
+  GpuTimer() = default;
+  ~GpuTimer();
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  // reads back every frame that finished and starts recording the next
+  void beginFrame();
+  void endFrame();
+
+  // returns what endPass() takes; passes may nest, and are ignored outside
+  // beginFrame() / endFrame()
+  std::uint32_t beginPass(const char *name);
+  void endPass(std::uint32_t scope);
+
+  const std::vector<PassStats> &passes() const { return m_passes; }
+  // nullptr until the pass was seen
+  const PassStats *findPass(const char *name) const;
+  // clears min/avg/max, the pass list and the last times stay
+  void resetStats();
+  unsigned int droppedFrames() const { return m_dropped; }
+
+private:
+  static constexpr std::uint32_t NO_SCOPE = ~0u;
+
+  struct Scope {
+    std::uint32_t pass;
+    std::uint32_t begin, end; // into Frame::queries
+  };
+  struct Frame {
+    std::vector<GLuint> queries; // grows to the most a frame ever used
+    std::size_t used = 0;
+    std::vector<Scope> scopes;
+    bool pending = false; // recorded, not read back yet
+  };
+
+  std::uint32_t passIndex(const char *name);
+  // false if the results aren't there yet
+  bool readBack(Frame &frame);
+  // writes a timestamp, returns its index in the frame's queries
+  std::uint32_t timestamp(Frame &frame);
+
+  Frame m_frames[FRAME_COUNT];
+  unsigned int m_current = 0; // the frame being recorded, or the last one
+  bool m_recording = false;
+  std::vector<PassStats> m_passes;
+  std::vector<GLuint64> m_results; // scratch for readBack
+  unsigned int m_dropped = 0;
+};
+
+// times its own lifetime as a pass
+class GpuScope {
+public:
+  GpuScope(GpuTimer &timer, const char *name)
+      : m_timer(timer), m_scope(timer.beginPass(name)) {}
+  ~GpuScope() { m_timer.endPass(m_scope); }
+  GpuScope(const GpuScope &) = delete;
+  GpuScope &operator=(const GpuScope &) = delete;
+
+private:
+  GpuTimer &m_timer;
+  std::uint32_t m_scope;
+};
+#endif
@@ -0,0 +1,74 @@
+#include "instancing.hpp"
+
+#include "frame_stats.hpp"
+#include "gl_debug.hpp"
+
+void pointInstanceAttributes(GLuint buffer, GLintptr offset) {
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+  const GLsizei stride = sizeof(InstanceData);
+  // a mat4 attribute takes 4 locations, one per column
+  for (GLuint column = 0; column < 4; column++) {
+    GLuint location = INSTANCE_ATTRIB_LOCATION + column;
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void *)(offset + offsetof(InstanceData, transform) +
+                                   column * 4 * sizeof(float)));
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1); // advance once per instance
+  }
+  // tint attribute
+  glVertexAttribPointer(INSTANCE_ATTRIB_LOCATION + 4, 4, GL_FLOAT, GL_FALSE,
+                        stride, (void *)(offset + offsetof(InstanceData, tint)));
+  glEnableVertexAttribArray(INSTANCE_ATTRIB_LOCATION + 4);
+  glVertexAttribDivisor(INSTANCE_ATTRIB_LOCATION + 4, 1);
+  // texture layer attribute
+  glVertexAttribPointer(INSTANCE_ATTRIB_LOCATION + 5, 1, GL_FLOAT, GL_FALSE,
+                        stride,
+                        (void *)(offset + offsetof(InstanceData, layer)));
+  glEnableVertexAttribArray(INSTANCE_ATTRIB_LOCATION + 5);
+  glVertexAttribDivisor(INSTANCE_ATTRIB_LOCATION + 5, 1);
+}
+
+InstanceBuffer::InstanceBuffer(GLuint vao) : m_vao(vao) {
+  glGenBuffers(1, &m_buffer);
+  glBindVertexArray(vao);
+  pointInstanceAttributes(m_buffer, 0);
+  labelGLObject(GL_BUFFER, m_buffer, "instances");
+  m_sourceBuffer = m_buffer;
+}
+
+InstanceBuffer::~InstanceBuffer() { glDeleteBuffers(1, &m_buffer); }
+
+void InstanceBuffer::source(GLStateCache &glState, GLuint buffer,
+                            GLintptr offset) {
+  if (buffer == m_sourceBuffer && offset == m_sourceOffset)
+    return;
+  glState.bindVertexArray(m_vao);
+  pointInstanceAttributes(buffer, offset);
+  m_sourceBuffer = buffer;
+  m_sourceOffset = offset;
+}
+
+void InstanceBuffer::upload(GLStateCache &glState,
+                            const InstanceData *instances, std::size_t count) {
+  source(glState, m_buffer, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  GLsizeiptr size = static_cast<GLsizeiptr>(count * sizeof(InstanceData));
+  // grow by 1.5x so a ramping instance count doesn't reallocate every time
+  if (count > m_capacity)
+    m_capacity = count + count / 2;
+  // respecifying the storage orphans the old one, so we never wait on draws
+  // that are still reading last frame's instances
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(m_capacity * sizeof(InstanceData)),
+               nullptr, GL_DYNAMIC_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances);
+  countBufferUpload(static_cast<std::size_t>(size));
+  m_count = count;
+}
+
+void InstanceBuffer::stream(GLStateCache &glState, GLuint buffer,
+                            GLintptr offset, std::size_t count) {
+  source(glState, buffer, offset);
+  m_count = count;
+}
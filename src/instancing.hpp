@@ -0,0 +1,62 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include "gl_state_cache.hpp"
+#include "linear_math.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Per-instance data as it sits in the instance VBO (std430-ish, 96 bytes)
+struct InstanceData {
+  Mat4 transform;
+  float tint[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  float layer = 0.0f; // texture array layer
+  float padding[3] = {};
+};
+
+// first vertex attribute location used by the per-instance stream
+//   transform -> 3, 4, 5, 6 (one vec4 column each)
+//   tint      -> 7
+//   layer     -> 8
+static constexpr GLuint INSTANCE_ATTRIB_LOCATION = 3;
+
+// points the per-instance attributes of the bound VAO at `offset` in
+// `buffer`, with divisor 1
+void pointInstanceAttributes(GLuint buffer, GLintptr offset);
+
+// A growable per-instance attribute buffer hooked into a VAO with divisor 1.
+// All instances of the mesh in that VAO are then drawn with one
+// glDrawElementsInstanced call.
+class InstanceBuffer {
+public:
+  // attaches the per-instance attributes to `vao` (which stays bound)
+  explicit InstanceBuffer(GLuint vao);
+  ~InstanceBuffer();
+  InstanceBuffer(const InstanceBuffer &) = delete;
+  InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+  // replace the contents, grows the buffer if needed
+  void upload(GLStateCache &glState, const InstanceData *instances,
+              std::size_t count);
+  // source this frame's instances from somewhere else instead, e.g. a
+  // DynamicBuffer allocation the caller already filled
+  void stream(GLStateCache &glState, GLuint buffer, GLintptr offset,
+              std::size_t count);
+
+  GLuint buffer() const { return m_buffer; }
+  std::size_t count() const { return m_count; }
+
+private:
+  // re-points the VAO only when the source actually moved
+  void source(GLStateCache &glState, GLuint buffer, GLintptr offset);
+
+  GLuint m_vao;
+  GLuint m_buffer = 0;
+  std::size_t m_capacity = 0;
+  std::size_t m_count = 0;
+  GLuint m_sourceBuffer = 0;
+  GLintptr m_sourceOffset = 0;
+};
+#endif
@@ -0,0 +1,272 @@
+#include "job_system.hpp"
+
+#include "cpu_profiler.hpp"
+
+#include <algorithm>
+
+struct JobCounter::Job {
+  JobSystem::Function function;
+  JobCounter *counter;
+};
+
+namespace {
+
+// which system the current thread belongs to and its deque there
+thread_local JobSystem *t_system = nullptr;
+thread_local int t_index = -1;
+thread_local std::uint32_t t_random = 0x9E3779B9u;
+
+std::uint32_t nextRandom() {
+  // xorshift, only picks steal victims
+  t_random ^= t_random << 13;
+  t_random ^= t_random >> 17;
+  t_random ^= t_random << 5;
+  return t_random;
+}
+
+// failed searches before a worker goes to sleep
+const int SPIN_ROUNDS = 64;
+
+} // namespace
+
+bool JobSystem::Deque::push(Job *job) {
+  std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+  std::int64_t top = m_top.load(std::memory_order_acquire);
+  if (bottom - top >= CAPACITY)
+    return false;
+  m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+  // publishes the job to thieves, their acquire load of m_bottom pairs with it
+  m_bottom.store(bottom + 1, std::memory_order_release);
+  return true;
+}
+
+JobSystem::Job *JobSystem::Deque::pop() {
+  std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+  m_bottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::int64_t top = m_top.load(std::memory_order_relaxed);
+  if (top > bottom) { // empty
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Job *job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // the last job, thieves may be after it too
+    if (!m_top.compare_exchange_strong(top, top + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+      job = nullptr;
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+JobSystem::Job *JobSystem::Deque::steal() {
+  std::int64_t top = m_top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+  if (top >= bottom)
+    return nullptr;
+  Job *job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+    return nullptr; // lost the race, the caller just looks elsewhere
+  return job;
+}
+
+JobSystem::JobSystem(unsigned threads) {
+  // at least one worker even on a single core: threads outside the system
+  // don't run jobs, something has to run the ones they wait for
+  if (threads == 0)
+    threads = std::max(std::thread::hardware_concurrency(), 2u);
+  for (unsigned i = 0; i < threads; i++)
+    m_deques.push_back(std::make_unique<Deque>());
+  t_system = this;
+  t_index = 0;
+  for (unsigned i = 1; i < threads; i++)
+    m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+  m_stop.store(true);
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_wake.notify_all();
+  }
+  for (std::thread &worker : m_workers)
+    worker.join();
+  if (t_system == this) {
+    t_system = nullptr;
+    t_index = -1;
+  }
+}
+
+int JobSystem::threadIndex() const { return t_system == this ? t_index : -1; }
+
+JobSystem::Job *JobSystem::createJob(Function function, JobCounter *counter) {
+  if (counter)
+    counter->m_value.fetch_add(1, std::memory_order_relaxed);
+  return new Job{std::move(function), counter};
+}
+
+void JobSystem::run(Function job, JobCounter *counter) {
+  schedule(createJob(std::move(job), counter));
+}
+
+void JobSystem::runAfter(JobCounter &dependency, Function job,
+                         JobCounter *counter) {
+  Job *created = createJob(std::move(job), counter);
+  {
+    std::lock_guard<std::mutex> lock(dependency.m_mutex);
+    if (dependency.m_value.load(std::memory_order_acquire) > 0) {
+      dependency.m_parked.push_back(created);
+      return;
+    }
+  }
+  schedule(created);
+}
+
+void JobSystem::runOnMainThread(Function job, JobCounter *counter) {
+  Job *created = createJob(std::move(job), counter);
+  std::lock_guard<std::mutex> lock(m_mainMutex);
+  m_mainJobs.push_back(created);
+}
+
+void JobSystem::parallelFor(
+    std::size_t count, std::size_t grain,
+    std::function<void(std::size_t, std::size_t)> body, JobCounter &counter) {
+  grain = std::max<std::size_t>(grain, 1);
+  auto shared =
+      std::make_shared<std::function<void(std::size_t, std::size_t)>>(
+          std::move(body));
+  for (std::size_t begin = 0; begin < count; begin += grain) {
+    std::size_t end = std::min(count, begin + grain);
+    run([shared, begin, end] { (*shared)(begin, end); }, &counter);
+  }
+}
+
+void JobSystem::schedule(Job *job) {
+  if (t_system == this) {
+    if (!m_deques[t_index]->push(job)) {
+      execute(job); // deque full, no point queueing more
+      return;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(m_sharedMutex);
+    m_shared.push_back(job);
+    m_sharedCount.fetch_add(1, std::memory_order_release);
+  }
+  m_epoch.fetch_add(1, std::memory_order_seq_cst);
+  if (m_sleepers.load(std::memory_order_seq_cst) > 0) {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_wake.notify_one();
+  }
+}
+
+JobSystem::Job *JobSystem::findJob() {
+  int self = threadIndex();
+  if (self >= 0)
+    if (Job *job = m_deques[self]->pop())
+      return job;
+  if (m_sharedCount.load(std::memory_order_acquire) > 0) {
+    std::lock_guard<std::mutex> lock(m_sharedMutex);
+    if (!m_shared.empty()) {
+      Job *job = m_shared.back();
+      m_shared.pop_back();
+      m_sharedCount.fetch_sub(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  // one pass over the other deques from a random start
+  unsigned count = size();
+  unsigned start = nextRandom() % count;
+  for (unsigned i = 0; i < count; i++) {
+    unsigned victim = (start + i) % count;
+    if (static_cast<int>(victim) == self)
+      continue;
+    if (Job *job = m_deques[victim]->steal())
+      return job;
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Job *job) {
+  job->function();
+  JobCounter *counter = job->counter;
+  delete job;
+  if (!counter)
+    return;
+  int value = counter->m_value.load(std::memory_order_relaxed);
+  while (value > 1)
+    if (counter->m_value.compare_exchange_weak(value, value - 1,
+                                               std::memory_order_acq_rel))
+      return;
+  // possibly the last one: reaching zero and taking the parked jobs happen
+  // under the lock, so runAfter() can't park a job nobody will release
+  std::vector<Job *> released;
+  {
+    std::lock_guard<std::mutex> lock(counter->m_mutex);
+    if (counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      released.swap(counter->m_parked);
+  }
+  for (Job *parked : released)
+    schedule(parked);
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  int self = threadIndex();
+  while (!counter.done()) {
+    if (self == 0 && pumpMainThread() > 0)
+      continue;
+    // outside threads leave the jobs to the system's own threads
+    if (Job *job = self >= 0 ? findJob() : nullptr)
+      execute(job);
+    else
+      std::this_thread::yield();
+  }
+  // the last job may still hold the lock, the caller is free to destroy the
+  // counter once this returns
+  std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+std::size_t JobSystem::pumpMainThread() {
+  {
+    std::lock_guard<std::mutex> lock(m_mainMutex);
+    m_mainRunning.swap(m_mainJobs);
+  }
+  std::size_t count = m_mainRunning.size();
+  // jobs may queue more main thread jobs, those wait for the next pump
+  for (Job *job : m_mainRunning)
+    execute(job);
+  m_mainRunning.clear();
+  return count;
+}
+
+void JobSystem::workerLoop(unsigned index) {
+  t_system = this;
+  t_index = static_cast<int>(index);
+  t_random = 0x9E3779B9u * (index + 1);
+  CpuProfiler::setThreadName("job worker");
+  int idle = 0;
+  while (!m_stop.load(std::memory_order_relaxed)) {
+    std::uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+    if (Job *job = findJob()) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < SPIN_ROUNDS) {
+      std::this_thread::yield();
+      continue;
+    }
+    // nothing for a while: sleep until a job is queued after `epoch`
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+    m_wake.wait(lock, [&] {
+      return m_stop.load(std::memory_order_relaxed) ||
+             m_epoch.load(std::memory_order_seq_cst) != epoch;
+    });
+    m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+    idle = 0;
+  }
+}
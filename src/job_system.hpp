@@ -0,0 +1,122 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Number of unfinished jobs attached to it. Jobs can be made to wait for a
+// counter to reach zero (JobSystem::runAfter), threads help out until it
+// does (JobSystem::wait). Only destroy a counter after waiting on it.
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  bool done() const { return m_value.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  struct Job;
+
+  std::atomic<int> m_value{0};
+  std::mutex m_mutex;         // guards m_parked against the last decrement
+  std::vector<Job *> m_parked; // runAfter() jobs waiting for zero
+};
+
+// Work-stealing scheduler. Every thread owns a Chase-Lev deque: it pushes
+// and pops its own jobs at the bottom (newest first, cache warm) while idle
+// threads steal from the top of someone else's. Jobs submitted from threads
+// outside the system go through a shared queue.
+//
+// The thread that creates the system is thread 0 and the only one that runs
+// runOnMainThread() jobs, which is where GL calls go. It runs them in
+// pumpMainThread() and while it waits.
+class JobSystem {
+public:
+  using Function = std::function<void()>;
+
+  // total threads including the main one, 0 for one per hardware thread
+  // but never fewer than 2. With 1 there are no workers, only the main
+  // thread's wait() runs jobs, so threads outside the system must not wait.
+  explicit JobSystem(unsigned threads = 0);
+  // every counter must have been waited on
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(m_deques.size()); }
+  // 0 for the main thread, -1 for threads outside the system. Jobs only
+  // ever run on the system's threads, so inside a job this is a valid index
+  // for per-thread data.
+  int threadIndex() const;
+
+  // `counter` (optional) goes up now and back down when the job finished
+  void run(Function job, JobCounter *counter = nullptr);
+  // holds the job back until `dependency` reaches zero
+  void runAfter(JobCounter &dependency, Function job,
+                JobCounter *counter = nullptr);
+  void runOnMainThread(Function job, JobCounter *counter = nullptr);
+  // body(begin, end) over [0, count) in jobs of `grain` items
+  void parallelFor(std::size_t count, std::size_t grain,
+                   std::function<void(std::size_t, std::size_t)> body,
+                   JobCounter &counter);
+
+  // runs jobs (and main thread jobs, on the main thread) until `counter`
+  // reaches zero; threads outside the system just wait for the workers
+  void wait(JobCounter &counter);
+  // runs the queued main thread jobs, returns how many
+  std::size_t pumpMainThread();
+
+private:
+  using Job = JobCounter::Job;
+
+  // Chase-Lev deque with a fixed capacity (Le et al., "Correct and
+  // Efficient Work-Stealing for Weak Memory Models")
+  class Deque {
+  public:
+    bool push(Job *job); // owner only, false when full
+    Job *pop();          // owner only
+    Job *steal();        // any thread
+
+  private:
+    static constexpr std::int64_t CAPACITY = 4096;
+    alignas(64) std::atomic<std::int64_t> m_top{0};
+    alignas(64) std::atomic<std::int64_t> m_bottom{0};
+    std::atomic<Job *> m_jobs[CAPACITY];
+  };
+
+  Job *createJob(Function function, JobCounter *counter);
+  void schedule(Job *job);
+  Job *findJob();
+  void execute(Job *job);
+  void workerLoop(unsigned index);
+
+  std::vector<std::unique_ptr<Deque>> m_deques; // [0] is the main thread's
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_sharedMutex;
+  std::vector<Job *> m_shared; // from threads outside the system
+  std::atomic<std::size_t> m_sharedCount{0};
+
+  std::mutex m_mainMutex;
+  std::vector<Job *> m_mainJobs;
+  std::vector<Job *> m_mainRunning;
+
+  // sleeping: workers wait for the epoch to move, every new job moves it
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+  std::atomic<std::uint64_t> m_epoch{0};
+  std::atomic<unsigned> m_sleepers{0};
+  std::atomic<bool> m_stop{false};
+};
+#endif
@@ -0,0 +1,40 @@
+#include "linear_allocator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+LinearAllocator::LinearAllocator(std::size_t chunkSize)
+    : m_chunkSize(chunkSize) {}
+
+void *LinearAllocator::allocate(std::size_t size, std::size_t alignment) {
+  // move on through the kept chunks until one fits, add one at the end
+  for (;; m_chunk++, m_offset = 0) {
+    if (m_chunk == m_chunks.size()) {
+      std::size_t chunkSize = std::max(m_chunkSize, size + alignment);
+      m_chunks.push_back(
+          {std::make_unique<unsigned char[]>(chunkSize), chunkSize});
+    }
+    Chunk &chunk = m_chunks[m_chunk];
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(chunk.memory.get());
+    std::uintptr_t address = (base + m_offset + alignment - 1) & ~(alignment - 1);
+    std::size_t end = address - base + size;
+    if (end <= chunk.size) {
+      m_used += end - m_offset;
+      m_offset = end;
+      return reinterpret_cast<void *>(address);
+    }
+  }
+}
+
+void LinearAllocator::reset() {
+  m_chunk = 0;
+  m_offset = 0;
+  m_used = 0;
+}
+
+std::size_t LinearAllocator::capacity() const {
+  std::size_t total = 0;
+  for (const Chunk &chunk : m_chunks)
+    total += chunk.size;
+  return total;
+}
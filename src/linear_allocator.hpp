@@ -0,0 +1,42 @@
+#ifndef LINEAR_ALLOCATOR_H
+#define LINEAR_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator over CPU memory for data that lives exactly one frame.
+// Memory comes in chunks that are kept across reset(), so once warmed up a
+// frame allocates nothing from the heap. Not thread safe: give every thread
+// its own.
+class LinearAllocator {
+public:
+  explicit LinearAllocator(std::size_t chunkSize = 64 * 1024);
+  LinearAllocator(const LinearAllocator &) = delete;
+  LinearAllocator &operator=(const LinearAllocator &) = delete;
+  LinearAllocator(LinearAllocator &&) = default;
+  LinearAllocator &operator=(LinearAllocator &&) = default;
+
+  // `alignment` must be a power of two. Requests bigger than a chunk get a
+  // chunk of their own.
+  void *allocate(std::size_t size,
+                 std::size_t alignment = alignof(std::max_align_t));
+  // releases everything allocated since the last reset, keeps the chunks
+  void reset();
+
+  std::size_t used() const { return m_used; }
+  std::size_t capacity() const;
+
+private:
+  struct Chunk {
+    std::unique_ptr<unsigned char[]> memory;
+    std::size_t size;
+  };
+
+  std::size_t m_chunkSize;
+  std::vector<Chunk> m_chunks;
+  std::size_t m_chunk = 0;  // the one being filled
+  std::size_t m_offset = 0; // into it
+  std::size_t m_used = 0;
+};
+#endif
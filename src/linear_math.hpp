@@ -0,0 +1,145 @@
+#ifndef LINEAR_MATH_H
+#define LINEAR_MATH_H
+
+#include <cmath>
+
+// Minimal vector/matrix types for the renderer.
+// Matrices are column-major (m[column * 4 + row]) so they can be handed to
+// glUniformMatrix4fv / vertex attributes without transposing.
+
+struct Vec3 {
+  float x = 0.0f, y = 0.0f, z = 0.0f;
+};
+
+struct Vec4 {
+  float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3 operator*(Vec3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+inline float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 cross(Vec3 a, Vec3 b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+inline float length(Vec3 a) { return std::sqrt(dot(a, a)); }
+inline Vec3 normalize(Vec3 a) {
+  float len = length(a);
+  return len > 0.0f ? a * (1.0f / len) : a;
+}
+
+struct Mat4 {
+  float m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+  float &operator()(int row, int column) { return m[column * 4 + row]; }
+  float operator()(int row, int column) const { return m[column * 4 + row]; }
+};
+
+inline Mat4 operator*(const Mat4 &a, const Mat4 &b) {
+  Mat4 r;
+  for (int c = 0; c < 4; c++)
+    for (int row = 0; row < 4; row++)
+      r(row, c) = a(row, 0) * b(0, c) + a(row, 1) * b(1, c) +
+                  a(row, 2) * b(2, c) + a(row, 3) * b(3, c);
+  return r;
+}
+
+inline Vec4 operator*(const Mat4 &a, Vec4 v) {
+  return {a(0, 0) * v.x + a(0, 1) * v.y + a(0, 2) * v.z + a(0, 3) * v.w,
+          a(1, 0) * v.x + a(1, 1) * v.y + a(1, 2) * v.z + a(1, 3) * v.w,
+          a(2, 0) * v.x + a(2, 1) * v.y + a(2, 2) * v.z + a(2, 3) * v.w,
+          a(3, 0) * v.x + a(3, 1) * v.y + a(3, 2) * v.z + a(3, 3) * v.w};
+}
+
+inline Mat4 translate(Vec3 t) {
+  Mat4 r;
+  r(0, 3) = t.x;
+  r(1, 3) = t.y;
+  r(2, 3) = t.z;
+  return r;
+}
+
+inline Mat4 scale(Vec3 s) {
+  Mat4 r;
+  r(0, 0) = s.x;
+  r(1, 1) = s.y;
+  r(2, 2) = s.z;
+  return r;
+}
+
+// rotation around an arbitrary (normalized) axis, angle in radians
+inline Mat4 rotate(float angle, Vec3 axis) {
+  float c = std::cos(angle), s = std::sin(angle), t = 1.0f - c;
+  Vec3 a = normalize(axis);
+  Mat4 r;
+  r(0, 0) = t * a.x * a.x + c;
+  r(0, 1) = t * a.x * a.y - s * a.z;
+  r(0, 2) = t * a.x * a.z + s * a.y;
+  r(1, 0) = t * a.x * a.y + s * a.z;
+  r(1, 1) = t * a.y * a.y + c;
+  r(1, 2) = t * a.y * a.z - s * a.x;
+  r(2, 0) = t * a.x * a.z - s * a.y;
+  r(2, 1) = t * a.y * a.z + s * a.x;
+  r(2, 2) = t * a.z * a.z + c;
+  return r;
+}
+
+// unit quaternion (xyz vector part, w scalar) for a rotation around `axis`
+inline Vec4 quaternion(float angle, Vec3 axis) {
+  Vec3 a = normalize(axis) * std::sin(0.5f * angle);
+  return {a.x, a.y, a.z, std::cos(0.5f * angle)};
+}
+
+// rotation matrix of a unit quaternion
+inline Mat4 rotate(Vec4 q) {
+  float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+  Mat4 r;
+  r(0, 0) = 1.0f - 2.0f * (yy + zz);
+  r(0, 1) = 2.0f * (xy - wz);
+  r(0, 2) = 2.0f * (xz + wy);
+  r(1, 0) = 2.0f * (xy + wz);
+  r(1, 1) = 1.0f - 2.0f * (xx + zz);
+  r(1, 2) = 2.0f * (yz - wx);
+  r(2, 0) = 2.0f * (xz - wy);
+  r(2, 1) = 2.0f * (yz + wx);
+  r(2, 2) = 1.0f - 2.0f * (xx + yy);
+  return r;
+}
+
+// view matrix of an eye at `eye` looking at `target`, right handed
+inline Mat4 lookAt(Vec3 eye, Vec3 target, Vec3 up) {
+  Vec3 f = normalize(target - eye);
+  Vec3 s = normalize(cross(f, up));
+  Vec3 u = cross(s, f);
+  Mat4 r;
+  r(0, 0) = s.x;
+  r(0, 1) = s.y;
+  r(0, 2) = s.z;
+  r(1, 0) = u.x;
+  r(1, 1) = u.y;
+  r(1, 2) = u.z;
+  r(2, 0) = -f.x;
+  r(2, 1) = -f.y;
+  r(2, 2) = -f.z;
+  r(0, 3) = -dot(s, eye);
+  r(1, 3) = -dot(u, eye);
+  r(2, 3) = dot(f, eye);
+  return r;
+}
+
+// OpenGL style projection (right handed view space, clip z in [-w, w]),
+// vertical field of view in radians
+inline Mat4 perspective(float fovY, float aspect, float zNear, float zFar) {
+  float f = 1.0f / std::tan(0.5f * fovY);
+  Mat4 r;
+  r(0, 0) = f / aspect;
+  r(1, 1) = f;
+  r(2, 2) = (zFar + zNear) / (zNear - zFar);
+  r(2, 3) = 2.0f * zFar * zNear / (zNear - zFar);
+  r(3, 2) = -1.0f;
+  r(3, 3) = 0.0f;
+  return r;
+}
+#endif
@@ -1,46 +1,524 @@
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "command_buffer.hpp"
+#include "cpu_profiler.hpp"
+#include "culling.hpp"
+#include "dynamic_buffer.hpp"
+#include "frame_snapshot.hpp"
+#include "frame_stats.hpp"
+#include "frame_sync.hpp"
+#include "frame_timing.hpp"
+#include "gl_debug.hpp"
+#include "gl_extensions.hpp"
+#include "gl_intercept.hpp"
+#include "gl_state_cache.hpp"
+#include "gpu_timer.hpp"
+#include "instancing.hpp"
+#include "job_system.hpp"
+#include "mesh_batch.hpp"
+#include "mesh_file.hpp"
+#include "mesh_lod.hpp"
+#include "mesh_optimizer.hpp"
+#include "occlusion.hpp"
+#include "render_queue.hpp"
+#include "scene.hpp"
 #include "shader.h"
 #include <glad/glad.h>
 #include <glfw/glfw3.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "text_overlay.hpp"
 #include "texture_handler.hpp"
+#include "vertex_format.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Callback function to adjust the viewport when the window is resized
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
-// processing input
+// Terminates GLFW when main returns. Declared right after glfwInit(), so
+// every GL-owning local declared after it (buffers, queries, fences...) is
+// destroyed first, while its context is still current, on every return path.
+struct GlfwSession {
+  GlfwSession() = default;
+  ~GlfwSession() { glfwTerminate(); }
+  GlfwSession(const GlfwSession &) = delete;
+  GlfwSession &operator=(const GlfwSession &) = delete;
+};
+
+// The keyboard and mouse as sampled on the main thread after polling, the
+// only thread GLFW lets read them. The simulation works from the latest one.
+struct InputSample {
+  bool keys[GLFW_KEY_LAST + 1] = {};
+  bool leftButton = false;
+  bool rightButton = false;
+  double cursorX = 0.0, cursorY = 0.0;
+  int width = 1, height = 1; // framebuffer
+};
+
+// toggles driven by the keyboard
+struct InputState {
+  bool wireframe = false;
+  bool showInstances = false;
+  bool showBatch = false;
+  bool showMesh = false;
+  bool treeCulling = false;
+  bool occlusionCulling = false;
+};
+
+// samples the keys the simulation reads
 // close the window when the escape key is pressed
-void processInput(GLFWwindow *window) {
+void pollInput(GLFWwindow *window, InputSample &input) {
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
     glfwSetWindowShouldClose(window, true);
+  static const int s_keys[] = {GLFW_KEY_ENTER, GLFW_KEY_I,     GLFW_KEY_B,
+                               GLFW_KEY_M,     GLFW_KEY_C,     GLFW_KEY_O,
+                               GLFW_KEY_W,     GLFW_KEY_S,     GLFW_KEY_D,
+                               GLFW_KEY_A,     GLFW_KEY_SPACE, GLFW_KEY_LEFT_SHIFT,
+                               GLFW_KEY_LEFT_CONTROL, GLFW_KEY_F1};
+  for (int key : s_keys)
+    input.keys[key] = glfwGetKey(window, key) == GLFW_PRESS;
+  input.leftButton =
+      glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+  input.rightButton =
+      glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+  glfwGetCursorPos(window, &input.cursorX, &input.cursorY);
+  glfwGetFramebufferSize(window, &input.width, &input.height);
+}
+
+// true on the frame a key goes down, `state` remembers the last frame
+bool keyToggled(const InputSample &sample, int key, bool &state) {
+  bool pressed = sample.keys[key];
+  bool toggled = pressed && !state;
+  state = pressed;
+  return toggled;
+}
+
+// processing input
+void processInput(const InputSample &sample, InputState &input) {
   // variables for toggling between GL_LINE and GL_FILL
-  static bool s_wireframeMode = false;
   static bool s_enterState = false;
-  bool enterPressed = glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS;
   // if the user presses enter, toggle wireframe mode
-  if (enterPressed && !s_enterState) {
-    s_wireframeMode = !s_wireframeMode;
-    glPolygonMode(GL_FRONT_AND_BACK, s_wireframeMode ? GL_LINE : GL_FILL);
+  if (keyToggled(sample, GLFW_KEY_ENTER, s_enterState))
+    input.wireframe = !input.wireframe;
+  // I toggles the instanced grid, B the batched grid, M the sphere field
+  static bool s_iState = false;
+  if (keyToggled(sample, GLFW_KEY_I, s_iState))
+    input.showInstances = !input.showInstances;
+  static bool s_bState = false;
+  if (keyToggled(sample, GLFW_KEY_B, s_bState))
+    input.showBatch = !input.showBatch;
+  static bool s_mState = false;
+  if (keyToggled(sample, GLFW_KEY_M, s_mState))
+    input.showMesh = !input.showMesh;
+  // C culls the sphere field through the BVH instead of the linear SIMD loop
+  static bool s_cState = false;
+  if (keyToggled(sample, GLFW_KEY_C, s_cState))
+    input.treeCulling = !input.treeCulling;
+  // O adds the software occlusion pass after the frustum
+  static bool s_oState = false;
+  if (keyToggled(sample, GLFW_KEY_O, s_oState))
+    input.occlusionCulling = !input.occlusionCulling;
+}
+
+// WASD moves, space/left control go up/down, shift speeds up, dragging with
+// the right mouse button looks around
+void processCamera(const InputSample &sample, Camera &camera,
+                   float deltaTime) {
+  float speed = (sample.keys[GLFW_KEY_LEFT_SHIFT] ? 40.0f : 10.0f) * deltaTime;
+  Vec3 move;
+  if (sample.keys[GLFW_KEY_W])
+    move.z += speed;
+  if (sample.keys[GLFW_KEY_S])
+    move.z -= speed;
+  if (sample.keys[GLFW_KEY_D])
+    move.x += speed;
+  if (sample.keys[GLFW_KEY_A])
+    move.x -= speed;
+  if (sample.keys[GLFW_KEY_SPACE])
+    move.y += speed;
+  if (sample.keys[GLFW_KEY_LEFT_CONTROL])
+    move.y -= speed;
+  camera.move(move);
+
+  static double s_lastX = 0.0, s_lastY = 0.0;
+  if (sample.rightButton) {
+    const float sensitivity = 0.003f; // radians per pixel
+    camera.turn(static_cast<float>(sample.cursorX - s_lastX) * sensitivity,
+                static_cast<float>(s_lastY - sample.cursorY) * sensitivity);
+  }
+  s_lastX = sample.cursorX;
+  s_lastY = sample.cursorY;
+}
+
+// lays `count` small quads out on a square grid covering the screen, each
+// spinning at its own phase, alternating texture layers
+void buildInstanceGrid(InstanceData *instances, std::size_t count,
+                       float time) {
+  std::size_t side =
+      static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+  float cell = 2.0f / static_cast<float>(side);
+  for (std::size_t i = 0; i < count; i++) {
+    float x = -1.0f + cell * (static_cast<float>(i % side) + 0.5f);
+    float y = -1.0f + cell * (static_cast<float>(i / side) + 0.5f);
+    InstanceData &instance = instances[i];
+    instance.transform = translate({x, y, 0.0f}) *
+                         rotate(time + static_cast<float>(i) * 0.1f,
+                                {0.0f, 0.0f, 1.0f}) *
+                         scale({cell * 0.8f, cell * 0.8f, 1.0f});
+    instance.tint[0] = 0.5f + 0.5f * (x + 1.0f) * 0.5f;
+    instance.tint[1] = 0.5f + 0.5f * (y + 1.0f) * 0.5f;
+    instance.tint[2] = 1.0f;
+    instance.tint[3] = 1.0f;
+    instance.layer = static_cast<float>(i % 2);
+  }
+}
+
+// --instance-stress: doubles the instance count every step and reports the
+// average frame time, vsync off and glFinish every frame so the GPU cost is
+// included. Transforms are uploaded once per step, so this measures the draw
+// itself rather than CPU-side animation.
+void runInstanceStress(GLFWwindow *window, GLStateCache &glState,
+                       RenderQueue &renderQueue, InstanceBuffer &instanceBuffer,
+                       const DrawPacket &packet) {
+  glfwSwapInterval(0);
+  std::vector<InstanceData> instances;
+  const int warmupFrames = 10;
+  const int measuredFrames = 100;
+  std::cout << "instances, avg frame ms, ns per instance" << std::endl;
+  for (std::size_t count = 1024; count <= (1u << 20); count *= 2) {
+    instances.resize(count);
+    buildInstanceGrid(instances.data(), count, 0.0f);
+    instanceBuffer.upload(glState, instances.data(), instances.size());
+    DrawPacket draw = packet;
+    draw.instanceCount = static_cast<GLsizei>(count);
+    double start = 0.0;
+    for (int frame = 0; frame < warmupFrames + measuredFrames; frame++) {
+      if (frame == warmupFrames)
+        start = glfwGetTime();
+      glState.beginFrame();
+      renderQueue.beginFrame();
+      glClear(GL_COLOR_BUFFER_BIT);
+      renderQueue.submit(draw);
+      renderQueue.flush(glState);
+      glfwSwapBuffers(window);
+      glFinish();
+      glfwPollEvents();
+      if (glfwWindowShouldClose(window))
+        return;
+    }
+    double ms = (glfwGetTime() - start) * 1000.0 / measuredFrames;
+    std::cout << count << ", " << ms << ", "
+              << ms * 1.0e6 / static_cast<double>(count) << std::endl;
   }
-  s_enterState = enterPressed;
 }
 
-int main() {
+// --import <in.obj> <out.mesh>: runs the mesh pipeline offline and reports
+// the vertex cache statistics before and after and the LOD chain
+int importMesh(const char *objPath, const char *outPath) {
+  MeshData mesh;
+  if (!loadOBJ(objPath, mesh))
+    return -1;
+  VertexCacheStats before =
+      analyzeVertexCache(mesh.indices, mesh.vertices.size());
+  std::size_t verticesBefore = mesh.vertices.size();
+  deduplicateVertices(mesh);
+  generateLods(mesh);
+  optimizeMesh(mesh);
+  std::vector<std::uint32_t> lod0(mesh.indices.begin(),
+                                  mesh.indices.begin() +
+                                      mesh.lods[0].indexCount);
+  VertexCacheStats after = analyzeVertexCache(lod0, mesh.vertices.size());
+  std::vector<unsigned char> packed;
+  GLenum indexType = packIndices(mesh.indices, mesh.vertices.size(), packed);
+
+  std::cout << mesh.name << ": " << lod0.size() / 3 << " triangles, "
+            << verticesBefore << " -> " << mesh.vertices.size()
+            << " vertices, " << (indexType == GL_UNSIGNED_SHORT ? 16 : 32)
+            << "-bit indices\n"
+            << "  ACMR " << before.acmr << " -> " << after.acmr << ", ATVR "
+            << before.atvr << " -> " << after.atvr << std::endl;
+  for (std::size_t i = 0; i < mesh.lods.size(); i++)
+    std::cout << "  LOD " << i << ": " << mesh.lods[i].indexCount / 3
+              << " triangles, error " << mesh.lods[i].error << std::endl;
+
+  // position, packed normal, half uv: 20 bytes per vertex
+  VertexFormat format;
+  format.add(VertexSemantic::Position, 0, VertexEncoding::Float3)
+      .add(VertexSemantic::Normal, 1, VertexEncoding::Snorm8x4)
+      .add(VertexSemantic::TexCoord, 2, VertexEncoding::Half2);
+  if (!writeMeshFile(outPath, mesh, format))
+    return -1;
+  MappedMesh mapped;
+  if (!mapped.open(outPath))
+    return -1;
+  std::cout << "  wrote " << outPath << ", " << mapped.header().fileSize
+            << " bytes" << std::endl;
+  return 0;
+}
+
+// quads in the animated instance grid
+static constexpr std::size_t INSTANCE_GRID_COUNT = 10000;
+
+// material ids of the scene: tinted by LOD, or highlighted when picked
+enum FieldMaterial : std::uint32_t { LodTint, Picked };
+
+// Everything the simulation thread owns once the render loop runs
+struct Simulation {
+  Camera camera{{0.0f, 3.0f, 0.0f}};
+  Camera previousCamera; // before the last step
+  Scene scene;
+  Bvh fieldTree;
+  std::vector<MeshLod> lods; // of the sphere mesh, empty if it didn't load
+  OcclusionBuffer occlusion;
+  InputState input;
+  Entity pickedEntity = INVALID_ENTITY;
+  bool pickHeld = false;
+  std::uint64_t frame = 0;
+
+  // per-frame scratch
+  std::vector<std::uint32_t> visibleObjects;
+  std::vector<std::uint32_t> occluders;
+  std::vector<std::uint8_t> visibleLods;
+  std::vector<std::size_t> lodCursors;
+};
+
+// one fixed step: input, camera and picking
+void stepSimulation(Simulation &sim, const InputSample &sample,
+                    float deltaTime) {
+  CpuZone zone("simulation step");
+  sim.previousCamera = sim.camera;
+  processInput(sample, sim.input);
+  processCamera(sample, sim.camera, deltaTime);
+  Camera &camera = sim.camera;
+  camera.setPerspective(0.785398f,
+                        static_cast<float>(sample.width) /
+                            static_cast<float>(std::max(sample.height, 1)),
+                        0.1f, 500.0f);
+  sim.frame++;
+
+  Scene &scene = sim.scene;
+  const CullingSet &fieldBounds = scene.worldBounds();
+  // left click picks the sphere under the center of the screen
+  bool click = sample.leftButton && sim.input.showMesh && !sim.lods.empty();
+  if (click && !sim.pickHeld) {
+    Vec3 origin = camera.position(), direction = camera.forward();
+    Bvh::RayHit hit = sim.fieldTree.raycast(
+        origin, direction, camera.zFar(),
+        [&](std::uint32_t object, float &distance) {
+          float radius = fieldBounds.radius(object);
+          Vec3 toCenter = fieldBounds.center(object) - origin;
+          float along = dot(toCenter, direction);
+          float miss = dot(toCenter, toCenter) - along * along;
+          if (miss > radius * radius)
+            return false;
+          distance = std::max(along - std::sqrt(radius * radius - miss), 0.0f);
+          return true;
+        });
+    if (scene.alive(sim.pickedEntity))
+      scene.setMaterial(scene.indexOf(sim.pickedEntity), LodTint);
+    sim.pickedEntity = INVALID_ENTITY;
+    if (hit.object != Bvh::INVALID) {
+      sim.pickedEntity = scene.entities()[hit.object];
+      scene.setMaterial(hit.object, Picked);
+    }
+  }
+  sim.pickHeld = click;
+}
+
+// culls the sphere field as of the last step and writes out everything the
+// render thread needs for the frame
+void buildSnapshot(Simulation &sim, const InputSample &sample, double time,
+                   double step, JobSystem &jobs, FrameSnapshot &frame) {
+  CpuZone zone("build snapshot");
+  const InputState &input = sim.input;
+  Scene &scene = sim.scene;
+  const CullingSet &fieldBounds = scene.worldBounds();
+  const Camera &camera = sim.camera;
+
+  frame.frame = sim.frame;
+  frame.time = time;
+  frame.step = step;
+  frame.camera = sim.camera;
+  frame.previousCamera = sim.previousCamera;
+  frame.wireframe = input.wireframe;
+  frame.showInstances = input.showInstances;
+  frame.showBatch = input.showBatch;
+  frame.showMesh = input.showMesh && !sim.lods.empty();
+  frame.treeCulling = input.treeCulling;
+  frame.fieldInstances.clear();
+  frame.gridInstances.clear();
+  frame.lodCounts.assign(sim.lods.size(), 0);
+  frame.fieldSize = fieldBounds.size();
+  frame.occludedCount = 0;
+
+  if (frame.showMesh) {
+    // cull the field, pick each survivor's LOD by its projected error,
+    // then group the instances by LOD for one instanced draw each
+    // picks up transform edits, free when nothing moved
+    scene.updateWorld(&jobs);
+    std::vector<std::uint32_t> &visibleObjects = sim.visibleObjects;
+    if (input.treeCulling)
+      sim.fieldTree.queryFrustum(camera.frustum(), visibleObjects);
+    else
+      scene.cull(camera.frustum(), visibleObjects, &jobs);
+
+    if (input.occlusionCulling) {
+      // the nearest visible spheres occlude the rest, each as a cube small
+      // enough to stay inside even the coarsest LOD
+      const std::size_t maxOccluders = 64;
+      const Vec3 occluderCorners[8] = {{-1, -1, -1}, {1, -1, -1}, {-1, 1, -1},
+                                       {1, 1, -1},   {-1, -1, 1}, {1, -1, 1},
+                                       {-1, 1, 1},   {1, 1, 1}};
+      const std::uint32_t occluderIndices[36] = {
+          1, 3, 7, 1, 7, 5, 0, 4, 6, 0, 6, 2, 2, 6, 7, 2, 7, 3,
+          0, 1, 5, 0, 5, 4, 4, 5, 7, 4, 7, 6, 0, 2, 3, 0, 3, 1};
+      auto distance = [&](std::uint32_t object) {
+        return length(fieldBounds.center(object) - camera.position());
+      };
+      std::vector<std::uint32_t> &occluders = sim.occluders;
+      occluders = visibleObjects;
+      std::size_t occluderCount = std::min(occluders.size(), maxOccluders);
+      std::partial_sort(occluders.begin(), occluders.begin() + occluderCount,
+                        occluders.end(), [&](std::uint32_t a, std::uint32_t b) {
+                          return distance(a) < distance(b);
+                        });
+      sim.occlusion.begin(camera.viewProjection());
+      for (std::size_t i = 0; i < occluderCount; i++) {
+        float half = 0.5f * fieldBounds.radius(occluders[i]);
+        sim.occlusion.addOccluder(translate(fieldBounds.center(occluders[i])) *
+                                      scale({half, half, half}),
+                                  occluderCorners, 8, occluderIndices, 36);
+      }
+      sim.occlusion.finish();
+      std::size_t frustumVisible = visibleObjects.size();
+      visibleObjects.erase(
+          std::remove_if(visibleObjects.begin(), visibleObjects.end(),
+                         [&](std::uint32_t object) {
+                           return !sim.occlusion.testBox(
+                               fieldBounds.box(object));
+                         }),
+          visibleObjects.end());
+      frame.occludedCount = frustumVisible - visibleObjects.size();
+    }
+
+    // tints the spheres by their current LOD, finest first
+    const float lodColors[][4] = {{0.9f, 0.9f, 0.9f, 1.0f},
+                                  {0.4f, 0.9f, 0.4f, 1.0f},
+                                  {0.4f, 0.6f, 1.0f, 1.0f},
+                                  {1.0f, 0.8f, 0.3f, 1.0f},
+                                  {1.0f, 0.4f, 0.4f, 1.0f}};
+    const float pickedColor[4] = {1.0f, 0.2f, 1.0f, 1.0f};
+    float screenScale =
+        lodScreenScale(camera.fovY(), static_cast<float>(sample.height));
+    std::vector<std::uint8_t> &visibleLods = sim.visibleLods;
+    visibleLods.resize(visibleObjects.size());
+    for (std::size_t i = 0; i < visibleObjects.size(); i++) {
+      std::uint32_t object = visibleObjects[i];
+      float s = scene.transform(object).scale;
+      float distance =
+          std::max(length(fieldBounds.center(object) - camera.position()) -
+                       fieldBounds.radius(object),
+                   camera.zNear());
+      visibleLods[i] = static_cast<std::uint8_t>(
+          selectLod(sim.lods, distance / s, screenScale));
+      frame.lodCounts[visibleLods[i]]++;
+    }
+    // counting sort by LOD
+    sim.lodCursors.resize(frame.lodCounts.size());
+    std::size_t first = 0;
+    for (std::size_t lod = 0; lod < frame.lodCounts.size(); lod++) {
+      sim.lodCursors[lod] = first;
+      first += frame.lodCounts[lod];
+    }
+    frame.fieldInstances.resize(visibleObjects.size());
+    for (std::size_t i = 0; i < visibleObjects.size(); i++) {
+      std::uint32_t object = visibleObjects[i];
+      InstanceData instance;
+      instance.transform = scene.worldMatrices()[object];
+      std::memcpy(instance.tint,
+                  scene.materials()[object] == Picked
+                      ? pickedColor
+                      : lodColors[visibleLods[i] % 5],
+                  sizeof(instance.tint));
+      frame.fieldInstances[sim.lodCursors[visibleLods[i]]++] = instance;
+    }
+  } else if (input.showInstances) {
+    frame.gridInstances.resize(INSTANCE_GRID_COUNT);
+    buildInstanceGrid(frame.gridInstances.data(), INSTANCE_GRID_COUNT,
+                      static_cast<float>(time));
+  }
+}
+
+int main(int argc, char **argv) {
+  bool instanceStress = false;
+  // --tick-rate <hz> sets the simulation step, --frame-cap <fps> limits the
+  // render loop (0 = uncapped), --no-vsync stops swaps waiting for vblank,
+  // --frames-in-flight <n> is how far the CPU may run ahead of the GPU,
+  // --trace <file.json> records CPU zones and writes them out on exit,
+  // --stats-dump <file.csv|file.json> writes the stats of every frame,
+  // --gl-intercept counts and times every GL call, --gl-check-errors also
+  // checks glGetError after each one, --gl-debug asks for a debug context
+  // and reports the driver's KHR_debug messages
+  double tickRate = 60.0, frameCap = 0.0;
+  bool vsync = true;
+  unsigned int framesInFlight = 2;
+  const char *tracePath = nullptr;
+  const char *statsDumpPath = nullptr;
+  bool glIntercept = false, glCheckErrors = false, glDebug = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--instance-stress") == 0)
+      instanceStress = true;
+    else if (std::strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+      tickRate = std::max(std::atof(argv[++i]), 1.0);
+    else if (std::strcmp(argv[i], "--frame-cap") == 0 && i + 1 < argc)
+      frameCap = std::max(std::atof(argv[++i]), 0.0);
+    else if (std::strcmp(argv[i], "--no-vsync") == 0)
+      vsync = false;
+    else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+      framesInFlight = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      tracePath = argv[++i];
+    else if (std::strcmp(argv[i], "--stats-dump") == 0 && i + 1 < argc)
+      statsDumpPath = argv[++i];
+    else if (std::strcmp(argv[i], "--gl-intercept") == 0)
+      glIntercept = true;
+    else if (std::strcmp(argv[i], "--gl-check-errors") == 0)
+      glIntercept = glCheckErrors = true;
+    else if (std::strcmp(argv[i], "--gl-debug") == 0)
+      glDebug = true;
+    else if (std::strcmp(argv[i], "--import") == 0 && i + 2 < argc)
+      return importMesh(argv[i + 1], argv[i + 2]);
+  }
+  CpuProfiler::setEnabled(tracePath != nullptr);
+  CpuProfiler::setThreadName("main");
+
   // Initialize GLFW tell it to use OpenGL 3.3 core profile
   glfwInit();
+  GlfwSession glfwSession;
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  if (glDebug)
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 
   // Create a GLFW window -------------------
   GLFWwindow *window = glfwCreateWindow(1920, 1080, "LearnOpenGL", NULL, NULL);
   if (window == NULL) {
     std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
     return -1;
   }
   // Make the window's context current
@@ -51,21 +529,55 @@ int main() {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
+  // resolve the post-3.3 entry points we can use when the driver has them
+  loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+  if (glDebug)
+    enableGLDebugOutput();
+  if (glIntercept)
+    installGLIntercept(glCheckErrors);
 
   // tell GLFW the size of the viewport
   glViewport(0, 0, 1920, 1080);
 
   // window resize callback
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  // the driver default varies, so always say which one we want
+  glfwSwapInterval(vsync ? 1 : 0);
+
+  // this thread owns the GL context, so it is the job system's main thread
+  JobSystem jobs;
+
+  // Loading ------------------
+  // image decoding and the sphere import run on the workers while the
+  // shaders compile and the buffers are set up here; the texture uploads come
+  // back to this thread
+  JobCounter loading;
+  unsigned int container_texture = 0, awesome_texture = 0, layered_texture = 0;
+  load2DTextureAsync(jobs, "../textures/container.jpg", &container_texture,
+                     loading);
+  load2DTextureAsync(jobs, "../textures/awesomeface.png", &awesome_texture,
+                     loading);
+  // both images as layers of one array texture for the instanced path
+  static const char *const layerPaths[] = {"../textures/container.jpg",
+                                           "../textures/awesomeface.png"};
+  load2DTextureArrayAsync(jobs, layerPaths, 2, &layered_texture, loading);
+  // imported into the binary format on the first run, later runs just map
+  // the file and upload straight from it
+  const char *sphereMeshPath = "../models/sphere.mesh";
+  MappedMesh sphereFile;
+  jobs.run(
+      [&] {
+        CpuZone zone("import sphere");
+        if (!std::ifstream(sphereMeshPath) || !sphereFile.open(sphereMeshPath))
+          if (importMesh("../models/sphere.obj", sphereMeshPath) == 0)
+            sphereFile.open(sphereMeshPath);
+      },
+      &loading);
 
   // Build Shader ----------------
   Shader shader("../Shaders/vertex_shader.glsl",
                 "../Shaders/fragment_shader.glsl");
 
-  // Textures ------------------
-  unsigned int container_texture = load2DTexture("../textures/container.jpg");
-  unsigned int awesome_texture = load2DTexture("../textures/awesomeface.png");
-
   // Vertex Attributes -------------
   // Steps
   // 0, Copy vertices array to gpu memory (VBO)
@@ -86,6 +598,25 @@ int main() {
       0, 1, 3, // first triangle
       1, 2, 3  // second triangle
   };
+  // declare what a vertex may carry and how it's stored, then drop whatever
+  // the shader doesn't read (the color here): 32 bytes per vertex -> 12
+  VertexFormat quadFormat;
+  quadFormat.add(VertexSemantic::Position, 0, VertexEncoding::Half4)
+      .add(VertexSemantic::Color, 1, VertexEncoding::Unorm8x4)
+      .add(VertexSemantic::TexCoord, 2, VertexEncoding::Unorm16x2);
+  quadFormat.strip(shader.programID);
+  VertexData quadVertices[4];
+  for (int v = 0; v < 4; v++) {
+    std::memcpy(quadVertices[v].position, &vertices[v * 8], 3 * sizeof(float));
+    std::memcpy(quadVertices[v].color, &vertices[v * 8 + 3], 3 * sizeof(float));
+    std::memcpy(quadVertices[v].texCoord, &vertices[v * 8 + 6],
+                2 * sizeof(float));
+  }
+  std::vector<unsigned char> packedVertices;
+  quadFormat.encode(quadVertices, 4, packedVertices);
+  std::cout << "quad vertex size: " << 8 * sizeof(float) << " -> "
+            << quadFormat.stride() << " bytes" << std::endl;
+
   unsigned int VBO, VAO, EBO;
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
@@ -94,54 +625,482 @@ int main() {
   glBindVertexArray(VAO);
 
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(),
+               GL_STATIC_DRAW);
+  labelGLObject(GL_BUFFER, VBO, "quad vertices");
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
                GL_STATIC_DRAW);
+  labelGLObject(GL_BUFFER, EBO, "quad indices");
+
+  // position and texture coord attributes, normalized where quantized
+  quadFormat.apply();
+
+  // Instancing -------------
+  // a second VAO over the same quad buffers plus a per-instance stream
+  Shader instancedShader("../Shaders/instanced_vertex_shader.glsl",
+                         "../Shaders/instanced_fragment_shader.glsl");
+  jobs.wait(loading);
+  unsigned int instancedVAO;
+  glGenVertexArrays(1, &instancedVAO);
+  glBindVertexArray(instancedVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  quadFormat.apply();
+  InstanceBuffer instanceBuffer(instancedVAO);
+  // the animated grid is rewritten every frame, so it lives in the
+  // per-frame ring buffer instead of its own VBO
+  DynamicBuffer frameData(GL_ARRAY_BUFFER, 4 * 1024 * 1024);
+
+  instancedShader.use();
+  instancedShader.setInt("textures", 0);
+
+  DrawPacket instancedQuad;
+  instancedQuad.program = instancedShader.programID;
+  instancedQuad.vao = instancedVAO;
+  instancedQuad.textureTarget = GL_TEXTURE_2D_ARRAY;
+  instancedQuad.textures[0] = layered_texture;
+  instancedQuad.count = 6;
+
+  // Batching -------------
+  // a 16x16 grid of quads sub-allocated from the blocks of a mesh pool, all
+  // of them drawn with a single multi-draw (or a state-change-free loop on
+  // GL 3.3)
+  std::vector<VertexAttrib> quadAttribs = quadFormat.attribs();
+  MeshPool meshPool(quadFormat.stride(), quadAttribs.data(),
+                    quadAttribs.size(), 64 * 1024, 128 * 1024);
+  std::vector<MeshPool::Handle> batchedQuads;
+  for (int y = 0; y < 16; y++)
+    for (int x = 0; x < 16; x++) {
+      VertexData moved[4];
+      std::memcpy(moved, quadVertices, sizeof(quadVertices));
+      for (VertexData &v : moved) {
+        v.position[0] = v.position[0] * 0.1f - 0.9375f + x * 0.125f;
+        v.position[1] = v.position[1] * 0.1f - 0.9375f + y * 0.125f;
+      }
+      quadFormat.encode(moved, 4, packedVertices);
+      MeshPool::Handle handle =
+          meshPool.addMesh(packedVertices.data(), 4, indices, 6);
+      // a quad that didn't fit is left out of the batch
+      if (handle.valid())
+        batchedQuads.push_back(handle);
+    }
+  MeshBatch::Stats poolStats = meshPool.stats();
+  std::cout << "mesh pool: " << meshPool.blockCount() << " block(s), "
+            << poolStats.usedBytes << " of " << poolStats.capacityBytes
+            << " bytes used, " << poolStats.wastedBytes
+            << " wasted to rounding, vertex fragmentation "
+            << poolStats.vertices.fragmentation << std::endl;
+
+  // LOD mesh -------------
+  // loaded above, the upload needs this thread
+  GpuMesh sphere;
+  if (sphereFile.isOpen())
+    sphere = uploadMesh(sphereFile);
+  sphereFile.close();
+  Shader meshShader("../Shaders/mesh_vertex_shader.glsl",
+                    "../Shaders/mesh_fragment_shader.glsl");
+
+  // Scene -------------
+  // a field of spheres culled against the camera frustum on the CPU, the
+  // visible ones are drawn instanced with one draw per LOD. The same spheres
+  // also go into a BVH for the alternative culling path and for picking.
+  Simulation sim;
+  if (sphere.vao != 0)
+    sim.lods = sphere.lods;
+  Scene &scene = sim.scene;
+  const int fieldSide = 64;
+  const std::uint32_t sphereMeshId = 0;
+  scene.reserve(fieldSide * fieldSide);
+  BoundingSphere sphereBounds{{sphere.boundsCenter[0], sphere.boundsCenter[1],
+                               sphere.boundsCenter[2]},
+                              sphere.boundsRadius};
+  for (int z = 0; z < fieldSide; z++)
+    for (int x = 0; x < fieldSide; x++) {
+      Transform transform;
+      transform.position = {(static_cast<float>(x) - fieldSide / 2) * 4.0f,
+                            std::sin(static_cast<float>(x) * 0.7f) +
+                                std::cos(static_cast<float>(z) * 0.5f),
+                            (static_cast<float>(z) - fieldSide / 2) * 4.0f};
+      transform.scale = 1.0f + 0.25f * static_cast<float>((x * 7 + z * 13) % 5);
+      scene.create(transform, sphereBounds, sphereMeshId, LodTint);
+    }
+  scene.updateWorld(&jobs);
+  const CullingSet &fieldBounds = scene.worldBounds();
+  // nothing in the field is ever destroyed, so dense indices double as the
+  // tree's object ids
+  for (std::uint32_t object = 0; object < scene.size(); object++)
+    sim.fieldTree.insert(fieldBounds.box(object), object);
+  sim.fieldTree.rebuild();
+  // every LOD gets its own VAO so each draw can source its own slice of the
+  // frame's instance data
+  std::vector<GLuint> lodVaos;
+  std::vector<std::unique_ptr<InstanceBuffer>> lodInstances;
+  for (std::size_t lod = 0; lod < sphere.lods.size(); lod++) {
+    lodVaos.push_back(createVertexArray(sphere));
+    lodInstances.push_back(std::make_unique<InstanceBuffer>(lodVaos.back()));
+  }
+
+  // samplers take the texture unit, not the texture ID, and uniforms are set
+  // on the bound program
+  shader.use();
+  shader.setInt("texture1", 0);
+  shader.setInt("texture2", 1);
+
+  // frame statistics, F1 toggles them on screen
+  TextOverlay statsOverlay;
+  FrameStatsLog frameStats;
+  if (statsDumpPath)
+    frameStats.openDump(statsDumpPath);
 
-  // position attribute
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(0);
-  // color attribute
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                        (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-  // texture coord attribute
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                        (void *)(6 * sizeof(float)));
-  glEnableVertexAttribArray(2);
-
-  shader.setInt("texture1", container_texture);
-  shader.setInt("texture2", awesome_texture);
+  // everything in the loop goes through the state cache, anything above
+  // touched GL directly so start from a clean slate
+  GLStateCache glState;
+  RenderQueue renderQueue;
+  // packets recorded on the job threads, one buffer per thread, replayed
+  // after the queue's own
+  std::vector<CommandBuffer> commandBuffers(jobs.size());
+  std::vector<const CommandBuffer *> recordedCommands;
+  for (const CommandBuffer &commands : commandBuffers)
+    recordedCommands.push_back(&commands);
+  if (instanceStress) {
+    runInstanceStress(window, glState, renderQueue, instanceBuffer,
+                      instancedQuad);
+    return 0;
+  }
+
+  // Simulation thread -------------
+  // steps the scene at a fixed rate whatever the frame rate is and publishes
+  // a snapshot after each batch of steps, while this thread draws the newest
+  // one. Input goes the other way through `latestInput`.
+  FrameExchange frames;
+  std::mutex inputMutex;
+  InputSample latestInput;
+  pollInput(window, latestInput);
+  std::atomic<bool> simulating{true};
+  std::thread simulationThread([&] {
+    CpuProfiler::setThreadName("simulation");
+    InputSample sample;
+    FixedTimestep ticks(1.0 / tickRate);
+    FramePacer pacer;
+    while (simulating.load(std::memory_order_relaxed)) {
+      int steps = ticks.advance(frameClock());
+      if (steps > 0) {
+        {
+          std::lock_guard<std::mutex> lock(inputMutex);
+          sample = latestInput;
+        }
+        // catching up reuses the sample, edges and mouse motion only count
+        // for the first step
+        for (int step = 0; step < steps; step++)
+          stepSimulation(sim, sample, static_cast<float>(ticks.step()));
+        buildSnapshot(sim, sample, ticks.time(), ticks.step(), jobs,
+                      frames.back());
+        frames.publish();
+      }
+      pacer.sleepUntil(ticks.nextStepTime());
+    }
+  });
+
+  FramePacer framePacer;
+  // frameData's ring only has FRAME_COUNT regions, a CPU further ahead
+  // would write one the GPU may still be reading
+  if (framesInFlight > DynamicBuffer::FRAME_COUNT) {
+    std::cout << "frames in flight clamped to " << DynamicBuffer::FRAME_COUNT
+              << std::endl;
+    framesInFlight = DynamicBuffer::FRAME_COUNT;
+  }
+  FrameSync frameSync(framesInFlight);
+  // per pass GPU times, min/avg/max over each title update
+  GpuTimer gpuTimer;
+  const double framePeriod = frameCap > 0.0 ? 1.0 / frameCap : 0.0;
+  double statsTime = glfwGetTime();
+  std::size_t renderedFrames = 0, repeatedFrames = 0;
+  std::uint64_t frameNumber = 0;
+  double lastFrameStart = frameClock();
+  bool showStats = true, statsKeyHeld = false;
+  GLCallStats lastGLCalls = glCallTotals();
+  std::uint64_t lastPerfWarnings = glDebugCounts().performance;
+  // wait for the first snapshot before starting a frame, still polling and
+  // running the GL work the simulation's jobs hand back to this thread
+  while (!frames.acquire() && !glfwWindowShouldClose(window)) {
+    jobs.pumpMainThread();
+    glfwPollEvents();
+    std::this_thread::yield();
+  }
   // render loop (double buffer)
   while (!glfwWindowShouldClose(window)) {
-    processInput(
-        window); // process input (check for key presses, mouse movements, etc.)
+    double frameStart = frameClock();
+    // the cap sleeps before the snapshot is picked, so it is as new as it
+    // can be when drawn
+    {
+      CpuZone zone("frame cap");
+      framePacer.waitForNextFrame(framePeriod);
+    }
+    // and waits for the GPU, so the input behind it is never more than a
+    // few frames old on screen
+    {
+      CpuZone zone("wait for gpu");
+      frameSync.beginFrame();
+    }
+    // the newest simulated frame; when the simulation fell behind the last
+    // one is drawn again instead of stalling. Never null, the first one was
+    // waited for above
+    bool fresh = false;
+    const FrameSnapshot *frame = frames.acquire(&fresh);
+    // the camera in between the last two steps, so motion stays smooth when
+    // frames and steps don't line up
+    float alpha = static_cast<float>(
+        std::clamp((frameClock() - frame->time) / frame->step, 0.0, 1.0));
+    Camera view = interpolate(frame->previousCamera, frame->camera, alpha);
+    double cpuStart = frameClock();
+    renderedFrames++;
+    repeatedFrames += !fresh;
+    gpuTimer.beginFrame();
+    std::uint32_t framePass = gpuTimer.beginPass("frame");
+    glState.beginFrame();
+    renderQueue.beginFrame();
+    frameData.beginFrame();
+    // goes through the cache, so this is free on frames where nothing toggled
+    glState.polygonMode(frame->wireframe ? GL_LINE : GL_FILL);
     // drawing code ------------------
 
     // clear the screen
-    glClearColor(0.2f, 0.3f, 0.3f,
-                 1.0f);           // set the clear color (background color)
-    glClear(GL_COLOR_BUFFER_BIT); // clear the color buffer (set the background
-                                  // color)
-
-    shader.use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, container_texture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, awesome_texture);
-
-    // bind the VAO and draw the triangle
-    glBindVertexArray(VAO);
-    // using the EBO and the indices
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); // draw the triangle
-    glBindVertexArray(0); // unbind the VAO (optional, but good practice)
-    glfwPollEvents(); // check for events (like key presses, mouse movements,
-                      // etc.)
-    glfwSwapBuffers(window); // swap the front and back buffers
+    glState.clearColor(0.2f, 0.3f, 0.3f,
+                       1.0f);     // set the clear color (background color)
+    bool drawMesh = frame->showMesh && sphere.vao != 0;
+    glState.setDepthTest(drawMesh);
+    {
+      GpuScope pass(gpuTimer, "clear");
+      glClear(GL_COLOR_BUFFER_BIT |
+              GL_DEPTH_BUFFER_BIT); // clear the color buffer (set the
+                                    // background color) and depth buffer
+    }
+
+    // queue the quad, the queue sorts packets and binds program, textures and
+    // VAO through the state cache when it flushes
+    if (drawMesh) {
+      // every LOD as one instanced draw over its slice of the snapshot
+      const std::vector<InstanceData> &visible = frame->fieldInstances;
+      DynamicBuffer::Allocation instanceData =
+          frameData.allocate(visible.size() * sizeof(InstanceData));
+      if (instanceData.data && !visible.empty()) {
+        std::memcpy(instanceData.data, visible.data(),
+                    visible.size() * sizeof(InstanceData));
+        frameData.commit();
+        glState.useProgram(meshShader.programID);
+        meshShader.setMat4("viewProjection", view.viewProjection());
+        std::size_t first = 0;
+        for (std::size_t lod = 0; lod < frame->lodCounts.size(); lod++) {
+          std::size_t count = frame->lodCounts[lod];
+          if (count == 0)
+            continue;
+          lodInstances[lod]->stream(glState, frameData.buffer(),
+                                    instanceData.offset +
+                                        first * sizeof(InstanceData),
+                                    count);
+          first += count;
+          DrawPacket packet;
+          packet.program = meshShader.programID;
+          packet.vao = lodVaos[lod];
+          packet.count = static_cast<GLsizei>(sphere.lods[lod].indexCount);
+          packet.indexType = sphere.indexType;
+          packet.indexOffset =
+              sphere.lods[lod].firstIndex *
+              (sphere.indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+          packet.instanceCount = static_cast<GLsizei>(count);
+          renderQueue.submit(packet);
+        }
+      }
+    } else if (frame->showInstances) {
+      // every copy of the quad in one instanced draw
+      const std::vector<InstanceData> &grid = frame->gridInstances;
+      DynamicBuffer::Allocation gridData =
+          frameData.allocate(grid.size() * sizeof(InstanceData));
+      if (gridData.data && !grid.empty()) {
+        std::memcpy(gridData.data, grid.data(),
+                    grid.size() * sizeof(InstanceData));
+        frameData.commit();
+        instanceBuffer.stream(glState, frameData.buffer(), gridData.offset,
+                              grid.size());
+        DrawPacket packet = instancedQuad;
+        packet.instanceCount = static_cast<GLsizei>(grid.size());
+        renderQueue.submit(packet);
+      }
+    } else if (frame->showBatch) {
+      // one packet per mesh, recorded and sorted across the job threads;
+      // the queue merges them into a multi-draw
+      JobCounter recording;
+      jobs.parallelFor(
+          batchedQuads.size(), 64,
+          [&](std::size_t first, std::size_t last) {
+            CpuZone zone("record packets");
+            CommandBuffer &commands = commandBuffers[jobs.threadIndex()];
+            for (std::size_t i = first; i < last; i++) {
+              MeshBatch &block = meshPool.block(batchedQuads[i].block);
+              const MeshBatch::Mesh &mesh = block.mesh(batchedQuads[i].mesh);
+              DrawPacket packet;
+              packet.program = shader.programID;
+              packet.vao = block.vao();
+              packet.textures[0] = container_texture;
+              packet.textures[1] = awesome_texture;
+              packet.count = static_cast<GLsizei>(mesh.indexCount);
+              packet.indexOffset = mesh.firstIndex * sizeof(GLuint);
+              packet.baseVertex = mesh.baseVertex;
+              commands.draw(packet);
+            }
+          },
+          recording);
+      jobs.wait(recording);
+      jobs.parallelFor(
+          commandBuffers.size(), 1,
+          [&](std::size_t first, std::size_t last) {
+            for (std::size_t b = first; b < last; b++)
+              commandBuffers[b].sort();
+          },
+          recording);
+      jobs.wait(recording);
+    } else {
+      DrawPacket quad;
+      quad.program = shader.programID;
+      quad.vao = VAO;
+      quad.textures[0] = container_texture;
+      quad.textures[1] = awesome_texture;
+      quad.count = 6;
+      renderQueue.submit(quad);
+    }
+    {
+      CpuZone zone("submit queue");
+      GpuScope pass(gpuTimer, "queue");
+      renderQueue.flush(glState);
+    }
+    {
+      CpuZone zone("submit commands");
+      GpuScope pass(gpuTimer, "commands");
+      renderQueue.replay(glState, recordedCommands.data(),
+                         recordedCommands.size());
+    }
+    // a flush of its own after everything else, so the text ends up on top
+    // of the replayed packets too, and filled in wireframe mode
+    if (showStats) {
+      int width, height;
+      glfwGetFramebufferSize(window, &width, &height);
+      std::string lines = formatFrameStats(frameStats.average());
+      if (glDebugOutputEnabled()) {
+        // totals, warnings are too rare for the average to show them
+        GLDebugCounts debug = glDebugCounts();
+        lines += "\nGL DEBUG: PERFORMANCE " +
+                 std::to_string(debug.performance) + "  ERRORS " +
+                 std::to_string(debug.errors) + "  ALL " +
+                 std::to_string(debug.messages);
+      }
+      statsOverlay.print(8.0f, 8.0f, lines);
+      DrawPacket text = statsOverlay.build(glState, width, height);
+      if (text.count > 0) {
+        glState.polygonMode(GL_FILL);
+        renderQueue.submit(text);
+        renderQueue.flush(glState);
+      }
+    }
+    for (CommandBuffer &commands : commandBuffers)
+      commands.reset();
+    frameData.endFrame();
+    gpuTimer.endPass(framePass);
+    gpuTimer.endFrame();
+    double cpuMs = (frameClock() - cpuStart) * 1000.0;
+
+    // show issued vs elided state calls once a second
+    if (glfwGetTime() - statsTime >= 1.0) {
+      statsTime = glfwGetTime();
+      const GLStateCache::Counters &c = glState.counters();
+      const RenderQueue::Stats &q = renderQueue.stats();
+      std::string title =
+          "LearnOpenGL | packets " + std::to_string(q.packets) + " draws " +
+          std::to_string(q.drawCalls) +
+          " | switches program " + std::to_string(q.programSwitches) +
+          " texture " + std::to_string(q.textureSwitches) + " vao " +
+          std::to_string(q.vaoSwitches) + " | state calls issued " +
+          std::to_string(c.issued) + " elided " + std::to_string(c.elided) +
+          " | repeated frames " + std::to_string(repeatedFrames) + "/" +
+          std::to_string(renderedFrames) + " | tick " +
+          std::to_string(static_cast<int>(tickRate)) + " Hz vsync " +
+          (vsync ? "on" : "off") + " | gpu latency " +
+          std::to_string(frameSync.stats().averageLatencyMs) + " ms, " +
+          std::to_string(frameSync.stats().framesInFlight) + "/" +
+          std::to_string(frameSync.maxFramesInFlight()) + " in flight | gpu ms";
+      for (const GpuTimer::PassStats &pass : gpuTimer.passes())
+        title += " " + pass.name + " " + std::to_string(pass.minMs) + "/" +
+                 std::to_string(pass.averageMs()) + "/" +
+                 std::to_string(pass.maxMs);
+      gpuTimer.resetStats();
+      renderedFrames = repeatedFrames = 0;
+      if (drawMesh) {
+        title += std::string(frame->treeCulling ? " | bvh" : " | linear") +
+                 " visible " + std::to_string(frame->fieldInstances.size()) +
+                 "/" + std::to_string(frame->fieldSize) + " occluded " +
+                 std::to_string(frame->occludedCount) + " per lod";
+        for (std::size_t count : frame->lodCounts)
+          title += " " + std::to_string(count);
+      }
+      glfwSetWindowTitle(window, title.c_str());
+    }
+    // GL work the jobs handed back to this thread
+    jobs.pumpMainThread();
+    {
+      CpuZone zone("poll input");
+      glfwPollEvents(); // check for events (like key presses, mouse
+                        // movements, etc.)
+      std::lock_guard<std::mutex> lock(inputMutex);
+      pollInput(window, latestInput);
+      if (keyToggled(latestInput, GLFW_KEY_F1, statsKeyHeld))
+        showStats = !showStats;
+    }
+    {
+      CpuZone zone("swap");
+      glfwSwapBuffers(window); // swap the front and back buffers
+    }
+    frameSync.endFrame();
+
+    FrameStats stats;
+    stats.frame = ++frameNumber;
+    stats.frameMs = (frameStart - lastFrameStart) * 1000.0;
+    lastFrameStart = frameStart;
+    stats.cpuMs = cpuMs;
+    if (const GpuTimer::PassStats *pass = gpuTimer.findPass("frame"))
+      stats.gpuMs = pass->lastMs;
+    stats.latencyMs = frameSync.stats().latencyMs;
+    const RenderQueue::Stats &queueStats = renderQueue.stats();
+    stats.drawCalls = queueStats.drawCalls;
+    stats.packets = queueStats.packets;
+    stats.triangles = queueStats.triangles;
+    stats.stateChanges = queueStats.programSwitches +
+                         queueStats.textureSwitches + queueStats.vaoSwitches;
+    stats.stateCalls = glState.counters().issued;
+    stats.stateCallsElided = glState.counters().elided;
+    takeUploadCounts(stats.bufferUploadBytes, stats.textureUploadBytes);
+    GLCallStats glCalls = glCallTotals();
+    stats.glCalls = static_cast<unsigned int>(glCalls.calls - lastGLCalls.calls);
+    stats.glMs =
+        static_cast<double>(glCalls.nanoseconds - lastGLCalls.nanoseconds) /
+        1.0e6;
+    lastGLCalls = glCalls;
+    std::uint64_t perfWarnings = glDebugCounts().performance;
+    stats.perfWarnings =
+        static_cast<unsigned int>(perfWarnings - lastPerfWarnings);
+    lastPerfWarnings = perfWarnings;
+    frameStats.add(stats);
   }
+  simulating = false;
+  simulationThread.join();
+  if (tracePath && CpuProfiler::writeChromeTrace(tracePath))
+    std::cout << "wrote trace " << tracePath << std::endl;
+  if (glInterceptInstalled())
+    printGLCallReport(20);
   // Cleanup and exit
-  glfwTerminate();
+  lodInstances.clear();
+  if (!lodVaos.empty())
+    glDeleteVertexArrays(static_cast<GLsizei>(lodVaos.size()), lodVaos.data());
+  destroyMesh(sphere);
   return 0;
 }
@@ -0,0 +1,149 @@
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+void computeBounds(MeshData &mesh) {
+  if (mesh.vertices.empty()) {
+    std::fill(mesh.boundsMin, mesh.boundsMin + 3, 0.0f);
+    std::fill(mesh.boundsMax, mesh.boundsMax + 3, 0.0f);
+    return;
+  }
+  for (int i = 0; i < 3; i++) {
+    mesh.boundsMin[i] = mesh.vertices[0].position[i];
+    mesh.boundsMax[i] = mesh.vertices[0].position[i];
+  }
+  for (const VertexData &v : mesh.vertices)
+    for (int i = 0; i < 3; i++) {
+      mesh.boundsMin[i] = std::min(mesh.boundsMin[i], v.position[i]);
+      mesh.boundsMax[i] = std::max(mesh.boundsMax[i], v.position[i]);
+    }
+}
+
+// resolves a 1-based (or negative, relative) OBJ index, -1 when absent
+static int objIndex(const std::string &token, std::size_t count) {
+  if (token.empty())
+    return -1;
+  int index = std::stoi(token);
+  if (index < 0)
+    return static_cast<int>(count) + index;
+  return index - 1;
+}
+
+bool loadOBJ(const char *path, MeshData &mesh) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cout << "ERROR::MESH::FILE_NOT_FOUND " << path << std::endl;
+    return false;
+  }
+  std::vector<float> positions, texCoords, normals;
+  // each distinct v/vt/vn corner becomes one vertex
+  std::map<std::tuple<int, int, int>, std::uint32_t> corners;
+  std::vector<bool> hasNormal;
+  mesh = MeshData{};
+  mesh.name = path;
+
+  std::string line;
+  int lineNumber = 0;
+  try {
+    while (std::getline(file, line)) {
+      lineNumber++;
+      std::istringstream in(line);
+      std::string tag;
+      in >> tag;
+      if (tag == "v") {
+        float x = 0, y = 0, z = 0;
+        in >> x >> y >> z;
+        positions.insert(positions.end(), {x, y, z});
+      } else if (tag == "vt") {
+        float u = 0, v = 0;
+        in >> u >> v;
+        texCoords.insert(texCoords.end(), {u, v});
+      } else if (tag == "vn") {
+        float x = 0, y = 0, z = 0;
+        in >> x >> y >> z;
+        normals.insert(normals.end(), {x, y, z});
+      } else if (tag == "f") {
+        std::vector<std::uint32_t> face;
+        std::string corner;
+        while (in >> corner) {
+          // v, v/vt, v//vn or v/vt/vn
+          std::string parts[3];
+          std::size_t part = 0;
+          for (char c : corner) {
+            if (c == '/')
+              part++;
+            else if (part < 3)
+              parts[part] += c;
+          }
+          int p = objIndex(parts[0], positions.size() / 3);
+          int t = objIndex(parts[1], texCoords.size() / 2);
+          int n = objIndex(parts[2], normals.size() / 3);
+          if (p < 0 || std::size_t(p) * 3 >= positions.size() ||
+              std::size_t(t + 1) * 2 > texCoords.size() ||
+              std::size_t(n + 1) * 3 > normals.size())
+            throw std::out_of_range("index");
+
+          auto key = std::make_tuple(p, t, n);
+          auto it = corners.find(key);
+          if (it == corners.end()) {
+            VertexData v;
+            std::memcpy(v.position, &positions[p * 3], 3 * sizeof(float));
+            if (t >= 0)
+              std::memcpy(v.texCoord, &texCoords[t * 2], 2 * sizeof(float));
+            if (n >= 0)
+              std::memcpy(v.normal, &normals[n * 3], 3 * sizeof(float));
+            it = corners
+                     .emplace(key,
+                              static_cast<std::uint32_t>(mesh.vertices.size()))
+                     .first;
+            mesh.vertices.push_back(v);
+            hasNormal.push_back(n >= 0);
+          }
+          face.push_back(it->second);
+        }
+        // fan triangulation
+        for (std::size_t i = 2; i < face.size(); i++)
+          mesh.indices.insert(mesh.indices.end(),
+                              {face[0], face[i - 1], face[i]});
+      }
+      // o, g, s, usemtl, mtllib, comments: ignored
+    }
+  } catch (const std::exception &) {
+    std::cout << "ERROR::MESH::BAD_OBJ " << path << ":" << lineNumber
+              << std::endl;
+    return false;
+  }
+
+  // flat normals for corners that didn't specify one
+  for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    VertexData &a = mesh.vertices[mesh.indices[i]];
+    VertexData &b = mesh.vertices[mesh.indices[i + 1]];
+    VertexData &c = mesh.vertices[mesh.indices[i + 2]];
+    float e1[3], e2[3], n[3];
+    for (int k = 0; k < 3; k++) {
+      e1[k] = b.position[k] - a.position[k];
+      e2[k] = c.position[k] - a.position[k];
+    }
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len <= 0.0f)
+      continue;
+    for (std::uint32_t index :
+         {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]})
+      if (!hasNormal[index])
+        for (int k = 0; k < 3; k++)
+          mesh.vertices[index].normal[k] = n[k] / len;
+  }
+  computeBounds(mesh);
+  return true;
+}
@@ -0,0 +1,36 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "vertex_format.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One level of detail, a range of MeshData::indices
+struct MeshLod {
+  std::uint32_t firstIndex;
+  std::uint32_t indexCount;
+  float error; // geometric error in mesh units, 0 for the original
+};
+
+// An imported triangle mesh in full precision, before it is encoded into a
+// VertexFormat and uploaded
+struct MeshData {
+  std::string name;
+  std::vector<VertexData> vertices;
+  std::vector<std::uint32_t> indices; // triangle list
+  // empty means a single LOD covering all of `indices`
+  std::vector<MeshLod> lods;
+  float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+  float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// recomputes boundsMin/boundsMax from the vertex positions
+void computeBounds(MeshData &mesh);
+
+// Wavefront OBJ: v/vt/vn/f (polygons are fan triangulated, negative indices
+// work). Faces without normals get flat face normals. Returns false and
+// prints why on failure.
+bool loadOBJ(const char *path, MeshData &mesh);
+#endif
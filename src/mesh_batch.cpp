@@ -0,0 +1,333 @@
+#include "mesh_batch.hpp"
+
+#include "frame_stats.hpp"
+#include "gl_debug.hpp"
+#include "gl_extensions.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+static std::size_t indexSize(GLenum indexType) {
+  switch (indexType) {
+  case GL_UNSIGNED_BYTE:
+    return 1;
+  case GL_UNSIGNED_SHORT:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+IndirectDrawBuffer::~IndirectDrawBuffer() {
+  if (m_buffer)
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void IndirectDrawBuffer::add(const DrawElementsIndirectCommand &command) {
+  if (command.instanceCount == 0)
+    return;
+  if (command.baseInstance != 0 && !glExt.multiDrawIndirect &&
+      !glExt.baseInstance) {
+    static bool s_reported = false;
+    if (!s_reported)
+      std::cout << "ERROR::INDIRECT_DRAW::BASE_INSTANCE_NOT_SUPPORTED"
+                << std::endl;
+    s_reported = true;
+    return;
+  }
+  m_commands.push_back(command);
+}
+
+unsigned int IndirectDrawBuffer::flush(GLenum mode, GLenum indexType) {
+  if (m_commands.empty())
+    return 0;
+  unsigned int drawCalls = 0;
+  if (glExt.multiDrawIndirect) {
+    if (!m_buffer) {
+      glGenBuffers(1, &m_buffer);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+      labelGLObject(GL_BUFFER, m_buffer, "indirect draws");
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+    std::size_t bytes = m_commands.size() * sizeof(DrawElementsIndirectCommand);
+    if (bytes > m_capacity)
+      m_capacity = bytes + bytes / 2;
+    // orphan, last frame's commands may still be in flight
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, m_commands.data());
+    countBufferUpload(bytes);
+    glExt.multiDrawElementsIndirect(mode, indexType, nullptr,
+                                    static_cast<GLsizei>(m_commands.size()), 0);
+    drawCalls = 1;
+  } else {
+    // GL 3.3: same commands, one call each, still no state changes between
+    const std::size_t size = indexSize(indexType);
+    for (const DrawElementsIndirectCommand &c : m_commands) {
+      const void *offset =
+          reinterpret_cast<const void *>(std::uintptr_t(c.firstIndex) * size);
+      // add() only lets baseInstance through with ARB_base_instance here
+      if (c.baseInstance != 0)
+        glExt.drawElementsInstancedBaseVertexBaseInstance(
+            mode, c.count, indexType, offset, c.instanceCount, c.baseVertex,
+            c.baseInstance);
+      else if (c.instanceCount > 1)
+        glDrawElementsInstancedBaseVertex(mode, c.count, indexType, offset,
+                                          c.instanceCount, c.baseVertex);
+      else
+        glDrawElementsBaseVertex(mode, c.count, indexType, offset,
+                                 c.baseVertex);
+    }
+    drawCalls = static_cast<unsigned int>(m_commands.size());
+  }
+  m_commands.clear();
+  return drawCalls;
+}
+
+// smallest block the sub-allocators hand out, in vertices / indices
+static constexpr std::uint32_t MIN_BLOCK = 16;
+
+MeshBatch::MeshBatch(GLsizei vertexStride, const VertexAttrib *attribs,
+                     std::size_t attribCount, std::uint32_t vertexCapacity,
+                     std::uint32_t indexCapacity)
+    : m_stride(vertexStride), m_attribs(attribs, attribs + attribCount),
+      m_vertexAllocator(vertexCapacity, MIN_BLOCK),
+      m_indexAllocator(indexCapacity, MIN_BLOCK) {
+  glGenVertexArrays(1, &m_vao);
+  createBuffers(m_vbo, m_ebo);
+  glBindVertexArray(m_vao);
+  pointAttributes();
+}
+
+MeshBatch::~MeshBatch() {
+  glDeleteVertexArrays(1, &m_vao);
+  glDeleteBuffers(1, &m_vbo);
+  glDeleteBuffers(1, &m_ebo);
+}
+
+void MeshBatch::createBuffers(GLuint &vbo, GLuint &ebo) const {
+  // storage for the whole (rounded up) capacity right away, meshes are
+  // written into it with glBufferSubData. The copy targets leave the bound
+  // VAO's element buffer alone.
+  glGenBuffers(1, &vbo);
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+  labelGLObject(GL_BUFFER, vbo, "mesh batch vertices");
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               static_cast<GLsizeiptr>(m_vertexAllocator.capacity()) * m_stride,
+               nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+  labelGLObject(GL_BUFFER, ebo, "mesh batch indices");
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               static_cast<GLsizeiptr>(m_indexAllocator.capacity()) *
+                   sizeof(GLuint),
+               nullptr, GL_STATIC_DRAW);
+}
+
+// expects m_vao to be bound
+void MeshBatch::pointAttributes() const {
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo); // captured by the VAO
+  for (const VertexAttrib &a : m_attribs) {
+    glVertexAttribPointer(a.location, a.size, a.type, a.normalized, m_stride,
+                          (void *)(std::uintptr_t)a.offset);
+    glEnableVertexAttribArray(a.location);
+  }
+}
+
+std::uint32_t MeshBatch::addMesh(const void *vertices, std::size_t vertexCount,
+                                 const GLuint *indices,
+                                 std::size_t indexCount) {
+  std::uint32_t vertexOffset =
+      m_vertexAllocator.allocate(static_cast<std::uint32_t>(vertexCount));
+  if (vertexOffset == BuddyAllocator::INVALID)
+    return INVALID_MESH;
+  std::uint32_t indexOffset =
+      m_indexAllocator.allocate(static_cast<std::uint32_t>(indexCount));
+  if (indexOffset == BuddyAllocator::INVALID) {
+    m_vertexAllocator.free(vertexOffset);
+    return INVALID_MESH;
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  static_cast<GLintptr>(vertexOffset) * m_stride,
+                  static_cast<GLsizeiptr>(vertexCount) * m_stride, vertices);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  static_cast<GLintptr>(indexOffset) * sizeof(GLuint),
+                  static_cast<GLsizeiptr>(indexCount * sizeof(GLuint)),
+                  indices);
+  countBufferUpload(vertexCount * m_stride + indexCount * sizeof(GLuint));
+
+  Mesh mesh;
+  mesh.firstIndex = indexOffset;
+  mesh.indexCount = static_cast<GLuint>(indexCount);
+  mesh.baseVertex = static_cast<GLint>(vertexOffset);
+  mesh.vertexCount = static_cast<GLuint>(vertexCount);
+  mesh.live = true;
+  if (!m_freeIds.empty()) {
+    std::uint32_t id = m_freeIds.back();
+    m_freeIds.pop_back();
+    m_meshes[id] = mesh;
+    return id;
+  }
+  m_meshes.push_back(mesh);
+  return static_cast<std::uint32_t>(m_meshes.size() - 1);
+}
+
+void MeshBatch::removeMesh(std::uint32_t id) {
+  Mesh &mesh = m_meshes[id];
+  if (!mesh.live)
+    return;
+  m_vertexAllocator.free(static_cast<std::uint32_t>(mesh.baseVertex));
+  m_indexAllocator.free(mesh.firstIndex);
+  mesh.live = false;
+  m_freeIds.push_back(id);
+}
+
+void MeshBatch::defragment(GLStateCache &glState) {
+  // buddy allocation packs perfectly when blocks come in decreasing size
+  std::vector<std::uint32_t> order;
+  for (std::uint32_t id = 0; id < m_meshes.size(); id++)
+    if (m_meshes[id].live)
+      order.push_back(id);
+  std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+    return m_meshes[a].vertexCount > m_meshes[b].vertexCount;
+  });
+
+  BuddyAllocator vertexAllocator(m_vertexAllocator.capacity(), MIN_BLOCK);
+  BuddyAllocator indexAllocator(m_indexAllocator.capacity(), MIN_BLOCK);
+  GLuint vbo, ebo;
+  createBuffers(vbo, ebo);
+
+  for (std::uint32_t id : order) {
+    Mesh &mesh = m_meshes[id];
+    std::uint32_t vertexOffset = vertexAllocator.allocate(mesh.vertexCount);
+    std::uint32_t indexOffset = indexAllocator.allocate(mesh.indexCount);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        static_cast<GLintptr>(mesh.baseVertex) * m_stride,
+                        static_cast<GLintptr>(vertexOffset) * m_stride,
+                        static_cast<GLsizeiptr>(mesh.vertexCount) * m_stride);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glCopyBufferSubData(
+        GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        static_cast<GLintptr>(mesh.firstIndex) * sizeof(GLuint),
+        static_cast<GLintptr>(indexOffset) * sizeof(GLuint),
+        static_cast<GLsizeiptr>(mesh.indexCount) * sizeof(GLuint));
+    mesh.baseVertex = static_cast<GLint>(vertexOffset);
+    mesh.firstIndex = indexOffset;
+  }
+
+  glDeleteBuffers(1, &m_vbo);
+  glDeleteBuffers(1, &m_ebo);
+  m_vbo = vbo;
+  m_ebo = ebo;
+  m_vertexAllocator = vertexAllocator;
+  m_indexAllocator = indexAllocator;
+  glState.bindVertexArray(m_vao);
+  pointAttributes();
+}
+
+MeshBatch::Stats MeshBatch::stats() const {
+  Stats stats;
+  stats.vertices = m_vertexAllocator.stats();
+  stats.indices = m_indexAllocator.stats();
+  stats.capacityBytes =
+      std::size_t(stats.vertices.capacity) * m_stride +
+      std::size_t(stats.indices.capacity) * sizeof(GLuint);
+  stats.usedBytes = std::size_t(stats.vertices.requested) * m_stride +
+                    std::size_t(stats.indices.requested) * sizeof(GLuint);
+  stats.wastedBytes =
+      std::size_t(stats.vertices.allocated - stats.vertices.requested) *
+          m_stride +
+      std::size_t(stats.indices.allocated - stats.indices.requested) *
+          sizeof(GLuint);
+  return stats;
+}
+
+void MeshBatch::draw(std::uint32_t id, GLuint instanceCount) {
+  const Mesh &mesh = m_meshes[id];
+  m_draws.add({mesh.indexCount, instanceCount, mesh.firstIndex,
+               mesh.baseVertex, 0});
+}
+
+unsigned int MeshBatch::flush(GLStateCache &glState) {
+  glState.bindVertexArray(m_vao);
+  return m_draws.flush(GL_TRIANGLES, GL_UNSIGNED_INT);
+}
+
+MeshPool::MeshPool(GLsizei vertexStride, const VertexAttrib *attribs,
+                   std::size_t attribCount, std::uint32_t blockVertices,
+                   std::uint32_t blockIndices)
+    : m_stride(vertexStride), m_attribs(attribs, attribs + attribCount),
+      m_blockVertices(blockVertices), m_blockIndices(blockIndices) {}
+
+MeshPool::Handle MeshPool::addMesh(const void *vertices,
+                                   std::size_t vertexCount,
+                                   const GLuint *indices,
+                                   std::size_t indexCount) {
+  for (std::uint32_t b = 0; b < m_blocks.size(); b++) {
+    std::uint32_t id =
+        m_blocks[b]->addMesh(vertices, vertexCount, indices, indexCount);
+    if (id != MeshBatch::INVALID_MESH)
+      return {b, id};
+  }
+  // no room anywhere, meshes bigger than a block get a block of their own
+  std::uint32_t blockVertices =
+      std::max(m_blockVertices, static_cast<std::uint32_t>(vertexCount));
+  std::uint32_t blockIndices =
+      std::max(m_blockIndices, static_cast<std::uint32_t>(indexCount));
+  m_blocks.push_back(std::make_unique<MeshBatch>(
+      m_stride, m_attribs.data(), m_attribs.size(), blockVertices,
+      blockIndices));
+  std::uint32_t b = static_cast<std::uint32_t>(m_blocks.size() - 1);
+  std::uint32_t id =
+      m_blocks[b]->addMesh(vertices, vertexCount, indices, indexCount);
+  if (id == MeshBatch::INVALID_MESH) {
+    std::cout << "ERROR::MESH_POOL::MESH_NOT_ADDED " << vertexCount
+              << " vertices, " << indexCount << " indices" << std::endl;
+    m_blocks.pop_back(); // an empty block is of no use to anyone
+  }
+  return {b, id};
+}
+
+void MeshPool::removeMesh(Handle handle) {
+  if (!handle.valid())
+    return;
+  m_blocks[handle.block]->removeMesh(handle.mesh);
+}
+
+void MeshPool::defragment(GLStateCache &glState) {
+  for (std::unique_ptr<MeshBatch> &block : m_blocks)
+    block->defragment(glState);
+}
+
+MeshBatch::Stats MeshPool::stats() const {
+  MeshBatch::Stats total;
+  for (const std::unique_ptr<MeshBatch> &block : m_blocks) {
+    MeshBatch::Stats s = block->stats();
+    total.capacityBytes += s.capacityBytes;
+    total.usedBytes += s.usedBytes;
+    total.wastedBytes += s.wastedBytes;
+    total.vertices.capacity += s.vertices.capacity;
+    total.vertices.requested += s.vertices.requested;
+    total.vertices.allocated += s.vertices.allocated;
+    total.vertices.allocations += s.vertices.allocations;
+    total.vertices.largestFree =
+        std::max(total.vertices.largestFree, s.vertices.largestFree);
+    total.vertices.fragmentation =
+        std::max(total.vertices.fragmentation, s.vertices.fragmentation);
+    total.indices.capacity += s.indices.capacity;
+    total.indices.requested += s.indices.requested;
+    total.indices.allocated += s.indices.allocated;
+    total.indices.allocations += s.indices.allocations;
+    total.indices.largestFree =
+        std::max(total.indices.largestFree, s.indices.largestFree);
+    total.indices.fragmentation =
+        std::max(total.indices.fragmentation, s.indices.fragmentation);
+  }
+  return total;
+}
@@ -0,0 +1,151 @@
+#ifndef MESH_BATCH_H
+#define MESH_BATCH_H
+
+#include "buddy_allocator.hpp"
+#include "gl_state_cache.hpp"
+#include "vertex_format.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Layout of GL's DrawElementsIndirectCommand
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// Accumulates indexed draws that share a VAO and emits them in one
+// glMultiDrawElementsIndirect (GL 4.3) or, on plain GL 3.3, a tight loop of
+// glDrawElementsBaseVertex with no state changes in between.
+class IndirectDrawBuffer {
+public:
+  IndirectDrawBuffer() = default;
+  ~IndirectDrawBuffer();
+  IndirectDrawBuffer(const IndirectDrawBuffer &) = delete;
+  IndirectDrawBuffer &operator=(const IndirectDrawBuffer &) = delete;
+
+  // commands with no instances are dropped. A non-zero baseInstance needs
+  // multi-draw indirect or ARB_base_instance, without either the command is
+  // rejected (logged) rather than drawn reading the wrong instances
+  void add(const DrawElementsIndirectCommand &command);
+  bool empty() const { return m_commands.empty(); }
+  std::size_t size() const { return m_commands.size(); }
+
+  // draws everything with the currently bound VAO and program, clears the
+  // buffer and returns the number of GL draw calls it took
+  unsigned int flush(GLenum mode, GLenum indexType);
+
+private:
+  std::vector<DrawElementsIndirectCommand> m_commands;
+  GLuint m_buffer = 0;
+  std::size_t m_capacity = 0;
+};
+
+// Packs many meshes that share a vertex layout into one VBO/EBO pair behind
+// a single VAO. Vertex and index ranges are sub-allocated with buddy
+// allocators (in vertices and indices, so a range offset is directly the
+// base vertex / first index), which lets meshes come and go without
+// reallocating, and defragment() compacts everything on the GPU.
+class MeshBatch {
+public:
+  static constexpr std::uint32_t INVALID_MESH = 0xFFFFFFFFu;
+
+  struct Mesh {
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLint baseVertex;
+    GLuint vertexCount;
+    bool live;
+  };
+
+  struct Stats {
+    BuddyAllocator::Stats vertices;
+    BuddyAllocator::Stats indices;
+    std::size_t capacityBytes = 0;
+    std::size_t usedBytes = 0;   // bytes the meshes actually need
+    std::size_t wastedBytes = 0; // lost to rounding blocks up
+  };
+
+  MeshBatch(GLsizei vertexStride, const VertexAttrib *attribs,
+            std::size_t attribCount, std::uint32_t vertexCapacity,
+            std::uint32_t indexCapacity);
+  ~MeshBatch();
+  MeshBatch(const MeshBatch &) = delete;
+  MeshBatch &operator=(const MeshBatch &) = delete;
+
+  // uploads the mesh into free space, returns its id or INVALID_MESH when it
+  // doesn't fit. Indices are relative to the mesh's own vertices.
+  std::uint32_t addMesh(const void *vertices, std::size_t vertexCount,
+                        const GLuint *indices, std::size_t indexCount);
+  void removeMesh(std::uint32_t id);
+  // repacks the live meshes into fresh buffers with glCopyBufferSubData,
+  // mesh ids stay valid but their offsets change
+  void defragment(GLStateCache &glState);
+
+  const Mesh &mesh(std::uint32_t id) const { return m_meshes[id]; }
+  std::size_t meshCount() const { return m_meshes.size(); }
+  GLuint vao() const { return m_vao; }
+  Stats stats() const;
+
+  // queue one draw of a mesh, emitted by flush()
+  void draw(std::uint32_t id, GLuint instanceCount = 1);
+  unsigned int flush(GLStateCache &glState);
+
+private:
+  void createBuffers(GLuint &vbo, GLuint &ebo) const;
+  void pointAttributes() const;
+
+  GLsizei m_stride;
+  std::vector<VertexAttrib> m_attribs;
+  GLuint m_vao = 0, m_vbo = 0, m_ebo = 0;
+  BuddyAllocator m_vertexAllocator;
+  BuddyAllocator m_indexAllocator;
+  std::vector<Mesh> m_meshes;
+  std::vector<std::uint32_t> m_freeIds;
+  IndirectDrawBuffer m_draws;
+};
+
+// A handful of MeshBatch blocks with the same layout. Meshes go into the
+// first block with room, a new block is only created when none has.
+//
+// Blocks own their VAO and buffers, destroy the pool while the GL context is
+// current.
+class MeshPool {
+public:
+  struct Handle {
+    std::uint32_t block;
+    std::uint32_t mesh; // MeshBatch::INVALID_MESH when the add failed
+
+    bool valid() const { return mesh != MeshBatch::INVALID_MESH; }
+  };
+
+  MeshPool(GLsizei vertexStride, const VertexAttrib *attribs,
+           std::size_t attribCount, std::uint32_t blockVertices,
+           std::uint32_t blockIndices);
+
+  // an invalid handle when not even a new block can take the mesh
+  Handle addMesh(const void *vertices, std::size_t vertexCount,
+                 const GLuint *indices, std::size_t indexCount);
+  void removeMesh(Handle handle);
+  void defragment(GLStateCache &glState);
+
+  MeshBatch &block(std::uint32_t index) { return *m_blocks[index]; }
+  std::size_t blockCount() const { return m_blocks.size(); }
+  // summed over every block, largestFree / fragmentation are the worst
+  // block's values
+  MeshBatch::Stats stats() const;
+
+private:
+  GLsizei m_stride;
+  std::vector<VertexAttrib> m_attribs;
+  std::uint32_t m_blockVertices, m_blockIndices;
+  std::vector<std::unique_ptr<MeshBatch>> m_blocks;
+};
+#endif
@@ -0,0 +1,319 @@
+#include "mesh_file.hpp"
+
+#include "frame_stats.hpp"
+#include "gl_debug.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MESH_MAGIC[4] = {'L', 'M', 'S', 'H'};
+
+static std::uint32_t alignUp(std::size_t value) {
+  return static_cast<std::uint32_t>((value + MESH_FILE_ALIGNMENT - 1) /
+                                    MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT);
+}
+
+// bytes one attribute reads from a vertex, 0 for anything we never write
+static std::size_t attribBytes(const VertexAttrib &attrib) {
+  if (attrib.size < 1 || attrib.size > 4)
+    return 0;
+  std::size_t component = 0;
+  switch (attrib.type) {
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+    component = 1;
+    break;
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+  case GL_HALF_FLOAT:
+    component = 2;
+    break;
+  case GL_INT:
+  case GL_UNSIGNED_INT:
+  case GL_FLOAT:
+    component = 4;
+    break;
+  }
+  return component * static_cast<std::size_t>(attrib.size);
+}
+
+bool writeMeshFile(const char *path, const MeshData &mesh,
+                   const VertexFormat &format) {
+  std::vector<unsigned char> vertexData;
+  format.encode(mesh.vertices.data(), mesh.vertices.size(), vertexData);
+  std::vector<unsigned char> indexData;
+  GLenum indexType = packIndices(mesh.indices, mesh.vertices.size(), indexData);
+  std::vector<VertexAttrib> attribs = format.attribs();
+  std::vector<MeshLod> lods = mesh.lods;
+  if (lods.empty())
+    lods.push_back({0, static_cast<std::uint32_t>(mesh.indices.size()), 0.0f});
+
+  MeshFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MESH_MAGIC, 4);
+  header.version = MESH_FILE_VERSION;
+  header.vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+  header.indexCount = static_cast<std::uint32_t>(mesh.indices.size());
+  header.indexType = indexType;
+  header.streamCount = 1;
+  header.attribCount = static_cast<std::uint32_t>(attribs.size());
+  header.lodCount = static_cast<std::uint32_t>(lods.size());
+  for (int i = 0; i < 3; i++) {
+    header.boundsMin[i] = mesh.boundsMin[i];
+    header.boundsMax[i] = mesh.boundsMax[i];
+    header.boundsCenter[i] = 0.5f * (mesh.boundsMin[i] + mesh.boundsMax[i]);
+  }
+  for (const VertexData &v : mesh.vertices) {
+    float d[3] = {v.position[0] - header.boundsCenter[0],
+                  v.position[1] - header.boundsCenter[1],
+                  v.position[2] - header.boundsCenter[2]};
+    header.boundsRadius = std::max(
+        header.boundsRadius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+  }
+
+  // tables right after the header, then the aligned data blocks
+  std::size_t tables = sizeof(MeshFileHeader) + sizeof(MeshFileStream) +
+                       attribs.size() * sizeof(VertexAttrib) +
+                       lods.size() * sizeof(MeshLod);
+  MeshFileStream stream;
+  stream.dataOffset = alignUp(tables);
+  stream.dataSize = static_cast<std::uint32_t>(vertexData.size());
+  stream.stride = static_cast<std::uint32_t>(format.stride());
+  stream.firstAttrib = 0;
+  stream.attribCount = header.attribCount;
+  header.indexDataOffset = alignUp(stream.dataOffset + stream.dataSize);
+  header.indexDataSize = static_cast<std::uint32_t>(indexData.size());
+  header.fileSize = header.indexDataOffset + header.indexDataSize;
+
+  std::vector<unsigned char> bytes(header.fileSize, 0);
+  unsigned char *cursor = bytes.data();
+  std::memcpy(cursor, &header, sizeof(header));
+  cursor += sizeof(header);
+  std::memcpy(cursor, &stream, sizeof(stream));
+  cursor += sizeof(stream);
+  for (const VertexAttrib &attrib : attribs) {
+    // zero the struct padding so files are reproducible
+    VertexAttrib clean;
+    std::memset(&clean, 0, sizeof(clean));
+    clean.location = attrib.location;
+    clean.size = attrib.size;
+    clean.type = attrib.type;
+    clean.normalized = attrib.normalized;
+    clean.offset = attrib.offset;
+    std::memcpy(cursor, &clean, sizeof(clean));
+    cursor += sizeof(clean);
+  }
+  std::memcpy(cursor, lods.data(), lods.size() * sizeof(MeshLod));
+  std::memcpy(bytes.data() + stream.dataOffset, vertexData.data(),
+              vertexData.size());
+  std::memcpy(bytes.data() + header.indexDataOffset, indexData.data(),
+              indexData.size());
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  if (!file) {
+    std::cout << "ERROR::MESH::CANNOT_WRITE " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+MappedMesh::~MappedMesh() { close(); }
+
+void MappedMesh::close() {
+  if (!m_data)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mapping);
+  CloseHandle(m_file);
+  m_mapping = m_file = nullptr;
+#else
+  munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+  m_path.clear();
+}
+
+const MeshFileStream *MappedMesh::streams() const {
+  return reinterpret_cast<const MeshFileStream *>(m_data +
+                                                  sizeof(MeshFileHeader));
+}
+
+const VertexAttrib *MappedMesh::attribs() const {
+  return reinterpret_cast<const VertexAttrib *>(
+      streams() + header().streamCount);
+}
+
+const MeshLod *MappedMesh::lods() const {
+  return reinterpret_cast<const MeshLod *>(attribs() + header().attribCount);
+}
+
+bool MappedMesh::open(const char *path) {
+  close();
+  m_path = path;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::cout << "ERROR::MESH::FILE_NOT_FOUND " << path << std::endl;
+    return false;
+  }
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const void *data =
+      mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!data) {
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    std::cout << "ERROR::MESH::MMAP_FAILED " << path << std::endl;
+    return false;
+  }
+  m_file = file;
+  m_mapping = mapping;
+  m_data = static_cast<const unsigned char *>(data);
+  m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cout << "ERROR::MESH::FILE_NOT_FOUND " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    std::cout << "ERROR::MESH::BAD_FILE " << path << std::endl;
+    return false;
+  }
+  void *data = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                    PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file alive
+  if (data == MAP_FAILED) {
+    std::cout << "ERROR::MESH::MMAP_FAILED " << path << std::endl;
+    return false;
+  }
+  m_data = static_cast<const unsigned char *>(data);
+  m_size = static_cast<std::size_t>(info.st_size);
+#endif
+
+  // validate everything the accessors will dereference
+  bool valid = m_size >= sizeof(MeshFileHeader) &&
+               std::memcmp(header().magic, MESH_MAGIC, 4) == 0 &&
+               header().version == MESH_FILE_VERSION &&
+               header().fileSize == m_size && header().streamCount <= 4;
+  if (valid) {
+    const MeshFileHeader &h = header();
+    std::size_t tables = sizeof(MeshFileHeader) +
+                         std::size_t(h.streamCount) * sizeof(MeshFileStream) +
+                         std::size_t(h.attribCount) * sizeof(VertexAttrib) +
+                         std::size_t(h.lodCount) * sizeof(MeshLod);
+    std::size_t indexSize = h.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    valid = (h.indexType == GL_UNSIGNED_SHORT ||
+             h.indexType == GL_UNSIGNED_INT) &&
+            tables <= m_size &&
+            std::size_t(h.indexDataOffset) + h.indexDataSize <= m_size &&
+            std::size_t(h.indexCount) * indexSize == h.indexDataSize;
+    for (std::uint32_t s = 0; valid && s < h.streamCount; s++) {
+      const MeshFileStream &stream = streams()[s];
+      valid = std::size_t(stream.dataOffset) + stream.dataSize <= m_size &&
+              std::size_t(stream.firstAttrib) + stream.attribCount <=
+                  h.attribCount &&
+              std::size_t(stream.stride) * h.vertexCount <= stream.dataSize;
+      // every attribute has to stay inside its vertex, or the last
+      // vertex's reads run past the stream
+      for (std::uint32_t a = 0; valid && a < stream.attribCount; a++) {
+        const VertexAttrib &attrib = attribs()[stream.firstAttrib + a];
+        std::size_t bytes = attribBytes(attrib);
+        valid = bytes > 0 &&
+                std::size_t(attrib.offset) + bytes <= stream.stride;
+      }
+    }
+    for (std::uint32_t l = 0; valid && l < h.lodCount; l++)
+      valid = std::size_t(lods()[l].firstIndex) + lods()[l].indexCount <=
+              h.indexCount;
+  }
+  if (!valid) {
+    std::cout << "ERROR::MESH::BAD_FILE " << path << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+GpuMesh uploadMesh(const MappedMesh &mesh) {
+  const MeshFileHeader &header = mesh.header();
+  GpuMesh gpu;
+  gpu.streams.assign(mesh.streams(), mesh.streams() + header.streamCount);
+  gpu.attribs.assign(mesh.attribs(), mesh.attribs() + header.attribCount);
+  glGenBuffers(static_cast<GLsizei>(header.streamCount), gpu.vbos);
+  for (std::uint32_t s = 0; s < header.streamCount; s++) {
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.vbos[s]);
+    glBufferData(GL_ARRAY_BUFFER, gpu.streams[s].dataSize, mesh.streamData(s),
+                 GL_STATIC_DRAW);
+    labelGLObject(GL_BUFFER, gpu.vbos[s],
+                  mesh.path() + " stream " + std::to_string(s));
+  }
+  glGenBuffers(1, &gpu.ebo);
+  // the element binding is VAO state, so upload it through the VAO
+  gpu.vao = createVertexArray(gpu);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, header.indexDataSize, mesh.indexData(),
+               GL_STATIC_DRAW);
+  labelGLObject(GL_BUFFER, gpu.ebo, mesh.path() + " indices");
+  labelGLObject(GL_VERTEX_ARRAY, gpu.vao, mesh.path());
+  std::size_t bytes = header.indexDataSize;
+  for (std::uint32_t s = 0; s < header.streamCount; s++)
+    bytes += gpu.streams[s].dataSize;
+  countBufferUpload(bytes);
+
+  gpu.indexType = header.indexType;
+  gpu.lods.assign(mesh.lods(), mesh.lods() + header.lodCount);
+  std::memcpy(gpu.boundsCenter, header.boundsCenter, sizeof(gpu.boundsCenter));
+  gpu.boundsRadius = header.boundsRadius;
+  return gpu;
+}
+
+GLuint createVertexArray(const GpuMesh &mesh) {
+  GLuint vao;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  for (std::size_t s = 0; s < mesh.streams.size(); s++) {
+    const MeshFileStream &stream = mesh.streams[s];
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[s]);
+    for (std::uint32_t a = 0; a < stream.attribCount; a++) {
+      const VertexAttrib &attrib = mesh.attribs[stream.firstAttrib + a];
+      glVertexAttribPointer(attrib.location, attrib.size, attrib.type,
+                            attrib.normalized,
+                            static_cast<GLsizei>(stream.stride),
+                            (void *)(std::uintptr_t)attrib.offset);
+      glEnableVertexAttribArray(attrib.location);
+    }
+  }
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+  return vao;
+}
+
+void destroyMesh(GpuMesh &mesh) {
+  glDeleteVertexArrays(1, &mesh.vao);
+  glDeleteBuffers(4, mesh.vbos);
+  glDeleteBuffers(1, &mesh.ebo);
+  mesh = GpuMesh{};
+}
@@ -0,0 +1,117 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include "mesh.hpp"
+#include "vertex_format.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary mesh container (.mesh). Everything the GPU needs is stored already
+// encoded, so loading is an mmap and glBufferData straight out of the
+// mapping: no parsing, no intermediate copies.
+//
+//   MeshFileHeader
+//   MeshFileStream[streamCount]   vertex stream descriptors
+//   VertexAttrib[attribCount]     attribute layouts of all streams
+//   MeshLod[lodCount]             index ranges, finest first
+//   ... vertex stream data, index data (each MESH_FILE_ALIGNMENT aligned)
+//
+// All integers are little endian, offsets are from the start of the file.
+
+static constexpr std::uint32_t MESH_FILE_VERSION = 2;
+static constexpr std::uint32_t MESH_FILE_ALIGNMENT = 64;
+
+struct MeshFileHeader {
+  char magic[4]; // "LMSH"
+  std::uint32_t version;
+  std::uint32_t fileSize;
+  std::uint32_t vertexCount;
+  std::uint32_t indexCount; // all LODs together
+  std::uint32_t indexType;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  std::uint32_t streamCount;
+  std::uint32_t attribCount;
+  std::uint32_t lodCount;
+  std::uint32_t indexDataOffset;
+  std::uint32_t indexDataSize;
+  float boundsMin[3];
+  float boundsMax[3];
+  float boundsCenter[3]; // bounding sphere
+  float boundsRadius;
+};
+
+struct MeshFileStream {
+  std::uint32_t dataOffset;
+  std::uint32_t dataSize;
+  std::uint32_t stride;
+  std::uint32_t firstAttrib; // into the attribute table
+  std::uint32_t attribCount;
+};
+
+// writes `mesh` with its vertices encoded as `format` (one interleaved
+// stream) and 16-bit indices when they fit
+bool writeMeshFile(const char *path, const MeshData &mesh,
+                   const VertexFormat &format);
+
+// A read-only memory mapped .mesh file. The accessors point straight into
+// the mapping and stay valid as long as the object lives.
+class MappedMesh {
+public:
+  MappedMesh() = default;
+  ~MappedMesh();
+  MappedMesh(const MappedMesh &) = delete;
+  MappedMesh &operator=(const MappedMesh &) = delete;
+
+  // maps and validates the file, prints why on failure
+  bool open(const char *path);
+  void close();
+  bool isOpen() const { return m_data != nullptr; }
+  const std::string &path() const { return m_path; }
+
+  const MeshFileHeader &header() const {
+    return *reinterpret_cast<const MeshFileHeader *>(m_data);
+  }
+  const MeshFileStream *streams() const;
+  const VertexAttrib *attribs() const;
+  const MeshLod *lods() const;
+  const void *streamData(std::uint32_t stream) const {
+    return m_data + streams()[stream].dataOffset;
+  }
+  const void *indexData() const { return m_data + header().indexDataOffset; }
+
+private:
+  const unsigned char *m_data = nullptr;
+  std::size_t m_size = 0;
+  std::string m_path;
+#ifdef _WIN32
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+// A mesh living in its own VAO/VBO/EBO, created from a mapped file
+struct GpuMesh {
+  GLuint vao = 0;
+  GLuint vbos[4] = {};
+  GLuint ebo = 0;
+  GLenum indexType = GL_UNSIGNED_INT;
+  std::vector<MeshLod> lods;
+  float boundsCenter[3] = {0.0f, 0.0f, 0.0f};
+  float boundsRadius = 0.0f;
+  // layout, kept to build more VAOs over the same buffers
+  std::vector<MeshFileStream> streams;
+  std::vector<VertexAttrib> attribs;
+};
+
+// uploads every stream and the index data directly from the mapping, the
+// buffers are labelled with the file's path. The VAO is left bound.
+GpuMesh uploadMesh(const MappedMesh &mesh);
+// another VAO over the buffers of `mesh`, e.g. to attach a per-instance
+// stream to. Left bound, the caller owns it.
+GLuint createVertexArray(const GpuMesh &mesh);
+void destroyMesh(GpuMesh &mesh);
+#endif
@@ -0,0 +1,382 @@
+#include "mesh_lod.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+// symmetric 4x4 plane quadric plus the face area it was accumulated from
+struct Quadric {
+  double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0,
+         cd = 0, d2 = 0;
+  double weight = 0;
+
+  void addPlane(double a, double b, double c, double d, double w) {
+    a2 += w * a * a;
+    ab += w * a * b;
+    ac += w * a * c;
+    ad += w * a * d;
+    b2 += w * b * b;
+    bc += w * b * c;
+    bd += w * b * d;
+    c2 += w * c * c;
+    cd += w * c * d;
+    d2 += w * d * d;
+  }
+
+  void add(const Quadric &q) {
+    a2 += q.a2;
+    ab += q.ab;
+    ac += q.ac;
+    ad += q.ad;
+    b2 += q.b2;
+    bc += q.bc;
+    bd += q.bd;
+    c2 += q.c2;
+    cd += q.cd;
+    d2 += q.d2;
+    weight += q.weight;
+  }
+
+  // weighted sum of squared plane distances of `p`
+  double evaluate(const float *p) const {
+    double x = p[0], y = p[1], z = p[2];
+    double e = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+               2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y +
+                      cd * z);
+    return e > 0.0 ? e : 0.0;
+  }
+};
+
+// open borders are kept much stiffer than the surface
+const double BORDER_WEIGHT = 10.0;
+
+enum class VertexKind : std::uint8_t { Manifold, Border, Locked };
+
+struct Collapse {
+  std::uint32_t from; // vertex that disappears
+  std::uint32_t to;   // vertex it's welded onto
+  double error;
+};
+
+std::uint64_t edgeKey(std::uint32_t a, std::uint32_t b) {
+  if (a > b)
+    std::swap(a, b);
+  return (std::uint64_t(a) << 32) | b;
+}
+
+void triangleNormal(const float *a, const float *b, const float *c,
+                    double *n) {
+  double e1[3], e2[3];
+  for (int k = 0; k < 3; k++) {
+    e1[k] = double(b[k]) - a[k];
+    e2[k] = double(c[k]) - a[k];
+  }
+  n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+} // namespace
+
+// Simplifies towards each of the descending `targets` in turn and snapshots
+// the result, so a whole LOD chain costs about as much as its coarsest level
+// and every level's error is measured against the original surface.
+static std::vector<float>
+simplifyChain(const std::vector<VertexData> &vertices,
+              const std::vector<std::uint32_t> &indices,
+              const std::vector<std::size_t> &targets,
+              std::vector<std::vector<std::uint32_t>> &levels) {
+  const std::size_t vertexCount = vertices.size();
+  std::vector<std::uint32_t> out;
+
+  // vertices sharing a position (split by normal/uv seams) are one point of
+  // the surface, `position` maps every vertex to the first of them
+  std::vector<std::uint32_t> order(vertexCount);
+  std::iota(order.begin(), order.end(), 0u);
+  auto positionLess = [&](std::uint32_t a, std::uint32_t b) {
+    return std::memcmp(vertices[a].position, vertices[b].position,
+                       sizeof(vertices[a].position)) < 0;
+  };
+  std::sort(order.begin(), order.end(), positionLess);
+  std::vector<std::uint32_t> position(vertexCount);
+  for (std::size_t i = 0; i < vertexCount; i++)
+    position[order[i]] = (i > 0 && !positionLess(order[i - 1], order[i]))
+                             ? position[order[i - 1]]
+                             : order[i];
+  auto p = [&](std::uint32_t v) { return vertices[v].position; };
+
+  // zero area triangles don't draw anything, dropping them up front keeps
+  // the topology below clean
+  out.clear();
+  for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+    if (position[a] != position[b] && position[b] != position[c] &&
+        position[c] != position[a])
+      out.insert(out.end(), {a, b, c});
+  }
+
+  // surface quadrics, area weighted, per position
+  std::vector<Quadric> quadrics(vertexCount);
+  for (std::size_t i = 0; i < out.size(); i += 3) {
+    double n[3];
+    triangleNormal(p(out[i]), p(out[i + 1]), p(out[i + 2]), n);
+    double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len <= 0.0)
+      continue;
+    double a = n[0] / len, b = n[1] / len, c = n[2] / len;
+    const float *v0 = p(out[i]);
+    double d = -(a * v0[0] + b * v0[1] + c * v0[2]);
+    double area = 0.5 * len;
+    for (int k = 0; k < 3; k++) {
+      Quadric &q = quadrics[position[out[i + k]]];
+      q.addPlane(a, b, c, d, area);
+      q.weight += area;
+    }
+  }
+
+  std::unordered_map<std::uint64_t, std::uint32_t> edges;
+  std::vector<std::uint32_t> wedges(vertexCount);
+  std::vector<VertexKind> kind(vertexCount);
+  std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1);
+  std::vector<std::uint32_t> adjacency;
+  std::vector<Collapse> collapses;
+  std::vector<bool> locked(vertexCount);
+  std::vector<std::uint32_t> remap(vertexCount);
+  bool bordersInitialized = false;
+  double maxError = 0.0;
+
+  std::vector<float> errors;
+  bool stuck = false;
+  for (std::size_t targetIndexCount : targets) {
+    while (!stuck && out.size() > targetIndexCount) {
+      // classify the current topology, in position space
+      edges.clear();
+      for (std::size_t i = 0; i < out.size(); i += 3)
+        for (int k = 0; k < 3; k++)
+          edges[edgeKey(position[out[i + k]], position[out[i + (k + 1) % 3]])]++;
+      std::fill(wedges.begin(), wedges.end(), 0u);
+      std::fill(kind.begin(), kind.end(), VertexKind::Manifold);
+      std::vector<bool> used(vertexCount);
+      for (std::uint32_t v : out)
+        if (!used[v]) {
+          used[v] = true;
+          wedges[position[v]]++;
+        }
+      for (std::size_t i = 0; i < out.size(); i += 3)
+        for (int k = 0; k < 3; k++) {
+          std::uint32_t a = out[i + k], b = out[i + (k + 1) % 3];
+          std::uint32_t count = edges[edgeKey(position[a], position[b])];
+          for (std::uint32_t v : {position[a], position[b]}) {
+            if (count > 2)
+              kind[v] = VertexKind::Locked;
+            else if (count == 1 && kind[v] == VertexKind::Manifold)
+              kind[v] = VertexKind::Border;
+          }
+          if (count == 1 && !bordersInitialized) {
+            // a plane through the border edge, perpendicular to the face
+            double n[3];
+            triangleNormal(p(out[i]), p(out[i + 1]), p(out[i + 2]), n);
+            double e[3] = {double(p(b)[0]) - p(a)[0], double(p(b)[1]) - p(a)[1],
+                           double(p(b)[2]) - p(a)[2]};
+            double m[3] = {e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2],
+                           e[0] * n[1] - e[1] * n[0]};
+            double len = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+            if (len > 0.0) {
+              double d = -(m[0] * p(a)[0] + m[1] * p(a)[1] + m[2] * p(a)[2]);
+              double w =
+                  BORDER_WEIGHT * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+              quadrics[position[a]].addPlane(m[0] / len, m[1] / len, m[2] / len,
+                                             d / len, w);
+              quadrics[position[b]].addPlane(m[0] / len, m[1] / len, m[2] / len,
+                                             d / len, w);
+            }
+          }
+        }
+      bordersInitialized = true;
+      for (std::size_t v = 0; v < vertexCount; v++)
+        if (wedges[v] > 1)
+          kind[v] = VertexKind::Locked; // attribute seam
+
+      // triangles around every position
+      std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+      for (std::uint32_t v : out)
+        adjacencyOffsets[position[v] + 1]++;
+      for (std::size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+      adjacency.resize(out.size());
+      {
+        std::vector<std::uint32_t> fill(adjacencyOffsets.begin(),
+                                        adjacencyOffsets.end() - 1);
+        for (std::size_t i = 0; i < out.size(); i++)
+          adjacency[fill[position[out[i]]]++] = static_cast<std::uint32_t>(i / 3);
+      }
+
+      // cheapest legal collapse of every vertex
+      collapses.clear();
+      std::vector<std::size_t> best(vertexCount, SIZE_MAX);
+      for (std::size_t i = 0; i < out.size(); i += 3)
+        for (int k = 0; k < 6; k++) {
+          std::uint32_t from = out[i + k % 3];
+          std::uint32_t to = out[i + (k % 3 + (k < 3 ? 1 : 2)) % 3];
+          std::uint32_t pf = position[from], pt = position[to];
+          if (kind[pf] == VertexKind::Locked)
+            continue;
+          if (kind[pf] == VertexKind::Border && edges[edgeKey(pf, pt)] != 1)
+            continue; // would pull the border inwards
+          Quadric q = quadrics[pf];
+          q.add(quadrics[pt]);
+          double error = q.evaluate(p(to)) / std::max(q.weight, 1e-12);
+          if (best[pf] == SIZE_MAX) {
+            best[pf] = collapses.size();
+            collapses.push_back({from, to, error});
+          } else if (error < collapses[best[pf]].error) {
+            collapses[best[pf]] = {from, to, error};
+          }
+        }
+      std::sort(collapses.begin(), collapses.end(),
+                [](const Collapse &a, const Collapse &b) {
+                  return a.error < b.error;
+                });
+
+      // apply as many independent collapses as the target allows
+      std::size_t trianglesToRemove = (out.size() - targetIndexCount + 2) / 3;
+      std::size_t removed = 0;
+      std::fill(locked.begin(), locked.end(), false);
+      std::iota(remap.begin(), remap.end(), 0u);
+      for (const Collapse &collapse : collapses) {
+        if (removed >= trianglesToRemove)
+          break;
+        std::uint32_t pf = position[collapse.from], pt = position[collapse.to];
+        if (locked[pf] || locked[pt])
+          continue;
+        // reject collapses that flip a remaining triangle
+        bool flips = false;
+        std::size_t collapsing = 0;
+        for (std::uint32_t t = adjacencyOffsets[pf];
+             t < adjacencyOffsets[pf + 1] && !flips; t++) {
+          const std::uint32_t *tri = &out[adjacency[t] * 3];
+          if (position[tri[0]] == pt || position[tri[1]] == pt ||
+              position[tri[2]] == pt) {
+            collapsing++;
+            continue;
+          }
+          const float *corners[3], *moved[3];
+          for (int k = 0; k < 3; k++) {
+            corners[k] = p(tri[k]);
+            moved[k] = position[tri[k]] == pf ? p(collapse.to) : corners[k];
+          }
+          double before[3], after[3];
+          triangleNormal(corners[0], corners[1], corners[2], before);
+          triangleNormal(moved[0], moved[1], moved[2], after);
+          // more than ~75 degrees of rotation counts as a flip too
+          double d = before[0] * after[0] + before[1] * after[1] +
+                     before[2] * after[2];
+          double lengths =
+              std::sqrt((before[0] * before[0] + before[1] * before[1] +
+                         before[2] * before[2]) *
+                        (after[0] * after[0] + after[1] * after[1] +
+                         after[2] * after[2]));
+          flips = d <= 0.25 * lengths;
+        }
+        if (flips)
+          continue;
+
+        // the vertex isn't a seam, so `from` is its only wedge
+        remap[collapse.from] = collapse.to;
+        quadrics[pt].add(quadrics[pf]);
+        maxError = std::max(maxError, collapse.error);
+        removed += collapsing;
+        // everything touching the changed triangles waits for the next pass
+        for (std::uint32_t t = adjacencyOffsets[pf]; t < adjacencyOffsets[pf + 1];
+             t++)
+          for (int k = 0; k < 3; k++)
+            locked[position[out[adjacency[t] * 3 + k]]] = true;
+      }
+      if (removed == 0) {
+        stuck = true; // nothing left that can be collapsed
+        break;
+      }
+
+      std::size_t write = 0;
+      for (std::size_t i = 0; i < out.size(); i += 3) {
+        std::uint32_t a = remap[out[i]], b = remap[out[i + 1]],
+                      c = remap[out[i + 2]];
+        if (position[a] == position[b] || position[b] == position[c] ||
+            position[c] == position[a])
+          continue;
+        out[write++] = a;
+        out[write++] = b;
+        out[write++] = c;
+      }
+      out.resize(write);
+    }
+    levels.push_back(out);
+    errors.push_back(static_cast<float>(std::sqrt(maxError)));
+    if (stuck)
+      break;
+  }
+  return errors;
+}
+
+float simplifyMesh(const std::vector<VertexData> &vertices,
+                   const std::vector<std::uint32_t> &indices,
+                   std::size_t targetIndexCount,
+                   std::vector<std::uint32_t> &out) {
+  std::vector<std::vector<std::uint32_t>> levels;
+  std::vector<float> errors =
+      simplifyChain(vertices, indices, {targetIndexCount}, levels);
+  out = std::move(levels[0]);
+  return errors[0];
+}
+
+void generateLods(MeshData &mesh, std::size_t maxLods, float reduction) {
+  std::vector<std::uint32_t> base = mesh.indices;
+  if (!mesh.lods.empty())
+    base.assign(mesh.indices.begin() + mesh.lods[0].firstIndex,
+                mesh.indices.begin() + mesh.lods[0].firstIndex +
+                    mesh.lods[0].indexCount);
+  mesh.indices = base;
+  mesh.lods.assign(1, {0, static_cast<std::uint32_t>(base.size()), 0.0f});
+
+  std::vector<std::size_t> targets;
+  float target = static_cast<float>(base.size());
+  for (std::size_t level = 1; level < maxLods; level++) {
+    target *= reduction;
+    if (target < 3.0f)
+      break;
+    targets.push_back(static_cast<std::size_t>(target) / 3 * 3);
+  }
+  if (targets.empty())
+    return;
+  std::vector<std::vector<std::uint32_t>> levels;
+  std::vector<float> errors = simplifyChain(mesh.vertices, base, targets, levels);
+  for (std::size_t level = 0; level < levels.size(); level++) {
+    const std::vector<std::uint32_t> &lod = levels[level];
+    // locked seams/borders, no real progress anymore
+    if (lod.empty() || lod.size() * 10 > mesh.lods.back().indexCount * 9)
+      break;
+    MeshLod range;
+    range.firstIndex = static_cast<std::uint32_t>(mesh.indices.size());
+    range.indexCount = static_cast<std::uint32_t>(lod.size());
+    range.error = errors[level];
+    mesh.lods.push_back(range);
+    mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+  }
+}
+
+float lodScreenScale(float fovY, float viewportHeight) {
+  return viewportHeight / (2.0f * std::tan(0.5f * fovY));
+}
+
+std::size_t selectLod(const std::vector<MeshLod> &lods, float distance,
+                      float screenScale, float maxPixelError) {
+  // projected error = error * screenScale / distance
+  for (std::size_t i = lods.size(); i-- > 1;)
+    if (lods[i].error * screenScale <= maxPixelError * distance)
+      return i;
+  return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric simplification (Garland & Heckbert): repeatedly
+// collapses the edge whose endpoint quadrics grow the least until `indices`
+// is down to `targetIndexCount`. Only vertex-to-vertex collapses are done so
+// the vertex buffer is shared with the original mesh. Attribute seams and
+// non-manifold vertices are locked, open borders only slide along themselves.
+// Returns the geometric error of the result in mesh units (RMS distance to
+// the original surface of the worst collapse).
+float simplifyMesh(const std::vector<VertexData> &vertices,
+                   const std::vector<std::uint32_t> &indices,
+                   std::size_t targetIndexCount,
+                   std::vector<std::uint32_t> &out);
+
+// Builds a LOD chain, each level keeping `reduction` of the triangles of the
+// previous one, stopping early when the mesh can't be reduced any further.
+// The levels are appended to mesh.indices (finest first) and described by
+// mesh.lods. Expects deduplicated vertices, call before optimizeMesh.
+void generateLods(MeshData &mesh, std::size_t maxLods = 5,
+                  float reduction = 0.5f);
+
+// pixels covered by one unit at distance one, for a vertical field of view
+// in radians
+float lodScreenScale(float fovY, float viewportHeight);
+
+// coarsest LOD whose error projects to at most `maxPixelError` pixels.
+// `distance` is in mesh units (divide the view distance by the object's
+// scale), usually to the nearest point of the bounding sphere.
+std::size_t selectLod(const std::vector<MeshLod> &lods, float distance,
+                      float screenScale, float maxPixelError = 1.0f);
+#endif
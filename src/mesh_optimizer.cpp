@@ -0,0 +1,317 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t> &indices,
+                                    std::size_t vertexCount,
+                                    unsigned int cacheSize) {
+  VertexCacheStats stats;
+  // FIFO: a vertex is cached while fewer than cacheSize misses happened
+  // since it was last loaded
+  std::vector<std::size_t> loadedAt(vertexCount, 0);
+  std::vector<bool> seen(vertexCount, false);
+  for (std::uint32_t index : indices) {
+    if (!seen[index] || stats.misses - loadedAt[index] >= cacheSize) {
+      seen[index] = true;
+      loadedAt[index] = stats.misses;
+      stats.misses++;
+    }
+  }
+  std::size_t triangles = indices.size() / 3;
+  stats.acmr = triangles ? float(stats.misses) / triangles : 0.0f;
+  stats.atvr = vertexCount ? float(stats.misses) / vertexCount : 0.0f;
+  return stats;
+}
+
+void deduplicateVertices(MeshData &mesh) {
+  std::unordered_map<std::string_view, std::uint32_t> unique;
+  std::vector<std::uint32_t> remap(mesh.vertices.size());
+  std::vector<VertexData> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (std::size_t i = 0; i < mesh.vertices.size(); i++) {
+    // VertexData is all floats without padding, so bytes compare as values
+    // (except -0.0 vs 0.0, which is harmless)
+    std::string_view key(reinterpret_cast<const char *>(&mesh.vertices[i]),
+                         sizeof(VertexData));
+    auto it = unique.find(key);
+    if (it != unique.end()) {
+      remap[i] = it->second;
+      continue;
+    }
+    remap[i] = static_cast<std::uint32_t>(vertices.size());
+    unique.emplace(key, remap[i]);
+    vertices.push_back(mesh.vertices[i]);
+  }
+  for (std::uint32_t &index : mesh.indices)
+    index = remap[index];
+  mesh.vertices = std::move(vertices);
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation"
+namespace {
+constexpr int FORSYTH_CACHE = 32;
+
+float vertexScore(int cachePosition, std::uint32_t remaining) {
+  if (remaining == 0)
+    return -1.0f;
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // the last triangle's vertices, fixed score so we don't favour
+      // reusing the very same edge
+      score = 0.75f;
+    } else {
+      float s = 1.0f - float(cachePosition - 3) / (FORSYTH_CACHE - 3);
+      score = std::pow(s, 1.5f);
+    }
+  }
+  // boost vertices with few triangles left so they get finished off
+  return score + 2.0f / std::sqrt(float(remaining));
+}
+} // namespace
+
+void optimizeVertexCache(std::vector<std::uint32_t> &indices,
+                         std::size_t vertexCount) {
+  const std::size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return;
+
+  // vertex -> triangles adjacency, shrinks as triangles are emitted
+  std::vector<std::uint32_t> remaining(vertexCount, 0);
+  for (std::uint32_t index : indices)
+    remaining[index]++;
+  std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+  for (std::size_t v = 0; v < vertexCount; v++)
+    offsets[v + 1] = offsets[v] + remaining[v];
+  std::vector<std::uint32_t> adjacency(indices.size());
+  {
+    std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t t = 0; t < triangleCount; t++)
+      for (int k = 0; k < 3; k++)
+        adjacency[fill[indices[t * 3 + k]]++] = static_cast<std::uint32_t>(t);
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (std::size_t v = 0; v < vertexCount; v++)
+    vertexScores[v] = vertexScore(-1, remaining[v]);
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  for (std::size_t t = 0; t < triangleCount; t++)
+    triangleScores[t] = vertexScores[indices[t * 3]] +
+                        vertexScores[indices[t * 3 + 1]] +
+                        vertexScores[indices[t * 3 + 2]];
+
+  std::vector<std::uint32_t> output;
+  output.reserve(indices.size());
+  std::vector<std::uint32_t> cache, nextCache;
+  std::size_t best = std::max_element(triangleScores.begin(),
+                                      triangleScores.end()) -
+                     triangleScores.begin();
+  std::size_t cursor = 0; // fallback scan when the cache has nothing left
+
+  while (best != triangleCount) {
+    emitted[best] = true;
+    const std::uint32_t *tri = &indices[best * 3];
+    output.insert(output.end(), tri, tri + 3);
+
+    // the emitted triangle's vertices go to the front of the cache
+    nextCache.assign(tri, tri + 3);
+    for (std::uint32_t v : cache)
+      if (v != tri[0] && v != tri[1] && v != tri[2])
+        nextCache.push_back(v);
+    for (int k = 0; k < 3; k++) {
+      std::uint32_t v = tri[k];
+      // drop the triangle from the vertex's adjacency
+      std::uint32_t *begin = &adjacency[offsets[v]];
+      std::uint32_t *end = begin + remaining[v];
+      std::uint32_t *found = std::find(begin, end, std::uint32_t(best));
+      std::swap(*found, *(end - 1));
+      remaining[v]--;
+    }
+
+    // rescore everything that was or is in the cache, and its triangles
+    for (std::size_t i = 0; i < nextCache.size(); i++) {
+      std::uint32_t v = nextCache[i];
+      cachePosition[v] = i < FORSYTH_CACHE ? int(i) : -1;
+      vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+    }
+    best = triangleCount;
+    float bestScore = -1.0f;
+    for (std::uint32_t v : nextCache)
+      for (std::uint32_t i = 0; i < remaining[v]; i++) {
+        std::uint32_t t = adjacency[offsets[v] + i];
+        float score = vertexScores[indices[t * 3]] +
+                      vertexScores[indices[t * 3 + 1]] +
+                      vertexScores[indices[t * 3 + 2]];
+        triangleScores[t] = score;
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    if (nextCache.size() > FORSYTH_CACHE)
+      nextCache.resize(FORSYTH_CACHE);
+    cache.swap(nextCache);
+
+    if (best == triangleCount) {
+      // nothing adjacent to the cache, continue with any triangle left
+      while (cursor < triangleCount && emitted[cursor])
+        cursor++;
+      best = cursor;
+    }
+  }
+  indices = std::move(output);
+}
+
+void optimizeOverdraw(std::vector<std::uint32_t> &indices,
+                      const std::vector<VertexData> &vertices,
+                      unsigned int cacheSize) {
+  const std::size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2)
+    return;
+
+  // split where a triangle misses the cache on all three vertices, the
+  // cache is cold there anyway so reordering clusters costs nothing
+  std::vector<std::size_t> clusterStart;
+  std::vector<std::size_t> loadedAt(vertices.size(), 0);
+  std::vector<bool> seen(vertices.size(), false);
+  std::size_t misses = 0;
+  for (std::size_t t = 0; t < triangleCount; t++) {
+    int triangleMisses = 0;
+    for (int k = 0; k < 3; k++) {
+      std::uint32_t v = indices[t * 3 + k];
+      if (!seen[v] || misses - loadedAt[v] >= cacheSize) {
+        seen[v] = true;
+        loadedAt[v] = misses++;
+        triangleMisses++;
+      }
+    }
+    if (t == 0 || triangleMisses == 3)
+      clusterStart.push_back(t);
+  }
+  clusterStart.push_back(triangleCount);
+  const std::size_t clusterCount = clusterStart.size() - 1;
+  if (clusterCount < 2)
+    return;
+
+  // area weighted centroid and normal per cluster
+  struct Cluster {
+    float centroid[3] = {0, 0, 0};
+    float normal[3] = {0, 0, 0};
+    float area = 0.0f;
+    float sortKey = 0.0f;
+  };
+  std::vector<Cluster> clusters(clusterCount);
+  float meshCentroid[3] = {0, 0, 0};
+  float meshArea = 0.0f;
+  for (std::size_t c = 0; c < clusterCount; c++) {
+    Cluster &cluster = clusters[c];
+    for (std::size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+      const float *a = vertices[indices[t * 3]].position;
+      const float *b = vertices[indices[t * 3 + 1]].position;
+      const float *d = vertices[indices[t * 3 + 2]].position;
+      float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      float e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0]};
+      float area = 0.5f * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; k++) {
+        cluster.normal[k] += n[k];
+        cluster.centroid[k] += (a[k] + b[k] + d[k]) / 3.0f * area;
+      }
+      cluster.area += area;
+    }
+    for (int k = 0; k < 3; k++)
+      meshCentroid[k] += cluster.centroid[k];
+    meshArea += cluster.area;
+    if (cluster.area > 0.0f)
+      for (int k = 0; k < 3; k++)
+        cluster.centroid[k] /= cluster.area;
+  }
+  if (meshArea > 0.0f)
+    for (int k = 0; k < 3; k++)
+      meshCentroid[k] /= meshArea;
+
+  // clusters on the outside facing away from the centre occlude the rest
+  for (Cluster &cluster : clusters) {
+    float len = std::sqrt(cluster.normal[0] * cluster.normal[0] +
+                          cluster.normal[1] * cluster.normal[1] +
+                          cluster.normal[2] * cluster.normal[2]);
+    if (len <= 0.0f)
+      continue;
+    for (int k = 0; k < 3; k++)
+      cluster.sortKey +=
+          (cluster.centroid[k] - meshCentroid[k]) * cluster.normal[k] / len;
+  }
+
+  std::vector<std::size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+    return clusters[a].sortKey > clusters[b].sortKey;
+  });
+  std::vector<std::uint32_t> output;
+  output.reserve(indices.size());
+  for (std::size_t c : order)
+    output.insert(output.end(), indices.begin() + clusterStart[c] * 3,
+                  indices.begin() + clusterStart[c + 1] * 3);
+  indices = std::move(output);
+}
+
+void optimizeVertexFetch(MeshData &mesh) {
+  const std::uint32_t unused = 0xFFFFFFFFu;
+  std::vector<std::uint32_t> remap(mesh.vertices.size(), unused);
+  std::vector<VertexData> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (std::uint32_t &index : mesh.indices) {
+    if (remap[index] == unused) {
+      remap[index] = static_cast<std::uint32_t>(vertices.size());
+      vertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+  // vertices no triangle references are dropped
+  mesh.vertices = std::move(vertices);
+}
+
+void optimizeMesh(MeshData &mesh) {
+  deduplicateVertices(mesh);
+  if (mesh.lods.empty()) {
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+  } else {
+    // every LOD is drawn on its own, so each gets its own triangle order
+    std::vector<std::uint32_t> range;
+    for (const MeshLod &lod : mesh.lods) {
+      auto first = mesh.indices.begin() + lod.firstIndex;
+      range.assign(first, first + lod.indexCount);
+      optimizeVertexCache(range, mesh.vertices.size());
+      optimizeOverdraw(range, mesh.vertices);
+      std::copy(range.begin(), range.end(), first);
+    }
+  }
+  // LOD 0 comes first, so the shared vertices end up in its fetch order
+  optimizeVertexFetch(mesh);
+  computeBounds(mesh);
+}
+
+GLenum packIndices(const std::vector<std::uint32_t> &indices,
+                   std::size_t vertexCount, std::vector<unsigned char> &out) {
+  if (vertexCount <= 0x10000) {
+    out.resize(indices.size() * sizeof(std::uint16_t));
+    for (std::size_t i = 0; i < indices.size(); i++) {
+      std::uint16_t index = static_cast<std::uint16_t>(indices[i]);
+      std::memcpy(out.data() + i * sizeof(index), &index, sizeof(index));
+    }
+    return GL_UNSIGNED_SHORT;
+  }
+  out.resize(indices.size() * sizeof(std::uint32_t));
+  std::memcpy(out.data(), indices.data(), out.size());
+  return GL_UNSIGNED_INT;
+}
@@ -0,0 +1,46 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "mesh.hpp"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index buffer, measured with
+// a FIFO cache simulation
+struct VertexCacheStats {
+  std::size_t misses = 0;
+  float acmr = 0.0f; // misses per triangle, 0.5 is the ideal for big grids
+  float atvr = 0.0f; // misses per vertex, 1.0 is ideal
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t> &indices,
+                                    std::size_t vertexCount,
+                                    unsigned int cacheSize = 16);
+
+// merges bit-identical vertices and rewrites the indices
+void deduplicateVertices(MeshData &mesh);
+// reorders triangles for the post-transform cache (Forsyth's algorithm)
+void optimizeVertexCache(std::vector<std::uint32_t> &indices,
+                         std::size_t vertexCount);
+// reorders clusters of the cache-optimized triangle order so that outward
+// facing clusters (likely occluders) draw first. Keeps cache efficiency
+// because clusters are split only where the cache would be cold anyway.
+void optimizeOverdraw(std::vector<std::uint32_t> &indices,
+                      const std::vector<VertexData> &vertices,
+                      unsigned int cacheSize = 16);
+// renumbers vertices in first-use order so vertex fetch walks memory
+// linearly
+void optimizeVertexFetch(MeshData &mesh);
+
+// all of the above in the right order, per LOD when mesh.lods is set
+void optimizeMesh(MeshData &mesh);
+
+// packs the indices as 16-bit when every vertex can be addressed with them,
+// returns GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+GLenum packIndices(const std::vector<std::uint32_t> &indices,
+                   std::size_t vertexCount, std::vector<unsigned char> &out);
+#endif
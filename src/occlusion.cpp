@@ -0,0 +1,232 @@
+#include "occlusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(CULLING_SSE) || defined(CULLING_AVX)
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+    : m_width(width), m_height(height) {
+  for (int w = width, h = height;; w = std::max(w / 2, 1),
+           h = std::max(h / 2, 1)) {
+    m_levels.emplace_back(static_cast<std::size_t>(w) * h, 1.0f);
+    if (w == 1 && h == 1)
+      break;
+  }
+}
+
+void OcclusionBuffer::begin(const Mat4 &viewProjection) {
+  m_viewProjection = viewProjection;
+  std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+  m_triangles = 0;
+}
+
+void OcclusionBuffer::addOccluder(const Mat4 &model, const Vec3 *positions,
+                                  std::size_t vertexCount,
+                                  const std::uint32_t *indices,
+                                  std::size_t indexCount) {
+  Mat4 transform = m_viewProjection * model;
+  m_clip.resize(vertexCount);
+  for (std::size_t i = 0; i < vertexCount; i++)
+    m_clip[i] = transform *
+                Vec4{positions[i].x, positions[i].y, positions[i].z, 1.0f};
+  for (std::size_t i = 0; i + 2 < indexCount; i += 3) {
+    Vec4 triangle[3] = {m_clip[indices[i]], m_clip[indices[i + 1]],
+                        m_clip[indices[i + 2]]};
+    clipTriangle(triangle);
+  }
+}
+
+void OcclusionBuffer::clipTriangle(const Vec4 *clip) {
+  // completely outside one of the side planes
+  for (int axis = 0; axis < 2; axis++) {
+    bool below = true, above = true;
+    for (int v = 0; v < 3; v++) {
+      float c = axis == 0 ? clip[v].x : clip[v].y;
+      below = below && c < -clip[v].w;
+      above = above && c > clip[v].w;
+    }
+    if (below || above)
+      return;
+  }
+
+  // Sutherland-Hodgman against the near plane (z >= -w), which also keeps
+  // w positive for the divide
+  Vec4 polygon[4];
+  int count = 0;
+  for (int v = 0; v < 3; v++) {
+    const Vec4 &a = clip[v], &b = clip[(v + 1) % 3];
+    float da = a.z + a.w, db = b.z + b.w;
+    if (da >= 0.0f)
+      polygon[count++] = a;
+    if ((da >= 0.0f) != (db >= 0.0f)) {
+      float t = da / (da - db);
+      polygon[count++] = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                          a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t};
+    }
+  }
+  if (count < 3)
+    return;
+
+  ScreenVertex screen[4];
+  for (int v = 0; v < count; v++) {
+    float inverseW = 1.0f / polygon[v].w;
+    screen[v] = {(polygon[v].x * inverseW * 0.5f + 0.5f) * m_width,
+                 (polygon[v].y * inverseW * 0.5f + 0.5f) * m_height,
+                 polygon[v].z * inverseW * 0.5f + 0.5f};
+  }
+  rasterize(screen[0], screen[1], screen[2]);
+  if (count == 4)
+    rasterize(screen[0], screen[2], screen[3]);
+}
+
+void OcclusionBuffer::rasterize(ScreenVertex a, ScreenVertex b,
+                                ScreenVertex c) {
+  float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+  if (area <= 0.0f) // back facing or degenerate
+    return;
+
+  // clamped as floats, vertices near the camera plane project very far out
+  float minX = std::min({a.x, b.x, c.x}), maxX = std::max({a.x, b.x, c.x});
+  float minY = std::min({a.y, b.y, c.y}), maxY = std::max({a.y, b.y, c.y});
+  if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+    return;
+  int x0 = static_cast<int>(std::max(minX, 0.0f));
+  int y0 = static_cast<int>(std::max(minY, 0.0f));
+  int x1 = static_cast<int>(std::min(maxX, m_width - 1.0f));
+  int y1 = static_cast<int>(std::min(maxY, m_height - 1.0f));
+  m_triangles++;
+
+  // Edge functions e = ex * x + ey * y + e0, positive inside a counter-
+  // clockwise triangle, each one opposite a vertex. Depth is affine in
+  // screen space, interpolated with them.
+  auto edge = [](ScreenVertex u, ScreenVertex v, float &ex, float &ey,
+                 float &e0) {
+    ex = u.y - v.y;
+    ey = v.x - u.x;
+    e0 = u.x * v.y - u.y * v.x;
+  };
+  float ax, ay, a0, bx, by, b0, cx, cy, c0;
+  edge(b, c, ax, ay, a0);
+  edge(c, a, bx, by, b0);
+  edge(a, b, cx, cy, c0);
+  float inverseArea = 1.0f / area;
+  float zx = (ax * a.z + bx * b.z + cx * c.z) * inverseArea;
+  float zy = (ay * a.z + by * b.z + cy * c.z) * inverseArea;
+  float z0 = (a0 * a.z + b0 * b.z + c0 * c.z) * inverseArea;
+
+  std::vector<float> &depth = m_levels[0];
+  for (int y = y0; y <= y1; y++) {
+    float py = static_cast<float>(y) + 0.5f;
+    float rowA = ay * py + a0, rowB = by * py + b0, rowC = cy * py + c0;
+    float rowZ = zy * py + z0;
+    float *row = depth.data() + static_cast<std::size_t>(y) * m_width;
+    // narrow the row to where every edge can be positive, with a pixel to
+    // spare; the edge tests below stay exact
+    float spanStart = static_cast<float>(x0), spanEnd = static_cast<float>(x1);
+    const float slopes[3] = {ax, bx, cx}, offsetsAt[3] = {rowA, rowB, rowC};
+    for (int e = 0; e < 3; e++) {
+      if (slopes[e] > 0.0f)
+        spanStart = std::max(spanStart, -offsetsAt[e] / slopes[e] - 1.5f);
+      else if (slopes[e] < 0.0f)
+        spanEnd = std::min(spanEnd, -offsetsAt[e] / slopes[e] + 0.5f);
+      else if (offsetsAt[e] < 0.0f)
+        spanEnd = -1.0f;
+    }
+    if (spanStart > spanEnd)
+      continue;
+    int rowStart = static_cast<int>(spanStart) & ~3;
+    int rowEnd = static_cast<int>(spanEnd);
+#if defined(CULLING_SSE) || defined(CULLING_AVX)
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 far = _mm_set1_ps(1.0f);
+    for (int x = rowStart; x <= rowEnd; x += 4) {
+      __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+      __m128 ea = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ax), px),
+                             _mm_set1_ps(rowA));
+      __m128 eb = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(bx), px),
+                             _mm_set1_ps(rowB));
+      __m128 ec = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cx), px),
+                             _mm_set1_ps(rowC));
+      __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px),
+                            _mm_set1_ps(rowZ));
+      // any sign bit set means outside, those lanes keep the far plane
+      __m128 outside = _mm_castsi128_ps(_mm_srai_epi32(
+          _mm_castps_si128(_mm_or_ps(ea, _mm_or_ps(eb, ec))), 31));
+      z = _mm_or_ps(_mm_andnot_ps(outside, z), _mm_and_ps(outside, far));
+      _mm_storeu_ps(row + x, _mm_min_ps(_mm_loadu_ps(row + x), z));
+    }
+#else
+    for (int x = rowStart; x <= rowEnd; x++) {
+      float px = static_cast<float>(x) + 0.5f;
+      float ea = ax * px + rowA, eb = bx * px + rowB, ec = cx * px + rowC;
+      if (std::signbit(ea) || std::signbit(eb) || std::signbit(ec))
+        continue;
+      row[x] = std::min(row[x], zx * px + rowZ);
+    }
+#endif
+  }
+}
+
+void OcclusionBuffer::finish() {
+  int w = m_width, h = m_height;
+  for (std::size_t level = 1; level < m_levels.size(); level++) {
+    const std::vector<float> &fine = m_levels[level - 1];
+    int fineW = w, fineH = h;
+    w = std::max(w / 2, 1);
+    h = std::max(h / 2, 1);
+    std::vector<float> &coarse = m_levels[level];
+    for (int y = 0; y < h; y++)
+      for (int x = 0; x < w; x++) {
+        int fx = std::min(2 * x + 1, fineW - 1);
+        int fy = std::min(2 * y + 1, fineH - 1);
+        const float *row0 = fine.data() + static_cast<std::size_t>(2 * y) * fineW;
+        const float *row1 = fine.data() + static_cast<std::size_t>(fy) * fineW;
+        coarse[static_cast<std::size_t>(y) * w + x] =
+            std::max({row0[2 * x], row0[fx], row1[2 * x], row1[fx]});
+      }
+  }
+}
+
+bool OcclusionBuffer::testBox(const Bounds &bounds) const {
+  float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+  float nearest = 1.0f;
+  for (int corner = 0; corner < 8; corner++) {
+    Vec4 clip = m_viewProjection *
+                Vec4{corner & 1 ? bounds.max.x : bounds.min.x,
+                     corner & 2 ? bounds.max.y : bounds.min.y,
+                     corner & 4 ? bounds.max.z : bounds.min.z, 1.0f};
+    if (clip.z < -clip.w)
+      return true;
+    float inverseW = 1.0f / clip.w;
+    float x = (clip.x * inverseW * 0.5f + 0.5f) * m_width;
+    float y = (clip.y * inverseW * 0.5f + 0.5f) * m_height;
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+    nearest = std::min(nearest, clip.z * inverseW * 0.5f + 0.5f);
+  }
+  if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+    return true;
+  int x0 = static_cast<int>(std::max(minX, 0.0f));
+  int y0 = static_cast<int>(std::max(minY, 0.0f));
+  int x1 = static_cast<int>(std::min(maxX, m_width - 1.0f));
+  int y1 = static_cast<int>(std::min(maxY, m_height - 1.0f));
+
+  // the finest level where the footprint is at most 2x2 texels
+  std::size_t level = 0;
+  while (level + 1 < m_levels.size() &&
+         ((x1 >> level) - (x0 >> level) > 1 ||
+          (y1 >> level) - (y0 >> level) > 1))
+    level++;
+  int levelWidth = std::max(m_width >> level, 1);
+  const std::vector<float> &hiZ = m_levels[level];
+  for (int y = y0 >> level; y <= y1 >> level; y++)
+    for (int x = x0 >> level; x <= x1 >> level; x++)
+      if (nearest <= hiZ[static_cast<std::size_t>(y) * levelWidth + x])
+        return true;
+  return false;
+}
@@ -0,0 +1,60 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "culling.hpp"
+#include "linear_math.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU occlusion culling. A few big occluders are rasterized into a small
+// depth buffer, which is then reduced into a hierarchical-Z pyramid where
+// every texel holds the farthest depth of the four below it. A box is hidden
+// when its nearest point is behind that farthest depth everywhere it covers,
+// which a 2x2 texel footprint of the right pyramid level answers.
+//
+// Occluders are sampled at pixel centers, so they must lie inside the objects
+// they stand for (an inner hull, an inscribed box) for the test to stay
+// conservative.
+class OcclusionBuffer {
+public:
+  // powers of two, at least 4 pixels wide for the SIMD rows
+  explicit OcclusionBuffer(int width = 256, int height = 128);
+
+  // clears to the far plane
+  void begin(const Mat4 &viewProjection);
+  // counter-clockwise triangles of an object space mesh, back faces skipped
+  void addOccluder(const Mat4 &model, const Vec3 *positions,
+                   std::size_t vertexCount, const std::uint32_t *indices,
+                   std::size_t indexCount);
+  // builds the pyramid, once after the last occluder
+  void finish();
+
+  // false when the box is completely hidden. Boxes crossing the near plane
+  // or leaving the screen are always visible, that's the frustum's call.
+  bool testBox(const Bounds &bounds) const;
+
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+  // depth in [0, 1], row major with the bottom row first
+  const std::vector<float> &depth() const { return m_levels[0]; }
+  std::size_t trianglesRasterized() const { return m_triangles; }
+
+private:
+  struct ScreenVertex {
+    float x, y, z;
+  };
+
+  // near plane clipping, then one or two triangles to rasterize()
+  void clipTriangle(const Vec4 *clip);
+  void rasterize(ScreenVertex a, ScreenVertex b, ScreenVertex c);
+
+  int m_width;
+  int m_height;
+  Mat4 m_viewProjection;
+  std::vector<std::vector<float>> m_levels; // [0] is the depth buffer
+  std::vector<Vec4> m_clip;                  // occluder vertices, clip space
+  std::size_t m_triangles = 0;
+};
+#endif
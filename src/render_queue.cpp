@@ -0,0 +1,215 @@
+#include "render_queue.hpp"
+
+#include "command_buffer.hpp"
+
+#include <algorithm>
+
+static constexpr unsigned int PROGRAM_BITS = 12;
+static constexpr unsigned int TEXTURE_SET_BITS = 16;
+static constexpr unsigned int VAO_BITS = 12;
+static constexpr unsigned int DEPTH_BITS = 20;
+
+std::uint32_t
+RenderQueue::intern(std::unordered_map<std::uint64_t, std::uint32_t> &map,
+                    std::uint64_t name, std::uint32_t limit) {
+  auto it = map.find(name);
+  if (it != map.end())
+    return it->second;
+  // once we run out of ids they wrap around, that only costs us some
+  // grouping since the packet still carries the real GL names
+  std::uint32_t id = static_cast<std::uint32_t>(map.size()) % limit;
+  map.emplace(name, id);
+  return id;
+}
+
+std::uint64_t RenderQueue::textureSetName(const DrawPacket &packet) {
+  return (static_cast<std::uint64_t>(packet.textures[0]) << 32 |
+          packet.textures[1]) ^
+         (static_cast<std::uint64_t>(packet.textureTarget) << 48);
+}
+
+std::uint64_t RenderQueue::packKey(const DrawPacket &packet,
+                                   std::uint64_t program,
+                                   std::uint64_t textureSet,
+                                   std::uint64_t vao) {
+  program &= (1u << PROGRAM_BITS) - 1;
+  textureSet &= (1u << TEXTURE_SET_BITS) - 1;
+  vao &= (1u << VAO_BITS) - 1;
+  float d = std::clamp(packet.depth, 0.0f, 1.0f);
+  std::uint64_t depth =
+      static_cast<std::uint64_t>(d * ((1u << DEPTH_BITS) - 1));
+  std::uint64_t pass = static_cast<std::uint64_t>(packet.pass) & 0xF;
+
+  if (packet.pass == RenderPass::Transparent) {
+    // back to front matters more than state changes for blending
+    depth = ((1u << DEPTH_BITS) - 1) - depth;
+    return pass << 60 | depth << 40 | program << 28 | textureSet << 12 | vao;
+  }
+  return pass << 60 | program << 48 | textureSet << 32 | vao << 20 | depth;
+}
+
+std::uint64_t RenderQueue::makeKey(const DrawPacket &packet) {
+  std::uint64_t program =
+      intern(m_programIds, packet.program, 1u << PROGRAM_BITS);
+  std::uint64_t textureSet =
+      intern(m_textureSetIds, textureSetName(packet), 1u << TEXTURE_SET_BITS);
+  std::uint64_t vao = intern(m_vaoIds, packet.vao, 1u << VAO_BITS);
+  return packKey(packet, program, textureSet, vao);
+}
+
+std::uint64_t RenderQueue::makeNameKey(const DrawPacket &packet) {
+  // fold the 64-bit texture pair so both names land in the field
+  std::uint64_t textures = textureSetName(packet);
+  textures ^= textures >> 32;
+  textures ^= textures >> 16;
+  return packKey(packet, packet.program, textures, packet.vao);
+}
+
+void RenderQueue::submit(const DrawPacket &packet) {
+  m_items.push_back(
+      {makeKey(packet), static_cast<std::uint32_t>(m_packets.size())});
+  m_packets.push_back(packet);
+}
+
+void RenderQueue::radixSort(std::vector<SortItem> &items,
+                            std::vector<SortItem> &scratch) {
+  scratch.resize(items.size());
+  if (items.size() < 2)
+    return;
+  std::size_t counts[8][256] = {};
+  // build all 8 histograms in one read of the data
+  for (const SortItem &item : items)
+    for (unsigned int byte = 0; byte < 8; byte++)
+      counts[byte][(item.key >> (byte * 8)) & 0xFF]++;
+
+  SortItem *src = items.data();
+  SortItem *dst = scratch.data();
+  for (unsigned int byte = 0; byte < 8; byte++) {
+    std::size_t *count = counts[byte];
+    // every key has the same value here, nothing to reorder
+    if (count[(src[0].key >> (byte * 8)) & 0xFF] == items.size())
+      continue;
+    std::size_t offset = 0;
+    for (unsigned int i = 0; i < 256; i++) {
+      std::size_t c = count[i];
+      count[i] = offset;
+      offset += c;
+    }
+    for (std::size_t i = 0; i < items.size(); i++)
+      dst[count[(src[i].key >> (byte * 8)) & 0xFF]++] = src[i];
+    std::swap(src, dst);
+  }
+  // odd number of executed passes leaves the result in scratch
+  if (src != items.data())
+    items.swap(scratch);
+}
+
+// packets that can go into the same multi-draw: everything but the index
+// range, base vertex and instance count matches
+static bool sameDrawState(const DrawPacket &a, const DrawPacket &b) {
+  return a.program == b.program && a.vao == b.vao &&
+         a.textureTarget == b.textureTarget && a.mode == b.mode &&
+         a.indexType == b.indexType &&
+         std::equal(a.textures, a.textures + MAX_PACKET_TEXTURES, b.textures);
+}
+
+static std::uint64_t triangleCount(const DrawPacket &p) {
+  if (p.mode != GL_TRIANGLES)
+    return 0;
+  return static_cast<std::uint64_t>(p.count / 3) *
+         static_cast<std::uint64_t>(p.instanceCount);
+}
+
+static std::uintptr_t indexSize(GLenum indexType) {
+  return indexType == GL_UNSIGNED_SHORT  ? 2
+         : indexType == GL_UNSIGNED_BYTE ? 1
+                                         : 4;
+}
+
+void RenderQueue::beginFrame() { m_stats = Stats{}; }
+
+void RenderQueue::flush(GLStateCache &glState) {
+  radixSort(m_items, m_scratch);
+  m_ordered.clear();
+  for (const SortItem &item : m_items)
+    m_ordered.push_back(&m_packets[item.index]);
+  draw(glState);
+  m_packets.clear();
+  m_items.clear();
+}
+
+void RenderQueue::replay(GLStateCache &glState,
+                         const CommandBuffer *const *buffers,
+                         std::size_t count) {
+  mergeCommandBuffers(buffers, count, m_ordered);
+  draw(glState);
+}
+
+void RenderQueue::draw(GLStateCache &glState) {
+  m_stats.packets += static_cast<unsigned int>(m_ordered.size());
+  const DrawPacket *prev = nullptr;
+  for (std::size_t i = 0; i < m_ordered.size();) {
+    const DrawPacket &p = *m_ordered[i];
+    // nothing to draw, and glDrawElements would still draw one instance
+    if (p.instanceCount <= 0) {
+      i++;
+      continue;
+    }
+    if (!prev || prev->program != p.program)
+      m_stats.programSwitches++;
+    if (!prev || prev->textureTarget != p.textureTarget ||
+        !std::equal(p.textures, p.textures + MAX_PACKET_TEXTURES,
+                    prev->textures))
+      m_stats.textureSwitches++;
+    if (!prev || prev->vao != p.vao)
+      m_stats.vaoSwitches++;
+    prev = &p;
+    m_stats.triangles += triangleCount(p);
+
+    glState.useProgram(p.program);
+    // unused units are bound to 0 rather than skipped, or a packet with
+    // fewer textures samples the previous packet's; the cache elides the
+    // ones already unbound
+    for (unsigned int unit = 0; unit < MAX_PACKET_TEXTURES; unit++)
+      glState.bindTexture(unit, p.textureTarget, p.textures[unit]);
+    glState.bindVertexArray(p.vao);
+
+    // find the run of packets sharing all of this state
+    std::size_t end = i + 1;
+    const std::uintptr_t size = indexSize(p.indexType);
+    while (end < m_ordered.size() && sameDrawState(p, *m_ordered[end]) &&
+           m_ordered[end]->indexOffset % size == 0)
+      end++;
+
+    if (end - i > 1 && p.indexOffset % size == 0) {
+      for (std::size_t j = i; j < end; j++) {
+        const DrawPacket &q = *m_ordered[j];
+        if (q.instanceCount <= 0)
+          continue;
+        if (j > i)
+          m_stats.triangles += triangleCount(q);
+        m_multiDraw.add({static_cast<GLuint>(q.count),
+                         static_cast<GLuint>(q.instanceCount),
+                         static_cast<GLuint>(q.indexOffset / size),
+                         q.baseVertex, 0});
+      }
+      m_stats.mergedPackets += static_cast<unsigned int>(end - i);
+      m_stats.drawCalls += m_multiDraw.flush(p.mode, p.indexType);
+      i = end;
+      continue;
+    }
+
+    const void *indices = reinterpret_cast<const void *>(p.indexOffset);
+    if (p.instanceCount > 1)
+      glDrawElementsInstancedBaseVertex(p.mode, p.count, p.indexType, indices,
+                                        p.instanceCount, p.baseVertex);
+    else if (p.baseVertex != 0)
+      glDrawElementsBaseVertex(p.mode, p.count, p.indexType, indices,
+                               p.baseVertex);
+    else
+      glDrawElements(p.mode, p.count, p.indexType, indices);
+    m_stats.drawCalls++;
+    i++;
+  }
+  m_ordered.clear();
+}
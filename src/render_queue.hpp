@@ -0,0 +1,115 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "gl_state_cache.hpp"
+#include "mesh_batch.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Render passes, submitted in this order (they are the top bits of the key)
+enum class RenderPass : std::uint8_t {
+  Opaque = 0,      // front to back
+  Transparent = 1, // back to front
+  Overlay = 2,     // UI/debug, no depth ordering
+};
+
+static constexpr unsigned int MAX_PACKET_TEXTURES = 2;
+
+class CommandBuffer;
+
+// Everything needed to issue one draw call. Packets are plain data, the
+// queue owns ordering and all the GL state changes.
+struct DrawPacket {
+  RenderPass pass = RenderPass::Opaque;
+  GLuint program = 0;
+  GLuint vao = 0;
+  GLenum textureTarget = GL_TEXTURE_2D;
+  GLuint textures[MAX_PACKET_TEXTURES] = {};
+  GLenum mode = GL_TRIANGLES;
+  GLsizei count = 0;
+  GLenum indexType = GL_UNSIGNED_INT;
+  std::uintptr_t indexOffset = 0; // byte offset into the bound EBO
+  GLint baseVertex = 0;
+  GLsizei instanceCount = 1;
+  float depth = 0.0f; // normalized view depth in [0, 1]
+};
+
+// Collects draw packets for a frame, sorts them by a 64-bit key and submits
+// them through the state cache so that state changes are minimized.
+//
+// key layout (msb -> lsb):
+//   pass 4 | program 12 | texture set 16 | vao 12 | depth 20
+// For the transparent pass the depth field is inverted and moved above the
+// state bits, so those packets are drawn back to front.
+//
+// Runs of sorted packets that only differ in their index range / base vertex
+// (e.g. meshes packed into one MeshBatch) are merged into one multi-draw.
+class RenderQueue {
+public:
+  struct Stats {
+    unsigned int packets = 0;
+    unsigned int drawCalls = 0;
+    unsigned int programSwitches = 0;
+    unsigned int textureSwitches = 0;
+    unsigned int vaoSwitches = 0;
+    unsigned int mergedPackets = 0; // packets drawn as part of a multi-draw
+    std::uint64_t triangles = 0;    // all instances, GL_TRIANGLES only
+  };
+
+  // reset the stats (call once at the top of the render loop), every
+  // flush() and replay() after it adds to them
+  void beginFrame();
+
+  void submit(const DrawPacket &packet);
+  // sort everything submitted since the last flush, draw it and clear the
+  // queue. Packets only sort against the same flush, so a frame that flushes
+  // more than once draws them flush by flush.
+  void flush(GLStateCache &glState);
+  // draws sorted command buffers merged into one key order, after whatever
+  // was drawn before
+  void replay(GLStateCache &glState, const CommandBuffer *const *buffers,
+              std::size_t count);
+
+  const Stats &stats() const { return m_stats; }
+  std::size_t size() const { return m_packets.size(); }
+
+  // exposed for tools/benchmarks
+  std::uint64_t makeKey(const DrawPacket &packet);
+  // the same layout built straight from the GL names cut to the field
+  // widths; needs no interning tables, so any thread can build it
+  static std::uint64_t makeNameKey(const DrawPacket &packet);
+  // LSD radix sort of (key, index) pairs, 8 bits per pass, passes where
+  // every key shares the same byte are skipped
+  struct SortItem {
+    std::uint64_t key;
+    std::uint32_t index;
+  };
+  static void radixSort(std::vector<SortItem> &items,
+                        std::vector<SortItem> &scratch);
+
+private:
+  static std::uint64_t textureSetName(const DrawPacket &packet);
+  // pass and depth from the packet, the state fields from the given ids
+  static std::uint64_t packKey(const DrawPacket &packet, std::uint64_t program,
+                               std::uint64_t textureSet, std::uint64_t vao);
+  // GL names are sparse, the key fields need small dense ids
+  std::uint32_t intern(std::unordered_map<std::uint64_t, std::uint32_t> &map,
+                       std::uint64_t name, std::uint32_t limit);
+  // issues m_ordered in that order through the state cache
+  void draw(GLStateCache &glState);
+
+  std::vector<DrawPacket> m_packets;
+  std::vector<SortItem> m_items;
+  std::vector<SortItem> m_scratch;
+  std::vector<const DrawPacket *> m_ordered; // what draw() issues
+  std::unordered_map<std::uint64_t, std::uint32_t> m_programIds;
+  std::unordered_map<std::uint64_t, std::uint32_t> m_textureSetIds;
+  std::unordered_map<std::uint64_t, std::uint32_t> m_vaoIds;
+  Stats m_stats;
+  IndirectDrawBuffer m_multiDraw;
+};
+#endif
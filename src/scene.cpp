@@ -0,0 +1,179 @@
+#include "scene.hpp"
+
+#include <cstring>
+
+namespace {
+
+// entities per job; a multiple of every SIMD width so culling chunks stay on
+// the vector path
+const std::size_t UPDATE_GRAIN = 1024;
+const std::size_t CULL_GRAIN = 4096;
+
+} // namespace
+
+Mat4 transformMatrix(const Transform &transform) {
+  Mat4 m = rotate(transform.rotation);
+  for (int column = 0; column < 3; column++)
+    for (int row = 0; row < 3; row++)
+      m(row, column) *= transform.scale;
+  m(0, 3) = transform.position.x;
+  m(1, 3) = transform.position.y;
+  m(2, 3) = transform.position.z;
+  return m;
+}
+
+Entity Scene::create(const Transform &transform, const BoundingSphere &bounds,
+                     std::uint32_t mesh, std::uint32_t material) {
+  std::uint32_t slot;
+  if (m_freeSlot != INVALID_ENTITY) {
+    slot = m_freeSlot;
+    m_freeSlot = m_slots[slot];
+  } else {
+    slot = static_cast<std::uint32_t>(m_slots.size());
+    m_slots.push_back(0);
+    m_generations.push_back(0);
+  }
+  std::uint32_t index = static_cast<std::uint32_t>(size());
+  m_slots[slot] = index;
+  Entity entity =
+      slot | static_cast<std::uint32_t>(m_generations[slot]) << INDEX_BITS;
+
+  m_entities.push_back(entity);
+  m_transforms.push_back(transform);
+  m_localBounds.push_back(bounds);
+  m_meshes.push_back(mesh);
+  m_materials.push_back(material);
+  m_dirty.push_back(1);
+  m_world.emplace_back();
+  m_worldBounds.addSphere({}, 0.0f);
+  return entity;
+}
+
+void Scene::destroy(Entity entity) {
+  if (!alive(entity))
+    return;
+  std::uint32_t slot = entity & INDEX_MASK;
+  std::uint32_t index = m_slots[slot];
+  std::uint32_t last = static_cast<std::uint32_t>(size() - 1);
+  // the last entity takes over the hole
+  m_slots[m_entities[last] & INDEX_MASK] = index;
+  m_entities[index] = m_entities[last];
+  m_transforms[index] = m_transforms[last];
+  m_localBounds[index] = m_localBounds[last];
+  m_meshes[index] = m_meshes[last];
+  m_materials[index] = m_materials[last];
+  m_dirty[index] = m_dirty[last];
+  m_world[index] = m_world[last];
+  m_entities.pop_back();
+  m_transforms.pop_back();
+  m_localBounds.pop_back();
+  m_meshes.pop_back();
+  m_materials.pop_back();
+  m_dirty.pop_back();
+  m_world.pop_back();
+  m_worldBounds.remove(index);
+
+  m_generations[slot]++;
+  m_slots[slot] = m_freeSlot;
+  m_freeSlot = slot;
+}
+
+bool Scene::alive(Entity entity) const {
+  std::uint32_t slot = entity & INDEX_MASK;
+  return slot < m_slots.size() &&
+         m_generations[slot] == entity >> INDEX_BITS &&
+         m_slots[slot] < size() && m_entities[m_slots[slot]] == entity;
+}
+
+void Scene::clear() {
+  m_entities.clear();
+  m_transforms.clear();
+  m_localBounds.clear();
+  m_meshes.clear();
+  m_materials.clear();
+  m_dirty.clear();
+  m_world.clear();
+  m_worldBounds.clear();
+  m_slots.clear();
+  m_generations.clear();
+  m_freeSlot = INVALID_ENTITY;
+}
+
+void Scene::reserve(std::size_t count) {
+  m_entities.reserve(count);
+  m_transforms.reserve(count);
+  m_localBounds.reserve(count);
+  m_meshes.reserve(count);
+  m_materials.reserve(count);
+  m_dirty.reserve(count);
+  m_world.reserve(count);
+  m_worldBounds.reserve(count);
+}
+
+std::uint32_t Scene::indexOf(Entity entity) const {
+  return m_slots[entity & INDEX_MASK];
+}
+
+void Scene::setTransform(std::uint32_t index, const Transform &transform) {
+  m_transforms[index] = transform;
+  m_dirty[index] = 1;
+}
+
+void Scene::updateWorld(JobSystem *jobs) {
+  if (!jobs || size() <= UPDATE_GRAIN) {
+    updateWorld(0, size());
+    return;
+  }
+  JobCounter counter;
+  jobs->parallelFor(
+      size(), UPDATE_GRAIN,
+      [this](std::size_t first, std::size_t last) { updateWorld(first, last); },
+      counter);
+  jobs->wait(counter);
+}
+
+void Scene::updateWorld(std::size_t first, std::size_t last) {
+  // the CullingSet writes are per index too, so ranges don't share anything
+  for (std::size_t i = first; i < last; i++) {
+    if (!m_dirty[i])
+      continue;
+    m_dirty[i] = 0;
+    const Transform &transform = m_transforms[i];
+    m_world[i] = transformMatrix(transform);
+    const BoundingSphere &local = m_localBounds[i];
+    Vec4 center = m_world[i] * Vec4{local.center.x, local.center.y,
+                                    local.center.z, 1.0f};
+    m_worldBounds.setSphere(static_cast<std::uint32_t>(i),
+                            {center.x, center.y, center.z},
+                            local.radius * transform.scale);
+  }
+}
+
+void Scene::cull(const Frustum &frustum, std::vector<std::uint32_t> &visible,
+                 JobSystem *jobs) const {
+  if (!jobs || size() <= CULL_GRAIN) {
+    m_worldBounds.cullSpheres(frustum, visible);
+    return;
+  }
+  // every chunk culls into its own slice of `visible`, then the slices are
+  // packed down in order
+  std::size_t chunks = (size() + CULL_GRAIN - 1) / CULL_GRAIN;
+  std::vector<std::size_t> counts(chunks);
+  visible.resize(size());
+  JobCounter counter;
+  jobs->parallelFor(
+      size(), CULL_GRAIN,
+      [&](std::size_t first, std::size_t last) {
+        counts[first / CULL_GRAIN] =
+            m_worldBounds.cullSpheres(frustum, first, last, &visible[first]);
+      },
+      counter);
+  jobs->wait(counter);
+  std::size_t count = counts[0];
+  for (std::size_t chunk = 1; chunk < chunks; chunk++) {
+    std::memmove(&visible[count], &visible[chunk * CULL_GRAIN],
+                 counts[chunk] * sizeof(std::uint32_t));
+    count += counts[chunk];
+  }
+  visible.resize(count);
+}
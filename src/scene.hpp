@@ -0,0 +1,105 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "culling.hpp"
+#include "job_system.hpp"
+#include "linear_math.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Handle of a scene entity: the slot in the low 24 bits and the slot's
+// generation in the high 8, so a handle outliving its entity is caught even
+// after the slot was reused
+using Entity = std::uint32_t;
+static constexpr Entity INVALID_ENTITY = 0xFFFFFFFF;
+
+struct Transform {
+  Vec3 position;
+  Vec4 rotation{0.0f, 0.0f, 0.0f, 1.0f}; // unit quaternion
+  float scale = 1.0f; // uniform, so bounding spheres stay spheres
+};
+
+// translate * rotate * scale
+Mat4 transformMatrix(const Transform &transform);
+
+// Local bounding sphere of a mesh
+struct BoundingSphere {
+  Vec3 center;
+  float radius = 0.0f;
+};
+
+// Entity-component store for the renderable objects. Each component lives
+// in its own dense array and index i of every array belongs to the same
+// entity, so the per-frame passes stream through contiguous memory and can be
+// split into ranges across threads. destroy() moves the last entity into the
+// hole to keep the arrays dense, which is why dense indices are only stable
+// until the next destroy(); hold on to Entity handles instead.
+//
+// Meshes and materials are plain ids into whatever tables the renderer
+// keeps, the scene never touches GL.
+class Scene {
+public:
+  Entity create(const Transform &transform, const BoundingSphere &bounds,
+                std::uint32_t mesh, std::uint32_t material);
+  void destroy(Entity entity);
+  bool alive(Entity entity) const;
+  void clear();
+  void reserve(std::size_t count);
+  std::size_t size() const { return m_entities.size(); }
+
+  // dense index of a live entity
+  std::uint32_t indexOf(Entity entity) const;
+
+  const Transform &transform(std::uint32_t index) const {
+    return m_transforms[index];
+  }
+  void setTransform(std::uint32_t index, const Transform &transform);
+  void setMesh(std::uint32_t index, std::uint32_t mesh) {
+    m_meshes[index] = mesh;
+  }
+  void setMaterial(std::uint32_t index, std::uint32_t material) {
+    m_materials[index] = material;
+  }
+
+  // recomputes world matrices and bounds of the entities whose transform
+  // changed since the last update, in ranges over `jobs` when given;
+  // disjoint ranges may run concurrently
+  void updateWorld(JobSystem *jobs = nullptr);
+  void updateWorld(std::size_t first, std::size_t last);
+
+  // dense indices of the entities whose world sphere touches the frustum, in
+  // increasing order either way
+  void cull(const Frustum &frustum, std::vector<std::uint32_t> &visible,
+            JobSystem *jobs = nullptr) const;
+
+  // the dense component arrays, indexed alike
+  const std::vector<Entity> &entities() const { return m_entities; }
+  const std::vector<Mat4> &worldMatrices() const { return m_world; }
+  const std::vector<std::uint32_t> &meshes() const { return m_meshes; }
+  const std::vector<std::uint32_t> &materials() const { return m_materials; }
+  // world space spheres (and their boxes), valid after updateWorld()
+  const CullingSet &worldBounds() const { return m_worldBounds; }
+
+private:
+  static constexpr int INDEX_BITS = 24;
+  static constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+  // dense components
+  std::vector<Entity> m_entities;
+  std::vector<Transform> m_transforms;
+  std::vector<BoundingSphere> m_localBounds;
+  std::vector<std::uint32_t> m_meshes;
+  std::vector<std::uint32_t> m_materials;
+  std::vector<std::uint8_t> m_dirty;
+  std::vector<Mat4> m_world;
+  CullingSet m_worldBounds;
+
+  // sparse side, by entity slot: dense index (or next free slot) and
+  // generation
+  std::vector<std::uint32_t> m_slots;
+  std::vector<std::uint8_t> m_generations;
+  std::uint32_t m_freeSlot = INVALID_ENTITY;
+};
+#endif
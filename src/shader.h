@@ -1,6 +1,9 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include "cpu_profiler.hpp"
+#include "gl_debug.hpp"
+#include "linear_math.hpp"
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 
 #include <fstream>
@@ -15,6 +18,7 @@ public:
 
   // constructor reads and builds the shader
   Shader(const char *vertexPath, const char *fragmentPath) {
+    CpuZone zone("compile shader");
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -50,6 +54,7 @@ public:
     // create vertex shader object and assign it an ID
     unsigned int vertexShader;
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    labelGLObject(GL_SHADER, vertexShader, vertexPath);
 
     // attach the shader source code to the shader object
     glShaderSource(vertexShader, 1, &vShaderCode, NULL);
@@ -67,6 +72,7 @@ public:
     // create fragment shader object and assign it an ID
     unsigned int fragmentShader;
     fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    labelGLObject(GL_SHADER, fragmentShader, fragmentPath);
 
     // attach the shader source code to the shader object
     glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
@@ -83,6 +89,8 @@ public:
     // create a shader program object
 
     programID = glCreateProgram();
+    labelGLObject(GL_PROGRAM, programID,
+                  std::string(vertexPath) + " + " + fragmentPath);
 
     // attach the vertex and fragment shaders to the shader program
     glAttachShader(programID, vertexShader);
@@ -116,5 +124,13 @@ public:
   void setFloat(const std::string &name, float value) const {
     glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
   }
+  void setVec3(const std::string &name, Vec3 value) const {
+    glUniform3f(glGetUniformLocation(programID, name.c_str()), value.x, value.y,
+                value.z);
+  }
+  void setMat4(const std::string &name, const Mat4 &value) const {
+    glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1,
+                       GL_FALSE, value.m);
+  }
 };
 #endif
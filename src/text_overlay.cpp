@@ -0,0 +1,194 @@
+#include "text_overlay.hpp"
+
+#include "frame_stats.hpp"
+#include "gl_debug.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+// the atlas covers ASCII 32 (' ') to 95 ('_'): 16 x 4 cells of 4 x 6
+// texels, the glyph in the top left 3 x 5 of each and the rest empty so
+// nearest sampling never bleeds into the neighbour
+const char FIRST_CHAR = 32;
+const int CELL_COUNT = 64;
+const int ATLAS_COLUMNS = 16;
+const int CELL_WIDTH = 4, CELL_HEIGHT = 6;
+const int GLYPH_WIDTH = 3, GLYPH_HEIGHT = 5;
+const int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+const int ATLAS_HEIGHT = CELL_COUNT / ATLAS_COLUMNS * CELL_HEIGHT;
+
+// 5 rows of 3 pixels each, top to bottom
+struct FontGlyph {
+  char c;
+  const char *rows;
+};
+
+const FontGlyph FONT[] = {
+    {'0', "###" "#.#" "#.#" "#.#" "###"}, {'1', ".#." "##." ".#." ".#." "###"},
+    {'2', "###" "..#" "###" "#.." "###"}, {'3', "###" "..#" ".##" "..#" "###"},
+    {'4', "#.#" "#.#" "###" "..#" "..#"}, {'5', "###" "#.." "###" "..#" "###"},
+    {'6', "###" "#.." "###" "#.#" "###"}, {'7', "###" "..#" "..#" ".#." ".#."},
+    {'8', "###" "#.#" "###" "#.#" "###"}, {'9', "###" "#.#" "###" "..#" "###"},
+    {'A', ".#." "#.#" "###" "#.#" "#.#"}, {'B', "##." "#.#" "##." "#.#" "##."},
+    {'C', ".##" "#.." "#.." "#.." ".##"}, {'D', "##." "#.#" "#.#" "#.#" "##."},
+    {'E', "###" "#.." "##." "#.." "###"}, {'F', "###" "#.." "##." "#.." "#.."},
+    {'G', ".##" "#.." "#.#" "#.#" ".##"}, {'H', "#.#" "#.#" "###" "#.#" "#.#"},
+    {'I', "###" ".#." ".#." ".#." "###"}, {'J', "..#" "..#" "..#" "#.#" ".#."},
+    {'K', "#.#" "#.#" "##." "#.#" "#.#"}, {'L', "#.." "#.." "#.." "#.." "###"},
+    {'M', "#.#" "###" "###" "#.#" "#.#"}, {'N', "##." "#.#" "#.#" "#.#" "#.#"},
+    {'O', ".#." "#.#" "#.#" "#.#" ".#."}, {'P', "##." "#.#" "##." "#.." "#.."},
+    {'Q', ".#." "#.#" "#.#" "###" ".##"}, {'R', "##." "#.#" "##." "#.#" "#.#"},
+    {'S', ".##" "#.." ".#." "..#" "##."}, {'T', "###" ".#." ".#." ".#." ".#."},
+    {'U', "#.#" "#.#" "#.#" "#.#" "###"}, {'V', "#.#" "#.#" "#.#" ".#." ".#."},
+    {'W', "#.#" "#.#" "###" "###" "#.#"}, {'X', "#.#" "#.#" ".#." "#.#" "#.#"},
+    {'Y', "#.#" "#.#" ".#." ".#." ".#."}, {'Z', "###" "..#" ".#." "#.." "###"},
+    {'.', "..." "..." "..." "..." ".#."}, {',', "..." "..." "..." ".#." "#.."},
+    {':', "..." ".#." "..." ".#." "..."}, {'/', "..#" "..#" ".#." "#.." "#.."},
+    {'-', "..." "..." "###" "..." "..."}, {'%', "#.#" "..#" ".#." "#.." "#.#"},
+    {'(', "..#" ".#." ".#." ".#." "..#"}, {')', "#.." ".#." ".#." ".#." "#.."},
+    {'=', "..." "###" "..." "###" "..."}, {'+', "..." ".#." "###" ".#." "..."},
+    {'_', "..." "..." "..." "..." "###"}, {'!', ".#." ".#." ".#." "..." ".#."},
+    {'?', "##." "..#" ".#." "..." ".#."}, {'|', ".#." ".#." ".#." ".#." ".#."},
+};
+
+unsigned char cellOf(char c) {
+  if (c >= 'a' && c <= 'z')
+    c = static_cast<char>(c - 'a' + 'A');
+  if (c < FIRST_CHAR || c >= FIRST_CHAR + CELL_COUNT)
+    c = '?';
+  return static_cast<unsigned char>(c - FIRST_CHAR);
+}
+
+} // namespace
+
+TextOverlay::TextOverlay(int scale)
+    : m_shader("../Shaders/text_vertex_shader.glsl",
+               "../Shaders/text_fragment_shader.glsl"),
+      m_scale(scale) {
+  m_shader.use();
+  m_shader.setInt("font", 0);
+
+  unsigned char texels[ATLAS_WIDTH * ATLAS_HEIGHT] = {};
+  for (const FontGlyph &glyph : FONT) {
+    int cell = cellOf(glyph.c);
+    int left = cell % ATLAS_COLUMNS * CELL_WIDTH;
+    int top = cell / ATLAS_COLUMNS * CELL_HEIGHT;
+    for (int y = 0; y < GLYPH_HEIGHT; y++)
+      for (int x = 0; x < GLYPH_WIDTH; x++)
+        if (glyph.rows[y * GLYPH_WIDTH + x] == '#')
+          texels[(top + y) * ATLAS_WIDTH + left + x] = 255;
+  }
+  glGenTextures(1, &m_atlas);
+  glBindTexture(GL_TEXTURE_2D, m_atlas);
+  labelGLObject(GL_TEXTURE, m_atlas, "text overlay font");
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED,
+               GL_UNSIGNED_BYTE, texels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  countTextureUpload(sizeof(texels));
+
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_vbo);
+  glGenBuffers(1, &m_ebo);
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo); // captured by the VAO
+  labelGLObject(GL_BUFFER, m_vbo, "text overlay vertices");
+  labelGLObject(GL_BUFFER, m_ebo, "text overlay indices");
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (void *)offsetof(Vertex, texCoord));
+  glEnableVertexAttribArray(1);
+}
+
+TextOverlay::~TextOverlay() {
+  glDeleteVertexArrays(1, &m_vao);
+  glDeleteBuffers(1, &m_vbo);
+  glDeleteBuffers(1, &m_ebo);
+  glDeleteTextures(1, &m_atlas);
+}
+
+float TextOverlay::lineHeight() const {
+  return static_cast<float>((GLYPH_HEIGHT + 2) * m_scale);
+}
+
+void TextOverlay::print(float x, float y, const std::string &text) {
+  float penX = x;
+  for (char c : text) {
+    if (c == '\n') {
+      penX = x;
+      y += lineHeight();
+      continue;
+    }
+    if (c != ' ')
+      m_glyphs.push_back({penX, y, cellOf(c)});
+    penX += static_cast<float>(CELL_WIDTH * m_scale);
+  }
+}
+
+DrawPacket TextOverlay::build(GLStateCache &glState, int width, int height) {
+  DrawPacket packet;
+  packet.pass = RenderPass::Overlay;
+  packet.program = m_shader.programID;
+  packet.vao = m_vao;
+  packet.textures[0] = m_atlas;
+  if (m_glyphs.empty() || width <= 0 || height <= 0)
+    return packet;
+
+  const float sx = 2.0f / static_cast<float>(width);
+  const float sy = 2.0f / static_cast<float>(height);
+  const float glyphW = static_cast<float>(GLYPH_WIDTH * m_scale);
+  const float glyphH = static_cast<float>(GLYPH_HEIGHT * m_scale);
+  m_vertices.clear();
+  for (const Glyph &glyph : m_glyphs) {
+    float x0 = glyph.x * sx - 1.0f, x1 = (glyph.x + glyphW) * sx - 1.0f;
+    float y0 = 1.0f - glyph.y * sy, y1 = 1.0f - (glyph.y + glyphH) * sy;
+    // atlas row 0 is the top of the first glyph row
+    float u0 = static_cast<float>(glyph.cell % ATLAS_COLUMNS * CELL_WIDTH) /
+               ATLAS_WIDTH;
+    float v0 = static_cast<float>(glyph.cell / ATLAS_COLUMNS * CELL_HEIGHT) /
+               ATLAS_HEIGHT;
+    float u1 = u0 + static_cast<float>(GLYPH_WIDTH) / ATLAS_WIDTH;
+    float v1 = v0 + static_cast<float>(GLYPH_HEIGHT) / ATLAS_HEIGHT;
+    m_vertices.push_back({{x0, y0}, {u0, v0}});
+    m_vertices.push_back({{x1, y0}, {u1, v0}});
+    m_vertices.push_back({{x1, y1}, {u1, v1}});
+    m_vertices.push_back({{x0, y1}, {u0, v1}});
+  }
+
+  glState.bindVertexArray(m_vao);
+  if (m_glyphs.size() > m_capacity) {
+    // the index pattern never changes, it only has to be long enough
+    m_capacity = m_glyphs.size() + m_glyphs.size() / 2;
+    std::vector<std::uint32_t> indices;
+    indices.reserve(m_capacity * 6);
+    for (std::uint32_t q = 0; q < m_capacity; q++)
+      for (std::uint32_t corner : {0u, 1u, 2u, 0u, 2u, 3u})
+        indices.push_back(q * 4 + corner);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(indices.size() * sizeof(std::uint32_t)),
+                 indices.data(), GL_STATIC_DRAW);
+    countBufferUpload(indices.size() * sizeof(std::uint32_t));
+  }
+  // orphan, last frame's text may still be drawing
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(m_capacity * 4 * sizeof(Vertex)),
+               nullptr, GL_STREAM_DRAW);
+  GLsizeiptr bytes =
+      static_cast<GLsizeiptr>(m_vertices.size() * sizeof(Vertex));
+  glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_vertices.data());
+  countBufferUpload(static_cast<std::size_t>(bytes));
+
+  packet.count = static_cast<GLsizei>(m_glyphs.size() * 6);
+  m_glyphs.clear();
+  return packet;
+}
@@ -0,0 +1,57 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include "gl_state_cache.hpp"
+#include "render_queue.hpp"
+#include "shader.h"
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Screen space debug text. A built-in 3x5 pixel font (upper case, digits
+// and some punctuation, lower case prints as upper case) lives in a small
+// atlas texture; everything printed in a frame becomes one batch of glyph
+// quads, drawn as a single packet in the overlay pass.
+//
+// Owns the atlas and glyph buffers, destroy it while the GL context is
+// current.
+class TextOverlay {
+public:
+  // `scale` is screen pixels per font pixel. Sets up its GL objects
+  // directly, create it before the state cache or invalidate that after.
+  explicit TextOverlay(int scale = 3);
+  ~TextOverlay();
+  TextOverlay(const TextOverlay &) = delete;
+  TextOverlay &operator=(const TextOverlay &) = delete;
+
+  // `x`, `y` in pixels from the top left; '\n' starts a new line
+  void print(float x, float y, const std::string &text);
+  float lineHeight() const;
+
+  // uploads everything printed since the last call and returns the packet
+  // drawing it for a `width` x `height` framebuffer; count 0 when empty
+  DrawPacket build(GLStateCache &glState, int width, int height);
+
+private:
+  struct Glyph {
+    float x, y;         // pixels, top left
+    unsigned char cell; // atlas cell
+  };
+  struct Vertex {
+    float position[2]; // clip space
+    float texCoord[2];
+  };
+
+  Shader m_shader;
+  int m_scale;
+  GLuint m_atlas = 0;
+  GLuint m_vao = 0;
+  GLuint m_vbo = 0;
+  GLuint m_ebo = 0;
+  std::size_t m_capacity = 0; // glyphs the buffers hold
+  std::vector<Glyph> m_glyphs;
+  std::vector<Vertex> m_vertices;
+};
+#endif
@@ -1,14 +1,40 @@
 #include "texture_handler.hpp"
 
+#include "cpu_profiler.hpp"
+#include "frame_stats.hpp"
+#include "gl_debug.hpp"
 #include "stb_image.h"
 #include <glad/glad.h>
 #include <iostream>
+#include <vector>
 
-unsigned int load2DTexture(const char *path) {
+void ImageDeleter::operator()(unsigned char *pixels) const {
+  stbi_image_free(pixels);
+}
+
+DecodedImage decodeImage(const char *path, int channels) {
+  CpuZone zone("decode image");
+  DecodedImage image;
+  image.path = path;
+  // stb_image keeps its error state per thread, so this is safe anywhere
+  image.pixels.reset(stbi_load(path, &image.width, &image.height,
+                               &image.channels, channels));
+  if (!image.pixels) {
+    std::cout << "Failed to load texture " << path << std::endl;
+    return image;
+  }
+  if (channels != 0)
+    image.channels = channels;
+  return image;
+}
+
+unsigned int upload2DTexture(const DecodedImage &image) {
+  CpuZone zone("upload texture");
   // generate a texture ID and bind it to the GL_TEXTURE_2D target
   unsigned int texture;
   glGenTextures(1, &texture);
   glBindTexture(GL_TEXTURE_2D, texture);
+  labelGLObject(GL_TEXTURE, texture, image.path);
 
   // Handles texture wrapping if needed
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
@@ -21,31 +47,122 @@ unsigned int load2DTexture(const char *path) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
                   GL_LINEAR); // use linear filtering for magnification
 
-  // loading texture using stb_image
-  int width, height, nrChannels;
-  unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
-
   // generate texture
-  if (data) {
-    if (nrChannels == 3) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                   GL_UNSIGNED_BYTE,
-                   data); // (texture target, mipmap layer, storage format,
-                          // width, height, legacy stuff, source format, source
-                          // datatype, image data)
+  if (image.pixels) {
+    countTextureUpload(static_cast<std::size_t>(image.width) * image.height *
+                       image.channels);
+    if (image.channels == 3) {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0,
+                   GL_RGB, GL_UNSIGNED_BYTE,
+                   image.pixels.get()); // (texture target, mipmap layer,
+                                        // storage format, width, height,
+                                        // legacy stuff, source format, source
+                                        // datatype, image data)
       glGenerateMipmap(GL_TEXTURE_2D); // generate mipmaps
                                        //
-    } else if (nrChannels == 4) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA,
-                   GL_UNSIGNED_BYTE,
-                   data); // (texture target, mipmap layer, storage format,
-                          // width, height, legacy stuff, source format, source
-                          // datatype, image data)
+    } else if (image.channels == 4) {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE,
+                   image.pixels.get()); // (texture target, mipmap layer,
+                                        // storage format, width, height,
+                                        // legacy stuff, source format, source
+                                        // datatype, image data)
       glGenerateMipmap(GL_TEXTURE_2D); // generate mipmaps
     }
-  } else {
-    std::cout << "Failed to load texture" << std::endl;
   }
-  stbi_image_free(data); // free the image data after generating the texture
   return texture;
 }
+
+unsigned int upload2DTextureArray(const DecodedImage *images, int count) {
+  CpuZone zone("upload texture array");
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  if (count > 0)
+    labelGLObject(GL_TEXTURE, texture,
+                  images[0].path + " + " + std::to_string(count - 1) +
+                      " layers");
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // every layer of an array texture shares one size, the first image decides
+  // it. Images are always expanded to RGBA so the layers share a format too.
+  int layerWidth = 0, layerHeight = 0;
+  for (int layer = 0; layer < count; layer++) {
+    const DecodedImage &image = images[layer];
+    if (!image.pixels)
+      continue;
+    if (layerWidth == 0) {
+      layerWidth = image.width;
+      layerHeight = image.height;
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, image.width,
+                   image.height, count, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    if (image.width == layerWidth && image.height == layerHeight) {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, image.width,
+                      image.height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                      image.pixels.get());
+      countTextureUpload(static_cast<std::size_t>(image.width) * image.height *
+                         4);
+    } else
+      std::cout << "Texture array layer size mismatch, layer " << layer
+                << std::endl;
+  }
+  if (layerWidth != 0)
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  return texture;
+}
+
+unsigned int load2DTexture(const char *path) {
+  return upload2DTexture(decodeImage(path));
+}
+
+unsigned int load2DTextureArray(const char *const *paths, int count) {
+  std::vector<DecodedImage> images(count);
+  for (int layer = 0; layer < count; layer++)
+    images[layer] = decodeImage(paths[layer], STBI_rgb_alpha);
+  return upload2DTextureArray(images.data(), count);
+}
+
+void load2DTextureAsync(JobSystem &jobs, const char *path,
+                        unsigned int *texture, JobCounter &counter) {
+  // the upload is queued before the decode job finishes, so the counter
+  // can't hit zero in between
+  jobs.run(
+      [&jobs, path, texture, &counter] {
+        auto image = std::make_shared<DecodedImage>(decodeImage(path));
+        jobs.runOnMainThread(
+            [image, texture] { *texture = upload2DTexture(*image); },
+            &counter);
+      },
+      &counter);
+}
+
+void load2DTextureArrayAsync(JobSystem &jobs, const char *const *paths,
+                             int count, unsigned int *texture,
+                             JobCounter &counter) {
+  // one decode job per layer, the upload waits for all of them and keeps
+  // their counter alive until it runs
+  auto images = std::make_shared<std::vector<DecodedImage>>(count);
+  auto decoded = std::make_shared<JobCounter>();
+  for (int layer = 0; layer < count; layer++)
+    jobs.run(
+        [images, paths, layer] {
+          (*images)[layer] = decodeImage(paths[layer], STBI_rgb_alpha);
+        },
+        decoded.get());
+  jobs.runAfter(
+      *decoded,
+      [&jobs, images, decoded, count, texture, &counter] {
+        jobs.runOnMainThread(
+            [images, count, texture] {
+              *texture = upload2DTextureArray(images->data(), count);
+            },
+            &counter);
+      },
+      &counter);
+}
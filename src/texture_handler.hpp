@@ -1,6 +1,42 @@
 #ifndef TEXTURE_HANDLER_H
 #define TEXTURE_HANDLER_H
 
+#include "job_system.hpp"
+
+#include <memory>
+#include <string>
+
+struct ImageDeleter {
+  void operator()(unsigned char *pixels) const;
+};
+
+// pixels as decoded by stb_image, empty when the file couldn't be read
+struct DecodedImage {
+  int width = 0, height = 0, channels = 0;
+  std::unique_ptr<unsigned char, ImageDeleter> pixels;
+  std::string path; // the uploaded texture is labelled with it
+};
+
+// reads and decodes an image file without touching GL, so any thread can.
+// `channels` forces a channel count, 0 keeps the file's.
+DecodedImage decodeImage(const char *path, int channels = 0);
+
+// GL thread only
+unsigned int upload2DTexture(const DecodedImage &image);
+// same-sized RGBA images into the layers of one GL_TEXTURE_2D_ARRAY
+unsigned int upload2DTextureArray(const DecodedImage *images, int count);
+
 // loads 2d textures
 unsigned int load2DTexture(const char *path);
+// loads same-sized 2d images into the layers of one GL_TEXTURE_2D_ARRAY
+unsigned int load2DTextureArray(const char *const *paths, int count);
+
+// the same, decoding on the job system's workers and uploading on its main
+// thread. `*texture` is set once `counter` reaches zero; the paths must stay
+// valid until then.
+void load2DTextureAsync(JobSystem &jobs, const char *path,
+                        unsigned int *texture, JobCounter &counter);
+void load2DTextureArrayAsync(JobSystem &jobs, const char *const *paths,
+                             int count, unsigned int *texture,
+                             JobCounter &counter);
 #endif
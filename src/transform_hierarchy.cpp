@@ -0,0 +1,276 @@
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+
+#if defined(CULLING_SSE) || defined(CULLING_AVX)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// nodes per parallelFor chunk, a few microseconds of multiplies
+const std::size_t UPDATE_GRAIN = 2048;
+
+// out = a * b, one column of the result per SSE register. Same operation
+// order as operator*, so both give the same bits.
+inline void multiply(const Mat4 &a, const Mat4 &b, Mat4 &out) {
+#if defined(CULLING_SSE) || defined(CULLING_AVX)
+  __m128 a0 = _mm_loadu_ps(a.m), a1 = _mm_loadu_ps(a.m + 4);
+  __m128 a2 = _mm_loadu_ps(a.m + 8), a3 = _mm_loadu_ps(a.m + 12);
+  for (int column = 0; column < 4; column++) {
+    const float *bc = b.m + column * 4;
+    __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+    r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+    _mm_storeu_ps(out.m + column * 4, r);
+  }
+#else
+  out = a * b;
+#endif
+}
+
+} // namespace
+
+TransformHierarchy::Node TransformHierarchy::create(Node parent,
+                                                    const Transform &local) {
+  return create(parent, transformMatrix(local));
+}
+
+TransformHierarchy::Node TransformHierarchy::create(Node parent,
+                                                    const Mat4 &local) {
+  Node node;
+  if (!m_freeNodes.empty()) {
+    node = m_freeNodes.back();
+    m_freeNodes.pop_back();
+  } else {
+    node = static_cast<Node>(m_parent.size());
+    m_parent.push_back(INVALID);
+    m_position.push_back(INVALID);
+    m_dirty.push_back(0);
+  }
+  // appended outside the layout until the next update() sorts it in
+  m_parent[node] = parent;
+  m_position[node] = static_cast<std::uint32_t>(m_local.size());
+  m_local.push_back(local);
+  m_world.push_back(local);
+  m_node.push_back(node);
+  m_parentPosition.push_back(INVALID);
+  m_liveCount++;
+  m_layoutDirty = true;
+  return node;
+}
+
+void TransformHierarchy::destroy(Node node) {
+  if (m_layoutDirty)
+    rebuildLayout();
+  // the descendants are one contiguous span per level
+  std::uint32_t first = m_position[node], last = first + 1;
+  while (first < last) {
+    for (std::uint32_t p = first; p < last; p++) {
+      Node gone = m_node[p];
+      m_parent[gone] = INVALID;
+      m_position[gone] = INVALID;
+      m_dirty[gone] = 0;
+      m_freeNodes.push_back(gone);
+    }
+    m_liveCount -= last - first;
+    std::uint32_t childFirst = m_childBegin[first];
+    last = m_childBegin[last];
+    first = childFirst;
+  }
+  m_layoutDirty = true;
+}
+
+void TransformHierarchy::setLocal(Node node, const Transform &local) {
+  setLocal(node, transformMatrix(local));
+}
+
+void TransformHierarchy::setLocal(Node node, const Mat4 &local) {
+  m_local[m_position[node]] = local;
+  markDirty(node);
+}
+
+void TransformHierarchy::markDirty(Node node) {
+  if (!m_dirty[node]) {
+    m_dirty[node] = 1;
+    m_dirtyNodes.push_back(node);
+  }
+}
+
+void TransformHierarchy::clear() {
+  m_parent.clear();
+  m_position.clear();
+  m_dirty.clear();
+  m_freeNodes.clear();
+  m_dirtyNodes.clear();
+  m_local.clear();
+  m_world.clear();
+  m_node.clear();
+  m_parentPosition.clear();
+  m_childBegin.clear();
+  m_levelStart.clear();
+  m_liveCount = 0;
+  m_layoutDirty = false;
+  m_fullUpdate = false;
+}
+
+void TransformHierarchy::rebuildLayout() {
+  // children of every live node, grouped by parent (counting sort)
+  std::size_t nodeCount = m_parent.size();
+  std::vector<std::uint32_t> childStart(nodeCount + 1, 0);
+  std::vector<Node> order;
+  order.reserve(m_liveCount);
+  for (Node node = 0; node < nodeCount; node++) {
+    if (m_position[node] == INVALID)
+      continue;
+    if (m_parent[node] == INVALID)
+      order.push_back(node);
+    else
+      childStart[m_parent[node] + 1]++;
+  }
+  for (std::size_t i = 0; i < nodeCount; i++)
+    childStart[i + 1] += childStart[i];
+  std::vector<Node> children(childStart[nodeCount]);
+  std::vector<std::uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+  for (Node node = 0; node < nodeCount; node++)
+    if (m_position[node] != INVALID && m_parent[node] != INVALID)
+      children[cursor[m_parent[node]]++] = node;
+
+  // breadth first from the roots, noting where every level starts and where
+  // every node's children land
+  m_childBegin.assign(m_liveCount + 1, 0);
+  m_levelStart.assign(1, 0);
+  std::size_t levelEnd = order.size();
+  for (std::size_t p = 0; p < order.size(); p++) {
+    if (p == levelEnd) {
+      m_levelStart.push_back(static_cast<std::uint32_t>(p));
+      levelEnd = order.size();
+    }
+    m_childBegin[p] = static_cast<std::uint32_t>(order.size());
+    Node node = order[p];
+    order.insert(order.end(), children.begin() + childStart[node],
+                 children.begin() + childStart[node + 1]);
+  }
+  m_childBegin[order.size()] = static_cast<std::uint32_t>(order.size());
+  if (!order.empty())
+    m_levelStart.push_back(static_cast<std::uint32_t>(order.size()));
+
+  std::vector<Mat4> local(order.size());
+  for (std::size_t p = 0; p < order.size(); p++)
+    local[p] = m_local[m_position[order[p]]];
+  m_local.swap(local);
+  m_world.resize(order.size());
+  for (std::size_t p = 0; p < order.size(); p++)
+    m_position[order[p]] = static_cast<std::uint32_t>(p);
+  m_parentPosition.resize(order.size());
+  for (std::size_t p = 0; p < order.size(); p++)
+    m_parentPosition[p] = m_parent[order[p]] == INVALID
+                              ? INVALID
+                              : m_position[m_parent[order[p]]];
+  m_node.swap(order);
+
+  m_layoutDirty = false;
+  m_fullUpdate = true;
+}
+
+std::size_t TransformHierarchy::update(JobSystem *jobs) {
+  if (m_layoutDirty)
+    rebuildLayout();
+  std::size_t updated = 0;
+
+  if (m_fullUpdate) {
+    for (std::size_t level = 0; level + 1 < m_levelStart.size(); level++) {
+      m_spans.assign(1, {m_levelStart[level], m_levelStart[level + 1]});
+      updated += updateSpans(m_spans, level == 0, jobs);
+    }
+    m_fullUpdate = false;
+  } else if (!m_dirtyNodes.empty()) {
+    m_dirtyPositions.clear();
+    for (Node node : m_dirtyNodes)
+      m_dirtyPositions.push_back(m_position[node]);
+    std::sort(m_dirtyPositions.begin(), m_dirtyPositions.end());
+
+    // per level: the children of what changed on the level above plus the
+    // nodes changed directly, merged into as few spans as possible
+    m_spans.clear();
+    std::size_t nextDirty = 0;
+    for (std::size_t level = 0; level + 1 < m_levelStart.size(); level++) {
+      std::uint32_t levelEnd = m_levelStart[level + 1];
+      m_nextSpans.clear();
+      auto append = [&](Span span) {
+        if (!m_nextSpans.empty() && span.first <= m_nextSpans.back().second)
+          m_nextSpans.back().second =
+              std::max(m_nextSpans.back().second, span.second);
+        else
+          m_nextSpans.push_back(span);
+      };
+      std::size_t s = 0;
+      while (s < m_spans.size() || (nextDirty < m_dirtyPositions.size() &&
+                                    m_dirtyPositions[nextDirty] < levelEnd)) {
+        Span children{INVALID, INVALID};
+        if (s < m_spans.size())
+          children = {m_childBegin[m_spans[s].first],
+                      m_childBegin[m_spans[s].second]};
+        bool takeDirty = nextDirty < m_dirtyPositions.size() &&
+                         m_dirtyPositions[nextDirty] < levelEnd &&
+                         m_dirtyPositions[nextDirty] < children.first;
+        if (takeDirty) {
+          std::uint32_t p = m_dirtyPositions[nextDirty++];
+          append({p, p + 1});
+        } else {
+          if (children.first < children.second)
+            append(children);
+          s++;
+        }
+      }
+      if (m_nextSpans.empty() && nextDirty == m_dirtyPositions.size())
+        break;
+      updated += updateSpans(m_nextSpans, level == 0, jobs);
+      m_spans.swap(m_nextSpans);
+    }
+  }
+
+  for (Node node : m_dirtyNodes)
+    m_dirty[node] = 0;
+  m_dirtyNodes.clear();
+  return updated;
+}
+
+std::size_t TransformHierarchy::updateSpans(const std::vector<Span> &spans,
+                                            bool roots, JobSystem *jobs) {
+  m_spanOffsets.resize(spans.size() + 1);
+  m_spanOffsets[0] = 0;
+  for (std::size_t s = 0; s < spans.size(); s++)
+    m_spanOffsets[s + 1] =
+        m_spanOffsets[s] + (spans[s].second - spans[s].first);
+  std::size_t total = m_spanOffsets.back();
+
+  // [begin, end) counts nodes across all spans
+  auto body = [&](std::size_t begin, std::size_t end) {
+    std::size_t s = std::upper_bound(m_spanOffsets.begin(),
+                                     m_spanOffsets.end(), begin) -
+                    m_spanOffsets.begin() - 1;
+    while (begin < end) {
+      std::size_t runEnd = std::min(end, m_spanOffsets[s + 1]);
+      std::uint32_t p =
+          spans[s].first + static_cast<std::uint32_t>(begin - m_spanOffsets[s]);
+      std::uint32_t last = p + static_cast<std::uint32_t>(runEnd - begin);
+      if (roots)
+        std::copy(m_local.begin() + p, m_local.begin() + last,
+                  m_world.begin() + p);
+      else
+        for (; p < last; p++)
+          multiply(m_world[m_parentPosition[p]], m_local[p], m_world[p]);
+      begin = runEnd;
+      s++;
+    }
+  };
+  if (jobs && total > UPDATE_GRAIN) {
+    JobCounter counter;
+    jobs->parallelFor(total, UPDATE_GRAIN, body, counter);
+    jobs->wait(counter);
+  } else
+    body(0, total);
+  return total;
+}
@@ -0,0 +1,86 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include "job_system.hpp"
+#include "linear_math.hpp"
+#include "scene.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Parent/child local-to-world transforms.
+//
+// Nodes are stored breadth first: the roots, then every node of depth 1 and
+// so on, the children of one parent next to each other and in the order of
+// their parents. A level only reads the level above it, so each level is one
+// parallel loop, and the descendants of a contiguous range of nodes form a
+// contiguous range one level down. update() follows those ranges from the
+// nodes whose local transform changed, so clean subtrees cost nothing.
+//
+// create() and destroy() only record the change; the next update() rebuilds
+// the layout and recomputes every node.
+class TransformHierarchy {
+public:
+  using Node = std::uint32_t;
+  static constexpr Node INVALID = 0xFFFFFFFF;
+
+  // INVALID parent for a root; parents must exist before their children
+  Node create(Node parent, const Transform &local);
+  Node create(Node parent, const Mat4 &local);
+  // removes the node together with all of its descendants
+  void destroy(Node node);
+  void setLocal(Node node, const Transform &local);
+  void setLocal(Node node, const Mat4 &local);
+  void clear();
+
+  Node parent(Node node) const { return m_parent[node]; }
+  // valid after update()
+  const Mat4 &world(Node node) const { return m_world[m_position[node]]; }
+  std::size_t size() const { return m_liveCount; }
+  // levels of the current layout, after update()
+  std::size_t depth() const {
+    return m_levelStart.empty() ? 0 : m_levelStart.size() - 1;
+  }
+
+  // recomputes the world matrices of every changed subtree one level at a
+  // time, spread over `jobs` when given. Returns the nodes recomputed.
+  std::size_t update(JobSystem *jobs = nullptr);
+
+private:
+  using Span = std::pair<std::uint32_t, std::uint32_t>; // [first, last)
+
+  void markDirty(Node node);
+  // breadth first order of the live nodes, in place
+  void rebuildLayout();
+  // world = parent world * local for every position in `spans`
+  std::size_t updateSpans(const std::vector<Span> &spans, bool roots,
+                          JobSystem *jobs);
+
+  // by node
+  std::vector<Node> m_parent;
+  std::vector<std::uint32_t> m_position; // INVALID once destroyed
+  std::vector<std::uint8_t> m_dirty;
+  std::vector<Node> m_freeNodes;
+  std::vector<Node> m_dirtyNodes;
+
+  // by position, breadth first
+  std::vector<Mat4> m_local;
+  std::vector<Mat4> m_world;
+  std::vector<Node> m_node;
+  std::vector<std::uint32_t> m_parentPosition;
+  // children of position p are [m_childBegin[p], m_childBegin[p + 1])
+  std::vector<std::uint32_t> m_childBegin;
+  std::vector<std::uint32_t> m_levelStart; // one past the end last
+
+  std::size_t m_liveCount = 0;
+  bool m_layoutDirty = false; // nodes were created or destroyed
+  bool m_fullUpdate = false;  // every node needs recomputing
+
+  // update() scratch
+  std::vector<std::uint32_t> m_dirtyPositions;
+  std::vector<Span> m_spans, m_nextSpans;
+  std::vector<std::size_t> m_spanOffsets;
+};
+#endif
@@ -0,0 +1,217 @@
+#include "vertex_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+struct EncodingInfo {
+  GLint components; // components GL reads
+  GLenum type;
+  GLboolean normalized;
+  GLuint bytes;
+};
+
+EncodingInfo info(VertexEncoding encoding) {
+  switch (encoding) {
+  case VertexEncoding::Float2:
+    return {2, GL_FLOAT, GL_FALSE, 8};
+  case VertexEncoding::Float3:
+    return {3, GL_FLOAT, GL_FALSE, 12};
+  case VertexEncoding::Float4:
+    return {4, GL_FLOAT, GL_FALSE, 16};
+  case VertexEncoding::Half2:
+    return {2, GL_HALF_FLOAT, GL_FALSE, 4};
+  case VertexEncoding::Half4:
+    return {4, GL_HALF_FLOAT, GL_FALSE, 8};
+  case VertexEncoding::Snorm8x4:
+    return {4, GL_BYTE, GL_TRUE, 4};
+  case VertexEncoding::Snorm16x4:
+    return {4, GL_SHORT, GL_TRUE, 8};
+  case VertexEncoding::Unorm8x4:
+    return {4, GL_UNSIGNED_BYTE, GL_TRUE, 4};
+  case VertexEncoding::Unorm16x2:
+    return {2, GL_UNSIGNED_SHORT, GL_TRUE, 4};
+  }
+  return {4, GL_FLOAT, GL_FALSE, 16};
+}
+
+// the source components of a semantic, padded to 4 with (0, 0, 0, 1)
+void fetch(const VertexData &v, VertexSemantic semantic, float out[4]) {
+  out[0] = out[1] = out[2] = 0.0f;
+  out[3] = 1.0f;
+  switch (semantic) {
+  case VertexSemantic::Position:
+    std::memcpy(out, v.position, sizeof(v.position));
+    break;
+  case VertexSemantic::Normal:
+    std::memcpy(out, v.normal, sizeof(v.normal));
+    out[3] = 0.0f;
+    break;
+  case VertexSemantic::Color:
+    std::memcpy(out, v.color, sizeof(v.color));
+    break;
+  case VertexSemantic::TexCoord:
+    std::memcpy(out, v.texCoord, sizeof(v.texCoord));
+    break;
+  }
+}
+
+template <typename T> void put(unsigned char *dst, int i, T value) {
+  std::memcpy(dst + i * sizeof(T), &value, sizeof(T));
+}
+
+template <typename T> T snorm(float v, float scale) {
+  return static_cast<T>(std::lround(std::clamp(v, -1.0f, 1.0f) * scale));
+}
+
+template <typename T> T unorm(float v, float scale) {
+  return static_cast<T>(std::lround(std::clamp(v, 0.0f, 1.0f) * scale));
+}
+} // namespace
+
+std::uint16_t floatToHalf(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+  std::uint32_t exponent = (bits >> 23) & 0xFF;
+  std::uint32_t mantissa = bits & 0x7FFFFF;
+
+  if (exponent == 0xFF) // inf / nan
+    return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+  int e = static_cast<int>(exponent) - 127 + 15;
+  if (e >= 31) // too big, clamp to inf
+    return sign | 0x7C00;
+  if (e <= 0) {
+    // subnormal half (or zero)
+    if (e < -10)
+      return sign;
+    mantissa |= 0x800000;
+    unsigned int shift = static_cast<unsigned int>(14 - e);
+    std::uint32_t half = mantissa >> shift;
+    std::uint32_t rest = mantissa & ((1u << shift) - 1);
+    std::uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+      half++;
+    return sign | static_cast<std::uint16_t>(half);
+  }
+  std::uint32_t half = (static_cast<std::uint32_t>(e) << 10) | (mantissa >> 13);
+  std::uint32_t rest = mantissa & 0x1FFF;
+  // round to nearest even, a carry into the exponent is still correct
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return sign | static_cast<std::uint16_t>(half);
+}
+
+VertexFormat &VertexFormat::add(VertexSemantic semantic, GLuint location,
+                                VertexEncoding encoding) {
+  m_elements.push_back({semantic, location, encoding, 0});
+  layout();
+  return *this;
+}
+
+void VertexFormat::layout() {
+  GLuint offset = 0;
+  for (Element &e : m_elements) {
+    e.offset = offset;
+    offset += info(e.encoding).bytes; // every encoding is a multiple of 4
+  }
+  m_stride = static_cast<GLsizei>(offset);
+}
+
+std::size_t VertexFormat::strip(GLuint program) {
+  // collect every location the linker kept. A mat4 attribute uses 4
+  // consecutive locations, arrays use one per element.
+  std::vector<GLuint> active;
+  GLint count = 0;
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+  for (GLint i = 0; i < count; i++) {
+    char name[256];
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveAttrib(program, static_cast<GLuint>(i), sizeof(name), nullptr,
+                      &size, &type, name);
+    GLint location = glGetAttribLocation(program, name);
+    if (location < 0)
+      continue; // built-ins like gl_VertexID
+    GLint slots = type == GL_FLOAT_MAT4   ? 4
+                  : type == GL_FLOAT_MAT3 ? 3
+                  : type == GL_FLOAT_MAT2 ? 2
+                                          : 1;
+    for (GLint s = 0; s < slots * size; s++)
+      active.push_back(static_cast<GLuint>(location + s));
+  }
+
+  std::size_t before = m_elements.size();
+  m_elements.erase(std::remove_if(m_elements.begin(), m_elements.end(),
+                                  [&](const Element &e) {
+                                    return std::find(active.begin(),
+                                                     active.end(),
+                                                     e.location) ==
+                                           active.end();
+                                  }),
+                   m_elements.end());
+  layout();
+  return before - m_elements.size();
+}
+
+std::vector<VertexAttrib> VertexFormat::attribs() const {
+  std::vector<VertexAttrib> result;
+  for (const Element &e : m_elements) {
+    EncodingInfo i = info(e.encoding);
+    result.push_back({e.location, i.components, i.type, i.normalized, e.offset});
+  }
+  return result;
+}
+
+void VertexFormat::apply(GLintptr offset) const {
+  for (const VertexAttrib &a : attribs()) {
+    glVertexAttribPointer(a.location, a.size, a.type, a.normalized, m_stride,
+                          (void *)(offset + a.offset));
+    glEnableVertexAttribArray(a.location);
+  }
+}
+
+void VertexFormat::encode(const VertexData *vertices, std::size_t count,
+                          std::vector<unsigned char> &out) const {
+  out.assign(count * m_stride, 0);
+  for (std::size_t v = 0; v < count; v++) {
+    unsigned char *vertex = out.data() + v * m_stride;
+    for (const Element &e : m_elements) {
+      float src[4];
+      fetch(vertices[v], e.semantic, src);
+      unsigned char *dst = vertex + e.offset;
+      switch (e.encoding) {
+      case VertexEncoding::Float2:
+      case VertexEncoding::Float3:
+      case VertexEncoding::Float4:
+        std::memcpy(dst, src, info(e.encoding).bytes);
+        break;
+      case VertexEncoding::Half2:
+        for (int i = 0; i < 2; i++)
+          put(dst, i, floatToHalf(src[i]));
+        break;
+      case VertexEncoding::Half4:
+        for (int i = 0; i < 4; i++)
+          put(dst, i, floatToHalf(src[i]));
+        break;
+      case VertexEncoding::Snorm8x4:
+        for (int i = 0; i < 4; i++)
+          put(dst, i, snorm<std::int8_t>(src[i], 127.0f));
+        break;
+      case VertexEncoding::Snorm16x4:
+        for (int i = 0; i < 4; i++)
+          put(dst, i, snorm<std::int16_t>(src[i], 32767.0f));
+        break;
+      case VertexEncoding::Unorm8x4:
+        for (int i = 0; i < 4; i++)
+          put(dst, i, unorm<std::uint8_t>(src[i], 255.0f));
+        break;
+      case VertexEncoding::Unorm16x2:
+        for (int i = 0; i < 2; i++)
+          put(dst, i, unorm<std::uint16_t>(src[i], 65535.0f));
+        break;
+      }
+    }
+  }
+}
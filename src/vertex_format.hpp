@@ -0,0 +1,78 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One vertex attribute of an interleaved vertex stream
+struct VertexAttrib {
+  GLuint location;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  GLuint offset; // byte offset inside the vertex
+};
+
+enum class VertexSemantic { Position, Normal, Color, TexCoord };
+
+// How an attribute is stored. The quantized ones are expanded back to float
+// by the vertex fetch (normalized glVertexAttribPointer), shaders don't change.
+enum class VertexEncoding {
+  Float2,    // 8 bytes
+  Float3,    // 12 bytes
+  Float4,    // 16 bytes
+  Half2,     // 4 bytes
+  Half4,     // 8 bytes, positions (w is written as 1)
+  Snorm8x4,  // 4 bytes, [-1, 1], normals
+  Snorm16x4, // 8 bytes, [-1, 1], higher precision normals
+  Unorm8x4,  // 4 bytes, [0, 1], colors
+  Unorm16x2, // 4 bytes, [0, 1], texture coordinates
+};
+
+// Full precision vertex as importers produce it, the input to encode()
+struct VertexData {
+  float position[3] = {0.0f, 0.0f, 0.0f};
+  float normal[3] = {0.0f, 0.0f, 1.0f};
+  float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  float texCoord[2] = {0.0f, 0.0f};
+};
+
+// Declares the attributes of an interleaved vertex, drops the ones a shader
+// doesn't read and packs VertexData into the chosen encodings.
+class VertexFormat {
+public:
+  VertexFormat &add(VertexSemantic semantic, GLuint location,
+                    VertexEncoding encoding);
+  // removes every attribute whose location isn't an active attribute of
+  // the linked program, returns how many were removed
+  std::size_t strip(GLuint program);
+
+  GLsizei stride() const { return m_stride; }
+  std::vector<VertexAttrib> attribs() const;
+  // sets the attribute pointers of the bound VAO (buffer bound to
+  // GL_ARRAY_BUFFER), `offset` is where vertex 0 starts in the buffer
+  void apply(GLintptr offset = 0) const;
+
+  // packs `count` vertices into `out` (resized to count * stride())
+  void encode(const VertexData *vertices, std::size_t count,
+              std::vector<unsigned char> &out) const;
+
+private:
+  struct Element {
+    VertexSemantic semantic;
+    GLuint location;
+    VertexEncoding encoding;
+    GLuint offset;
+  };
+  void layout();
+
+  std::vector<Element> m_elements;
+  GLsizei m_stride = 0;
+};
+
+// float -> IEEE half, round to nearest even
+std::uint16_t floatToHalf(float value);
+#endif